@@ -1,25 +1,24 @@
 #include "array.h"
+#include "elems.h"
 
 #include <stdlib.h>     // malloc(), free()
 #include <string.h>     // memcpy()
 
-struct array_t {
-    size_t size;
-    size_t elem_size;
-    void *data;
-};
-
 array *array_init(size_t elem_size, size_t size) {
     struct array_t *a = malloc(sizeof(*a));
     a->size = size;
     a->elem_size = elem_size;
     a->data = malloc(a->size * elem_size);
+
+    STATS_INIT(a);
+    STATS_ADD(a, allocs, 1);
     return a;
 }
 
 void array_del(array **a) {
     if (*a != NULL) {
         free((*a)->data);
+        STATS_DEL(*a);
         free(*a);
         *a = NULL;
     }
@@ -31,6 +30,7 @@ size_t array_size(const array * const a) {
 
 void array_set(array * const a, size_t index, void *val) {
     memcpy(array_get(a, index), val, a->elem_size);
+    STATS_ADD(a, bytes_copied, a->elem_size);
 }
 
 void *array_get(const array * const a, size_t index) {
@@ -42,11 +42,47 @@ void *array_get(const array * const a, size_t index) {
 }
 
 void array_fill(array * const a, void *val) {
-    void *p = a->data;
-    void *end = a->data + a->elem_size * a->size;
-    while (p != end) {
-        memcpy(p, val, a->elem_size);
-        p += a->elem_size;
-    }
+    elems_fill(a->data, a->size, a->elem_size, val);
+    STATS_ADD(a, bytes_copied, a->size * a->elem_size);
+}
+
+size_t array_find(const array * const a, void *val) {
+    size_t index = elems_find(a->data, a->size, a->elem_size, val);
+    STATS_ADD(a, node_visits, (index < a->size) ? index + 1 : index);
+    return index;
+}
+
+size_t array_count(const array * const a, void *val) {
+    STATS_ADD(a, node_visits, a->size);
+    return elems_count(a->data, a->size, a->elem_size, val);
+}
+
+void array_sort(array * const a, int (*comp)(void *a, void *b)) {
+    elems_sort(a->data, a->size, a->elem_size, comp);
+}
+
+void array_sort_ints(array * const a, bool is_signed) {
+    elems_sort_ints(a->data, a->size, a->elem_size, is_signed);
+}
+
+void array_parallel_sort(array * const a, int (*comp)(void *a, void *b), size_t threads) {
+    elems_parallel_sort(a->data, a->size, a->elem_size, comp, threads);
+}
+
+size_t array_lower_bound(const array * const a, void *val, int (*comp)(void *a, void *b)) {
+    return elems_lower_bound(a->data, a->size, a->elem_size, val, comp);
+}
+
+bool array_binary_search(const array * const a, void *val, int (*comp)(void *a, void *b)) {
+    size_t index = array_lower_bound(a, val, comp);
+    return index < a->size && comp(a->data + index * a->elem_size, val) == 0;
+}
+
+void array_stats(const array * const a, container_stats *out) {
+    STATS_GET(a, out);
+}
+
+void array_stats_reset(array * const a) {
+    STATS_RESET(a);
 }
 
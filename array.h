@@ -2,8 +2,16 @@
 #define ARRAY_H
 
 #include <stddef.h>     // size_t
+#include <stdbool.h>    // bool
 
-typedef struct array_t array;
+#include "stats.h"
+
+typedef struct array_t {
+    size_t size;
+    size_t elem_size;
+    void *data;
+    STATS_FIELD
+} array;
 
 array *array_init(size_t elem_size, size_t size);
 void array_del(array **a);
@@ -15,4 +23,23 @@ void *array_get(const array * const a, size_t index);
 
 void array_fill(array * const a, void* val);
 
+// index of the first elem whose bytes equal |val|'s, or the size if none do
+size_t array_find(const array * const a, void *val);
+size_t array_count(const array * const a, void *val);
+
+/*
+ * Sorts in place; see elems.h for the algorithms. array_sort_ints() needs
+ * elems that are 1, 2, 4 or 8-byte integers and uses no comparator.
+ */
+void array_sort(array * const a, int (*comp)(void *a, void *b));
+void array_sort_ints(array * const a, bool is_signed);
+void array_parallel_sort(array * const a, int (*comp)(void *a, void *b), size_t threads);
+
+// on a array sorted by |comp|: the first index whose elem is not less than |val|
+size_t array_lower_bound(const array * const a, void *val, int (*comp)(void *a, void *b));
+bool array_binary_search(const array * const a, void *val, int (*comp)(void *a, void *b));
+
+void array_stats(const array * const a, container_stats *out);
+void array_stats_reset(array * const a);
+
 #endif
@@ -0,0 +1,1002 @@
+#include <stdio.h>          // printf(), fflush()
+#include <stdlib.h>         // malloc(), free(), strtoull()
+#include <string.h>         // strcmp()
+#include <stdint.h>         // uint64_t
+#include <stdbool.h>        // bool
+#include <time.h>           // clock_gettime()
+#include <unistd.h>         // fork(), getpid()
+#include <sys/wait.h>       // waitpid()
+#include <sys/resource.h>   // getrusage()
+
+#include "array.h"
+#include "vector.h"
+#include "deque.h"
+#include "list.h"
+#include "stack.h"
+#include "queue.h"
+#include "pqueue.h"
+#include "spsc_queue.h"
+#include "mpmc_queue.h"
+#include "oset.h"
+#include "omap.h"
+#include "fset.h"
+#include "fmap.h"
+#include "uset.h"
+#include "umap.h"
+#include "cmap.h"
+#include "snapshot.h"
+#include "typed.h"
+
+/*
+ * Times each container operation over n elems for n = 1e3, 1e4, ... up to
+ * a maximum, inserting keys 0 to n - 1 either in order or shuffled. Every
+ * container and size runs in a child process of its own, so the peak RSS
+ * reported is that run's alone.
+ *
+ * usage: bench [-n max_n] [-json] [container ...]
+ */
+
+#define DEFAULT_MAX_N 10000000
+
+// allocator calls are counted by wrapping them at link time
+void *__real_malloc(size_t size);
+void *__real_calloc(size_t count, size_t size);
+void *__real_realloc(void *ptr, size_t size);
+void *__real_aligned_alloc(size_t align, size_t size);
+
+static size_t allocs;
+
+void *__wrap_malloc(size_t size) {
+    allocs++;
+    return __real_malloc(size);
+}
+
+void *__wrap_calloc(size_t count, size_t size) {
+    allocs++;
+    return __real_calloc(count, size);
+}
+
+void *__wrap_realloc(void *ptr, size_t size) {
+    allocs++;
+    return __real_realloc(ptr, size);
+}
+
+void *__wrap_aligned_alloc(size_t align, size_t size) {
+    allocs++;
+    return __real_aligned_alloc(align, size);
+}
+
+struct run_t {
+    const char *container;
+    const char *order;
+    size_t n;
+    int *keys;      // 0 to n - 1, in |order|
+
+    // set when a phase begins
+    double start;
+    size_t start_allocs;
+};
+
+struct bench_t {
+    const char *container;
+    void (*run)(struct run_t *r);
+};
+
+static bool json;
+static volatile size_t sink;    // keeps results from being optimized away
+
+static double now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static void begin(struct run_t *r) {
+    r->start_allocs = allocs;
+    r->start = now_ns();
+}
+
+// reports the phase begun last as |ops| operations of kind |op|
+static void end(struct run_t *r, const char *op, size_t ops) {
+    double ns = now_ns() - r->start;
+    size_t phase_allocs = allocs - r->start_allocs;
+    struct rusage usage;
+
+    getrusage(RUSAGE_SELF, &usage);
+
+    if (json) {
+        printf("{\"container\":\"%s\",\"op\":\"%s\",\"order\":\"%s\",\"n\":%zu,"
+                "\"ns_per_op\":%.2f,\"allocs\":%zu,\"peak_rss_kb\":%ld}\n",
+                r->container, op, r->order, r->n, ns / ops, phase_allocs, usage.ru_maxrss);
+    } else {
+        printf("%s,%s,%s,%zu,%.2f,%zu,%ld\n",
+                r->container, op, r->order, r->n, ns / ops, phase_allocs, usage.ru_maxrss);
+    }
+}
+
+static int comp_int(void *a, void *b) {
+    int x = *(int *)a, y = *(int *)b;
+    return (x > y) - (x < y);
+}
+
+#define CMP_INT(a, b) (((a) > (b)) - ((a) < (b)))
+
+DEFINE_VECTOR(int_vec, int)
+DEFINE_OSET(int_set, int, CMP_INT)
+DEFINE_OMAP(int_map, int, int, CMP_INT)
+
+static size_t hash_int(void *key) {
+    return (size_t)*(int *)key;     // the tables mix the bits themselves
+}
+
+static bool equal_int(void *a, void *b) {
+    return *(int *)a == *(int *)b;
+}
+
+static void bench_array(struct run_t *r) {
+    array *a = array_init(sizeof(int), r->n);
+    size_t i, sum = 0;
+
+    begin(r);
+    for (i = 0; i < r->n; i++) {
+        array_set(a, r->keys[i], &r->keys[i]);
+    }
+    end(r, "set", r->n);
+
+    begin(r);
+    for (i = 0; i < r->n; i++) {
+        sum += *(int *)array_get(a, r->keys[i]);
+    }
+    end(r, "get", r->n);
+
+    // the bulk ops below report time per elem
+    begin(r);
+    array_fill(a, &(int){ -1 });
+    end(r, "fill", r->n);
+
+    begin(r);
+    sum += array_find(a, &(int){ 0 });     // absent, so every elem is compared
+    end(r, "find", r->n);
+
+    begin(r);
+    sum += array_count(a, &(int){ -1 });
+    end(r, "count", r->n);
+
+    sink = sum;
+    array_del(&a);
+}
+
+static bool is_odd(void *elem, void *ctx) {
+    (void)ctx;
+    return *(int *)elem & 1;
+}
+
+static void bench_vector(struct run_t *r) {
+    vector *v = vector_init(sizeof(int));
+    size_t i, sum = 0;
+
+    begin(r);
+    for (i = 0; i < r->n; i++) {
+        vector_push_back(v, &r->keys[i]);
+    }
+    end(r, "push", r->n);
+
+    begin(r);
+    for (i = 0; i < r->n; i++) {
+        vector_set(v, r->keys[i], &r->keys[i]);
+    }
+    end(r, "set", r->n);
+
+    begin(r);
+    for (i = 0; i < r->n; i++) {
+        sum += *(int *)vector_get(v, r->keys[i]);
+    }
+    end(r, "get", r->n);
+
+    begin(r);
+    for (i = 0; i < r->n; i++) {
+        vector_pop_back(v);
+    }
+    end(r, "pop", r->n);
+
+    // the bulk edits report time per elem
+    begin(r);
+    vector_append(v, r->keys, r->n);
+    end(r, "append", r->n);
+
+    begin(r);
+    sum += vector_remove_if(v, is_odd, NULL);
+    end(r, "remove_if", r->n);
+
+    sink = sum;
+    vector_del(&v);
+}
+
+// |n| short-lived vectors of 8 elems each, reported per vector
+static void run_small_vectors(struct run_t *r, const char *op, size_t inline_bytes) {
+    size_t i, j, sum = 0;
+
+    begin(r);
+    for (i = 0; i < r->n; i++) {
+        vector *v = (inline_bytes > 0) ? vector_init_inline(sizeof(int), inline_bytes)
+                                       : vector_init(sizeof(int));
+
+        for (j = 0; j < 8; j++) {
+            vector_push_back(v, &r->keys[(i + j) % r->n]);
+        }
+        sum += *(int *)vector_get(v, 7);
+        vector_del(&v);
+    }
+    end(r, op, r->n);
+
+    sink = sum;
+}
+
+static void bench_vector_small(struct run_t *r) {
+    run_small_vectors(r, "heap", 0);
+    run_small_vectors(r, "inline", 8 * sizeof(int));
+}
+
+static void load_keys(vector * const v, struct run_t *r) {
+    size_t i;
+
+    for (i = 0; i < r->n; i++) {
+        vector_set(v, i, &r->keys[i]);
+    }
+}
+
+static void bench_vector_sort(struct run_t *r) {
+    vector *v = vector_init(sizeof(int));
+    size_t i, found = 0;
+
+    vector_reserve(v, r->n);
+    for (i = 0; i < r->n; i++) {
+        vector_push_back(v, &r->keys[i]);
+    }
+
+    // the sorts report time per elem
+    begin(r);
+    vector_sort(v, comp_int);
+    end(r, "sort", r->n);
+
+    load_keys(v, r);
+    begin(r);
+    vector_sort_ints(v, true);
+    end(r, "sort_ints", r->n);
+
+    load_keys(v, r);
+    begin(r);
+    vector_parallel_sort(v, comp_int, 0);
+    end(r, "parallel_sort", r->n);
+
+    begin(r);
+    for (i = 0; i < r->n; i++) {
+        found += vector_binary_search(v, &r->keys[i], comp_int);
+    }
+    end(r, "search", r->n);
+
+    sink = found;
+    vector_del(&v);
+}
+
+static void bench_int_vec(struct run_t *r) {
+    int_vec *v = int_vec_init();
+    size_t i, sum = 0;
+
+    begin(r);
+    for (i = 0; i < r->n; i++) {
+        int_vec_push_back(v, r->keys[i]);
+    }
+    end(r, "push", r->n);
+
+    begin(r);
+    for (i = 0; i < r->n; i++) {
+        int_vec_set(v, r->keys[i], r->keys[i]);
+    }
+    end(r, "set", r->n);
+
+    begin(r);
+    for (i = 0; i < r->n; i++) {
+        sum += int_vec_get(v, r->keys[i]);
+    }
+    end(r, "get", r->n);
+
+    begin(r);
+    for (i = 0; i < r->n; i++) {
+        int_vec_pop_back(v);
+    }
+    end(r, "pop", r->n);
+
+    sink = sum;
+    int_vec_del(&v);
+}
+
+static void bench_deque(struct run_t *r) {
+    deque *d = deque_init(sizeof(int));
+    size_t i, sum = 0;
+
+    begin(r);
+    for (i = 0; i < r->n; i++) {
+        deque_push_back(d, &r->keys[i]);
+    }
+    end(r, "push", r->n);
+
+    begin(r);
+    for (i = 0; i < r->n; i++) {
+        deque_set(d, r->keys[i], &r->keys[i]);
+    }
+    end(r, "set", r->n);
+
+    begin(r);
+    for (i = 0; i < r->n; i++) {
+        sum += *(int *)deque_get(d, r->keys[i]);
+    }
+    end(r, "get", r->n);
+
+    begin(r);
+    for (i = 0; i < r->n; i++) {
+        deque_pop_front(d);
+    }
+    end(r, "pop", r->n);
+
+    sink = sum;
+    deque_del(&d);
+}
+
+static void run_list(struct run_t *r, list *l) {
+    list_cursor c;
+    size_t i, sum = 0;
+
+    begin(r);
+    for (i = 0; i < r->n; i++) {
+        list_push_back(l, &r->keys[i]);
+    }
+    end(r, "push", r->n);
+
+    begin(r);
+    for (c = list_cursor_front(l); c.node != NULL; list_cursor_next(&c)) {
+        sum += *(int *)list_cursor_get(&c);
+    }
+    end(r, "walk", r->n);
+
+    begin(r);
+    for (i = 0; i < r->n; i++) {
+        list_pop_front(l);
+    }
+    end(r, "pop", r->n);
+
+    sink = sum;
+    list_del(&l);
+}
+
+static void bench_list(struct run_t *r) {
+    run_list(r, list_init(sizeof(int)));
+}
+
+static void bench_list_pooled(struct run_t *r) {
+    run_list(r, list_init_pooled(sizeof(int)));
+}
+
+static void bench_stack(struct run_t *r) {
+    stack *s = stack_init(sizeof(int));
+    size_t i;
+
+    begin(r);
+    for (i = 0; i < r->n; i++) {
+        stack_push(s, &r->keys[i]);
+    }
+    end(r, "push", r->n);
+
+    begin(r);
+    for (i = 0; i < r->n; i++) {
+        stack_pop(s);
+    }
+    end(r, "pop", r->n);
+
+    stack_del(&s);
+}
+
+static void bench_queue(struct run_t *r) {
+    queue *q = queue_init(sizeof(int));
+    size_t i;
+
+    begin(r);
+    for (i = 0; i < r->n; i++) {
+        queue_push(q, &r->keys[i]);
+    }
+    end(r, "push", r->n);
+
+    begin(r);
+    for (i = 0; i < r->n; i++) {
+        queue_pop(q);
+    }
+    end(r, "pop", r->n);
+
+    queue_del(&q);
+}
+
+static void run_pqueue(struct run_t *r, size_t arity) {
+    pqueue *q = pqueue_init(sizeof(int), arity, comp_int);
+    size_t *handles = malloc(r->n * sizeof(*handles));
+    size_t i, sum = 0;
+
+    begin(r);
+    for (i = 0; i < r->n; i++) {
+        pqueue_push(q, &r->keys[i]);
+    }
+    end(r, "push", r->n);
+
+    begin(r);
+    for (i = 0; i < r->n; i++) {
+        sum += *(int *)pqueue_top(q);
+        pqueue_pop(q);
+    }
+    end(r, "pop", r->n);
+
+    begin(r);
+    pqueue_push_n(q, r->keys, r->n);
+    end(r, "push_n", r->n);
+    pqueue_del(&q);
+
+    q = pqueue_init(sizeof(int), arity, comp_int);
+    begin(r);
+    for (i = 0; i < r->n; i++) {
+        handles[i] = pqueue_push_handle(q, &r->keys[i]);
+    }
+    end(r, "push_handle", r->n);
+
+    begin(r);
+    for (i = 0; i < r->n; i++) {
+        int val = r->keys[i] - (int)r->n;
+        pqueue_decrease_key(q, handles[i], &val);
+    }
+    end(r, "decrease_key", r->n);
+
+    begin(r);
+    for (i = 0; i < r->n; i++) {
+        pqueue_remove(q, handles[i]);
+    }
+    end(r, "remove", r->n);
+
+    sink = sum;
+    free(handles);
+    pqueue_del(&q);
+}
+
+static void bench_pqueue(struct run_t *r) {
+    run_pqueue(r, 2);
+}
+
+static void bench_pqueue_4ary(struct run_t *r) {
+    run_pqueue(r, 4);
+}
+
+// single-threaded, so this measures the cost of the atomics alone
+static void bench_spsc_queue(struct run_t *r) {
+    spsc_queue *q = spsc_queue_init(sizeof(int), r->n);
+    size_t i, sum = 0;
+    int val;
+
+    begin(r);
+    for (i = 0; i < r->n; i++) {
+        spsc_queue_push(q, &r->keys[i]);
+    }
+    end(r, "push", r->n);
+
+    begin(r);
+    for (i = 0; i < r->n; i++) {
+        spsc_queue_pop(q, &val);
+        sum += val;
+    }
+    end(r, "pop", r->n);
+
+    sink = sum;
+    spsc_queue_del(&q);
+}
+
+static void bench_mpmc_queue(struct run_t *r) {
+    mpmc_queue *q = mpmc_queue_init(sizeof(int), r->n);
+    size_t i, sum = 0;
+    int val;
+
+    begin(r);
+    for (i = 0; i < r->n; i++) {
+        mpmc_queue_push(q, &r->keys[i]);
+    }
+    end(r, "push", r->n);
+
+    begin(r);
+    for (i = 0; i < r->n; i++) {
+        mpmc_queue_pop(q, &val);
+        sum += val;
+    }
+    end(r, "pop", r->n);
+
+    sink = sum;
+    mpmc_queue_del(&q);
+}
+
+static void run_oset(struct run_t *r, oset *s) {
+    size_t i, found = 0;
+
+    begin(r);
+    for (i = 0; i < r->n; i++) {
+        oset_insert(s, &r->keys[i]);
+    }
+    end(r, "insert", r->n);
+
+    begin(r);
+    for (i = 0; i < r->n; i++) {
+        found += oset_contains(s, &r->keys[i]);
+    }
+    end(r, "lookup", r->n);
+
+    begin(r);
+    for (i = 0; i < r->n; i++) {
+        oset_remove(s, &r->keys[i]);
+    }
+    end(r, "remove", r->n);
+
+    sink = found;
+    oset_del(&s);
+}
+
+static void bench_oset(struct run_t *r) {
+    run_oset(r, oset_init(sizeof(int), comp_int));
+}
+
+static void bench_oset_pooled(struct run_t *r) {
+    run_oset(r, oset_init_pooled(sizeof(int), comp_int));
+}
+
+static void run_omap(struct run_t *r, omap *m) {
+    size_t i, sum = 0;
+
+    begin(r);
+    for (i = 0; i < r->n; i++) {
+        omap_insert(m, &r->keys[i], &r->keys[i]);
+    }
+    end(r, "insert", r->n);
+
+    begin(r);
+    for (i = 0; i < r->n; i++) {
+        sum += *(int *)omap_get(m, &r->keys[i]);
+    }
+    end(r, "lookup", r->n);
+
+    begin(r);
+    for (i = 0; i < r->n; i++) {
+        omap_remove(m, &r->keys[i]);
+    }
+    end(r, "remove", r->n);
+
+    sink = sum;
+    omap_del(&m);
+}
+
+static void bench_int_set(struct run_t *r) {
+    int_set *s = int_set_init();
+    size_t i, found = 0;
+
+    begin(r);
+    for (i = 0; i < r->n; i++) {
+        int_set_insert(s, r->keys[i]);
+    }
+    end(r, "insert", r->n);
+
+    begin(r);
+    for (i = 0; i < r->n; i++) {
+        found += int_set_contains(s, r->keys[i]);
+    }
+    end(r, "lookup", r->n);
+
+    begin(r);
+    for (i = 0; i < r->n; i++) {
+        int_set_remove(s, r->keys[i]);
+    }
+    end(r, "remove", r->n);
+
+    sink = found;
+    int_set_del(&s);
+}
+
+static void bench_omap(struct run_t *r) {
+    run_omap(r, omap_init(sizeof(int), sizeof(int), comp_int));
+}
+
+static void bench_omap_pooled(struct run_t *r) {
+    run_omap(r, omap_init_pooled(sizeof(int), sizeof(int), comp_int));
+}
+
+static void bench_omap_btree(struct run_t *r) {
+    run_omap(r, omap_init_btree(sizeof(int), sizeof(int), comp_int, 256));
+}
+
+// saves an omap, then maps it back and reads it in place
+static void bench_omap_snapshot(struct run_t *r) {
+    omap *m = omap_init(sizeof(int), sizeof(int), comp_int);
+    snapshot *s;
+    char path[64];
+    size_t i, sum = 0;
+
+    for (i = 0; i < r->n; i++) {
+        omap_insert(m, &r->keys[i], &r->keys[i]);
+    }
+    snprintf(path, sizeof(path), "/tmp/bench-%d.snapshot", (int)getpid());
+
+    // both report time per entry
+    begin(r);
+    omap_save(m, path);
+    end(r, "save", r->n);
+
+    begin(r);
+    s = omap_open_mmap(path, comp_int);
+    end(r, "open", r->n);
+
+    begin(r);
+    for (i = 0; i < r->n; i++) {
+        sum += *(int *)snapshot_get(s, &r->keys[i]);
+    }
+    end(r, "lookup", r->n);
+
+    sink = sum;
+    snapshot_close(&s);
+    remove(path);
+    omap_del(&m);
+}
+
+/*
+ * The flat containers move every later elem on a single insert or remove,
+ * so they are only built in bulk and read here.
+ */
+static void bench_fset(struct run_t *r) {
+    fset *s = fset_init(sizeof(int), comp_int);
+    size_t i, found = 0;
+
+    begin(r);
+    fset_insert_many(s, r->keys, r->n);
+    end(r, "insert_many", r->n);
+
+    begin(r);
+    for (i = 0; i < r->n; i++) {
+        found += fset_contains(s, &r->keys[i]);
+    }
+    end(r, "lookup", r->n);
+
+    sink = found;
+    fset_del(&s);
+}
+
+static void bench_fmap(struct run_t *r) {
+    fmap *m = fmap_init(sizeof(int), sizeof(int), comp_int);
+    size_t i, sum = 0;
+
+    begin(r);
+    fmap_insert_many(m, r->keys, r->keys, r->n);
+    end(r, "insert_many", r->n);
+
+    begin(r);
+    for (i = 0; i < r->n; i++) {
+        sum += *(int *)fmap_get(m, &r->keys[i]);
+    }
+    end(r, "lookup", r->n);
+
+    sink = sum;
+    fmap_del(&m);
+}
+
+static void bench_int_map(struct run_t *r) {
+    int_map *m = int_map_init();
+    size_t i, sum = 0;
+
+    begin(r);
+    for (i = 0; i < r->n; i++) {
+        int_map_insert(m, r->keys[i], r->keys[i]);
+    }
+    end(r, "insert", r->n);
+
+    begin(r);
+    for (i = 0; i < r->n; i++) {
+        sum += *int_map_ptr(m, r->keys[i]);
+    }
+    end(r, "lookup", r->n);
+
+    begin(r);
+    for (i = 0; i < r->n; i++) {
+        int_map_remove(m, r->keys[i]);
+    }
+    end(r, "remove", r->n);
+
+    sink = sum;
+    int_map_del(&m);
+}
+
+static void bench_uset(struct run_t *r) {
+    uset *s = uset_init(sizeof(int), hash_int, equal_int);
+    size_t i, found = 0;
+
+    begin(r);
+    for (i = 0; i < r->n; i++) {
+        uset_insert(s, &r->keys[i]);
+    }
+    end(r, "insert", r->n);
+
+    begin(r);
+    for (i = 0; i < r->n; i++) {
+        found += uset_contains(s, &r->keys[i]);
+    }
+    end(r, "lookup", r->n);
+
+    begin(r);
+    for (i = 0; i < r->n; i++) {
+        uset_remove(s, &r->keys[i]);
+    }
+    end(r, "remove", r->n);
+
+    sink = found;
+    uset_del(&s);
+}
+
+static void bench_umap(struct run_t *r) {
+    umap *m = umap_init(sizeof(int), sizeof(int), hash_int, equal_int);
+    size_t i, sum = 0;
+
+    begin(r);
+    for (i = 0; i < r->n; i++) {
+        umap_insert(m, &r->keys[i], &r->keys[i]);
+    }
+    end(r, "insert", r->n);
+
+    begin(r);
+    for (i = 0; i < r->n; i++) {
+        sum += *(int *)umap_get(m, &r->keys[i]);
+    }
+    end(r, "lookup", r->n);
+
+    begin(r);
+    for (i = 0; i < r->n; i++) {
+        umap_remove(m, &r->keys[i]);
+    }
+    end(r, "remove", r->n);
+
+    sink = sum;
+    umap_del(&m);
+}
+
+// single-threaded, so this measures the cost of the locks alone
+static void bench_cmap(struct run_t *r) {
+    cmap *m = cmap_init(sizeof(int), sizeof(int), hash_int, equal_int);
+    size_t i, sum = 0;
+    int val;
+
+    begin(r);
+    for (i = 0; i < r->n; i++) {
+        cmap_insert(m, &r->keys[i], &r->keys[i]);
+    }
+    end(r, "insert", r->n);
+
+    begin(r);
+    for (i = 0; i < r->n; i++) {
+        cmap_get(m, &r->keys[i], &val);
+        sum += val;
+    }
+    end(r, "lookup", r->n);
+
+    begin(r);
+    for (i = 0; i < r->n; i++) {
+        cmap_remove(m, &r->keys[i]);
+    }
+    end(r, "remove", r->n);
+
+    sink = sum;
+    cmap_del(&m);
+}
+
+/*
+ * Set operations take two sets of n elems sharing half of them, and
+ * report time per input elem.
+ */
+static void bench_oset_ops(struct run_t *r) {
+    oset *a = oset_init(sizeof(int), comp_int);
+    oset *b = oset_init(sizeof(int), comp_int);
+    oset *out;
+    size_t i;
+
+    for (i = 0; i < r->n; i++) {
+        int shifted = r->keys[i] + r->n / 2;
+        oset_insert(a, &r->keys[i]);
+        oset_insert(b, &shifted);
+    }
+
+    begin(r);
+    out = oset_union(a, b);
+    end(r, "union", 2 * r->n);
+    oset_del(&out);
+
+    begin(r);
+    out = oset_intxn(a, b);
+    end(r, "intxn", 2 * r->n);
+    oset_del(&out);
+
+    begin(r);
+    out = oset_diff(a, b);
+    end(r, "diff", 2 * r->n);
+    oset_del(&out);
+
+    oset_del(&a);
+    oset_del(&b);
+}
+
+static void bench_uset_ops(struct run_t *r) {
+    uset *a = uset_init(sizeof(int), hash_int, equal_int);
+    uset *b = uset_init(sizeof(int), hash_int, equal_int);
+    uset *out;
+    size_t i;
+
+    for (i = 0; i < r->n; i++) {
+        int shifted = r->keys[i] + r->n / 2;
+        uset_insert(a, &r->keys[i]);
+        uset_insert(b, &shifted);
+    }
+
+    begin(r);
+    out = uset_union(a, b);
+    end(r, "union", 2 * r->n);
+    uset_del(&out);
+
+    begin(r);
+    out = uset_intxn(a, b);
+    end(r, "intxn", 2 * r->n);
+    uset_del(&out);
+
+    begin(r);
+    out = uset_diff(a, b);
+    end(r, "diff", 2 * r->n);
+    uset_del(&out);
+
+    uset_del(&a);
+    uset_del(&b);
+}
+
+static const struct bench_t benches[] = {
+    { "array", bench_array },
+    { "vector", bench_vector },
+    { "vector_sort", bench_vector_sort },
+    { "vector_small", bench_vector_small },
+    { "int_vec", bench_int_vec },
+    { "deque", bench_deque },
+    { "list", bench_list },
+    { "list_pooled", bench_list_pooled },
+    { "stack", bench_stack },
+    { "queue", bench_queue },
+    { "pqueue", bench_pqueue },
+    { "pqueue_4ary", bench_pqueue_4ary },
+    { "spsc_queue", bench_spsc_queue },
+    { "mpmc_queue", bench_mpmc_queue },
+    { "oset", bench_oset },
+    { "oset_pooled", bench_oset_pooled },
+    { "int_set", bench_int_set },
+    { "omap", bench_omap },
+    { "omap_pooled", bench_omap_pooled },
+    { "omap_btree", bench_omap_btree },
+    { "omap_snapshot", bench_omap_snapshot },
+    { "int_map", bench_int_map },
+    { "fset", bench_fset },
+    { "fmap", bench_fmap },
+    { "uset", bench_uset },
+    { "umap", bench_umap },
+    { "cmap", bench_cmap },
+    { "oset_ops", bench_oset_ops },
+    { "uset_ops", bench_uset_ops },
+};
+
+static uint64_t next_random(uint64_t *state) {
+    // xorshift64*, seeded the same every run so results are comparable
+    *state ^= *state >> 12;
+    *state ^= *state << 25;
+    *state ^= *state >> 27;
+    return *state * 0x2545F4914F6CDD1Dull;
+}
+
+static int *make_keys(size_t n, bool shuffled) {
+    int *keys = malloc(n * sizeof(*keys));
+    uint64_t state = 0x9E3779B97F4A7C15ull;
+    size_t i;
+
+    for (i = 0; i < n; i++) {
+        keys[i] = (int)i;
+    }
+
+    if (shuffled) {
+        for (i = n - 1; i > 0; i--) {
+            size_t j = next_random(&state) % (i + 1);
+            int tmp = keys[i];
+            keys[i] = keys[j];
+            keys[j] = tmp;
+        }
+    }
+
+    return keys;
+}
+
+static bool selected(const char *container, int argc, char **argv, int first) {
+    int i;
+
+    if (first == argc) {
+        return true;
+    }
+
+    for (i = first; i < argc; i++) {
+        if (strcmp(argv[i], container) == 0) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+// runs |b| in a child process so each run starts from a fresh heap and RSS
+static void run_isolated(const struct bench_t *b, size_t n, bool shuffled) {
+    pid_t pid;
+
+    fflush(stdout);
+    pid = fork();
+
+    if (pid == 0) {
+        struct run_t r;
+        r.container = b->container;
+        r.order = shuffled ? "random" : "sequential";
+        r.n = n;
+        r.keys = make_keys(n, shuffled);
+
+        (*b->run)(&r);
+
+        free(r.keys);
+        fflush(stdout);
+        _exit(0);
+    } else if (pid > 0) {
+        waitpid(pid, NULL, 0);
+    } else {
+        perror("fork");
+        exit(1);
+    }
+}
+
+int main(int argc, char **argv) {
+    size_t max_n = DEFAULT_MAX_N;
+    int first = 1;
+    size_t i, n;
+
+    while (first < argc && argv[first][0] == '-') {
+        if (strcmp(argv[first], "-n") == 0 && first + 1 < argc) {
+            max_n = strtoull(argv[first + 1], NULL, 10);
+            first += 2;
+        } else if (strcmp(argv[first], "-json") == 0) {
+            json = true;
+            first++;
+        } else {
+            fprintf(stderr, "usage: %s [-n max_n] [-json] [container ...]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    if (!json) {
+        printf("container,op,order,n,ns_per_op,allocs,peak_rss_kb\n");
+    }
+
+    for (i = 0; i < sizeof(benches) / sizeof(benches[0]); i++) {
+        const struct bench_t *b = &benches[i];
+
+        if (!selected(b->container, argc, argv, first)) {
+            continue;
+        }
+
+        for (n = 1000; n <= max_n; n *= 10) {
+            run_isolated(b, n, false);
+            run_isolated(b, n, true);
+        }
+    }
+
+    return 0;
+}
+
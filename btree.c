@@ -0,0 +1,685 @@
+#include "btree.h"
+
+#include <stdlib.h>     // malloc(), free()
+#include <string.h>     // memcpy(), memmove()
+
+#define MIN_KEYS_PER_NODE 3
+
+/*
+ * A node holds up to |max_keys| entries, plus room for one more while it
+ * waits to be split. Inner nodes also hold |count| + 1 child pointers.
+ */
+struct btree_node_t {
+    struct btree_node_t *parent;
+    size_t count;
+    size_t total;   // entries in the subtree rooted here
+    bool leaf;
+    _Alignas(max_align_t) unsigned char data[];     // keys, values, children
+};
+
+// largest alignment a type of |size| bytes can require
+static size_t align_for(size_t size) {
+    size_t align = size & -size;
+
+    if (align == 0 || align > _Alignof(max_align_t)) {
+        align = _Alignof(max_align_t);
+    }
+
+    return align;
+}
+
+static size_t round_up(size_t n, size_t align) {
+    return (n + align - 1) / align * align;
+}
+
+static void *key_at(const btree * const b, struct btree_node_t *n, size_t i) {
+    return n->data + i * b->key_size;
+}
+
+static void *val_at(const btree * const b, struct btree_node_t *n, size_t i) {
+    return n->data + b->vals_offset + i * b->val_size;
+}
+
+static struct btree_node_t **children(const btree * const b, struct btree_node_t *n) {
+    return (struct btree_node_t **)(n->data + b->children_offset);
+}
+
+static int compare(const btree * const b, void *x, void *y) {
+    STATS_ADD(b, comparisons, 1);
+    return (*b->comp)(x, y);
+}
+
+#ifdef CONTAINERS_STATS
+// levels from the root to the leaves, which are all equally deep
+static size_t height(const btree * const b) {
+    struct btree_node_t *n = b->root;
+    size_t levels = 1;
+
+    while (!n->leaf) {
+        n = children(b, n)[0];
+        levels++;
+    }
+
+    return levels;
+}
+#endif
+
+static struct btree_node_t *node_init(const btree * const b, bool leaf) {
+    struct btree_node_t *n = malloc(sizeof(*n) + (leaf ? b->leaf_bytes : b->inner_bytes));
+    STATS_ADD(b, allocs, 1);
+    n->parent = NULL;
+    n->count = n->total = 0;
+    n->leaf = leaf;
+    return n;
+}
+
+static void subtree_del(const btree * const b, struct btree_node_t *n) {
+    if (!n->leaf) {
+        size_t i;
+
+        for (i = 0; i <= n->count; i++) {
+            subtree_del(b, children(b, n)[i]);
+        }
+    }
+
+    STATS_ADD(b, frees, 1);
+    free(n);
+}
+
+static struct btree_node_t *clone_subtree(const btree * const b,
+        struct btree_node_t *n, struct btree_node_t *parent) {
+    size_t bytes = sizeof(*n) + (n->leaf ? b->leaf_bytes : b->inner_bytes);
+    struct btree_node_t *clone = malloc(bytes);
+
+    memcpy(clone, n, bytes);
+    STATS_ADD(b, allocs, 1);
+    STATS_ADD(b, bytes_copied, bytes);
+    clone->parent = parent;
+
+    if (!n->leaf) {
+        size_t i;
+
+        for (i = 0; i <= n->count; i++) {
+            children(b, clone)[i] = clone_subtree(b, children(b, n)[i], clone);
+        }
+    }
+
+    return clone;
+}
+
+// index of the first key in |n| not before |key|; sets |*found| on a match
+static size_t node_search(const btree * const b, struct btree_node_t *n, void *key, bool *found) {
+    size_t lo = 0, hi = n->count;
+
+    STATS_ADD(b, node_visits, 1);
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+
+        if (compare(b, key_at(b, n, mid), key) < 0) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+
+    *found = (lo < n->count && compare(b, key_at(b, n, lo), key) == 0);
+    return lo;
+}
+
+static size_t child_index(const btree * const b, struct btree_node_t *parent, struct btree_node_t *n) {
+    size_t i = 0;
+
+    while (children(b, parent)[i] != n) {
+        i++;
+    }
+
+    return i;
+}
+
+static void set_child(const btree * const b, struct btree_node_t *n, size_t i, struct btree_node_t *child) {
+    children(b, n)[i] = child;
+    child->parent = n;
+}
+
+// adds |delta| to the totals of |n| and every node above it
+static void adjust_totals(struct btree_node_t *n, size_t delta) {
+    for (; n != NULL; n = n->parent) {
+        n->total += delta;
+    }
+}
+
+static size_t subtree_total(const btree * const b, struct btree_node_t *n) {
+    size_t total = n->count;
+    size_t i;
+
+    if (!n->leaf) {
+        for (i = 0; i <= n->count; i++) {
+            total += children(b, n)[i]->total;
+        }
+    }
+
+    return total;
+}
+
+// copies |count| entries from |src| at |si| to |dst| at |di|; ranges may overlap
+static void move_entries(const btree * const b, struct btree_node_t *dst, size_t di,
+        struct btree_node_t *src, size_t si, size_t count) {
+    memmove(key_at(b, dst, di), key_at(b, src, si), count * b->key_size);
+    memmove(val_at(b, dst, di), val_at(b, src, si), count * b->val_size);
+    STATS_ADD(b, bytes_copied, count * (b->key_size + b->val_size));
+}
+
+static void move_children(const btree * const b, struct btree_node_t *dst, size_t di,
+        struct btree_node_t *src, size_t si, size_t count) {
+    size_t i;
+
+    memmove(children(b, dst) + di, children(b, src) + si, count * sizeof(struct btree_node_t *));
+    for (i = di; i < di + count; i++) {
+        children(b, dst)[i]->parent = dst;
+    }
+}
+
+// puts an entry at |i| and, for inner nodes, |right| as child |i| + 1
+static void insert_at(const btree * const b, struct btree_node_t *n, size_t i,
+        void *key, void *val, struct btree_node_t *right) {
+    move_entries(b, n, i + 1, n, i, n->count - i);
+    memcpy(key_at(b, n, i), key, b->key_size);
+    memcpy(val_at(b, n, i), val, b->val_size);
+    STATS_ADD(b, bytes_copied, b->key_size + b->val_size);
+
+    if (!n->leaf) {
+        move_children(b, n, i + 2, n, i + 1, n->count - i);
+        set_child(b, n, i + 1, right);
+    }
+
+    n->count++;
+}
+
+// removes entry |i| and, for inner nodes, child |i| + 1
+static void erase_at(const btree * const b, struct btree_node_t *n, size_t i) {
+    move_entries(b, n, i, n, i + 1, n->count - i - 1);
+
+    if (!n->leaf) {
+        move_children(b, n, i + 1, n, i + 2, n->count - i - 1);
+    }
+
+    n->count--;
+}
+
+// moves the upper half of an overfull node into a new sibling; returns the parent
+static struct btree_node_t *split(btree * const b, struct btree_node_t *n) {
+    size_t mid = n->count / 2;
+    struct btree_node_t *right = node_init(b, n->leaf);
+    struct btree_node_t *parent = n->parent;
+
+    right->count = n->count - mid - 1;
+    move_entries(b, right, 0, n, mid + 1, right->count);
+    if (!n->leaf) {
+        move_children(b, right, 0, n, mid + 1, right->count + 1);
+    }
+    n->count = mid;
+
+    right->total = subtree_total(b, right);
+    n->total -= right->total + 1;
+
+    if (parent == NULL) {
+        parent = node_init(b, false);
+        parent->total = n->total + 1 + right->total;
+        set_child(b, parent, 0, n);
+        b->root = parent;
+        STATS_MAX(b, max_height, height(b));
+    }
+
+    // the median entry is still in place just past |n|'s new count
+    insert_at(b, parent, child_index(b, parent, n), key_at(b, n, mid), val_at(b, n, mid), right);
+    return parent;
+}
+
+// folds child |sep| + 1 of |parent| and separator |sep| into child |sep|
+static void merge(btree * const b, struct btree_node_t *parent, size_t sep) {
+    struct btree_node_t *left = children(b, parent)[sep];
+    struct btree_node_t *right = children(b, parent)[sep + 1];
+
+    move_entries(b, left, left->count, parent, sep, 1);
+    move_entries(b, left, left->count + 1, right, 0, right->count);
+    if (!left->leaf) {
+        move_children(b, left, left->count + 1, right, 0, right->count + 1);
+    }
+    left->count += 1 + right->count;
+    left->total += 1 + right->total;
+
+    erase_at(b, parent, sep);
+    STATS_ADD(b, frees, 1);
+    free(right);
+}
+
+// restores the minimum fill of |n| and its ancestors after an erase
+static void rebalance(btree * const b, struct btree_node_t *n) {
+    size_t min_keys = b->max_keys / 2;
+
+    while (n != b->root && n->count < min_keys) {
+        struct btree_node_t *parent = n->parent;
+        size_t i = child_index(b, parent, n);
+        struct btree_node_t *left = (i > 0) ? children(b, parent)[i - 1] : NULL;
+        struct btree_node_t *right = (i < parent->count) ? children(b, parent)[i + 1] : NULL;
+
+        if (left != NULL && left->count > min_keys) {    // borrow through the parent
+            size_t moved = 1;
+
+            move_entries(b, n, 1, n, 0, n->count);
+            move_entries(b, n, 0, parent, i - 1, 1);
+            move_entries(b, parent, i - 1, left, left->count - 1, 1);
+            if (!n->leaf) {
+                move_children(b, n, 1, n, 0, n->count + 1);
+                move_children(b, n, 0, left, left->count, 1);
+                moved += children(b, n)[0]->total;
+            }
+            left->count--;
+            left->total -= moved;
+            n->count++;
+            n->total += moved;
+            return;
+        } else if (right != NULL && right->count > min_keys) {
+            size_t moved = 1;
+
+            move_entries(b, n, n->count, parent, i, 1);
+            move_entries(b, parent, i, right, 0, 1);
+            move_entries(b, right, 0, right, 1, right->count - 1);
+            if (!n->leaf) {
+                move_children(b, n, n->count + 1, right, 0, 1);
+                move_children(b, right, 0, right, 1, right->count);
+                moved += children(b, n)[n->count + 1]->total;
+            }
+            right->count--;
+            right->total -= moved;
+            n->count++;
+            n->total += moved;
+            return;
+        }
+
+        merge(b, parent, (left != NULL) ? i - 1 : i);
+        n = parent;
+    }
+
+    if (b->root->count == 0 && !b->root->leaf) {    // the root's last entry moved down
+        struct btree_node_t *old = b->root;
+        b->root = children(b, old)[0];
+        b->root->parent = NULL;
+        STATS_ADD(b, frees, 1);
+        free(old);
+    }
+}
+
+btree *btree_init(size_t key_size, size_t val_size, int (*comp)(void *a, void *b), size_t node_bytes) {
+    struct btree_t *b = malloc(sizeof(*b));
+    size_t entry_bytes = key_size + val_size + sizeof(struct btree_node_t *);
+    size_t cap;
+
+    b->size = 0;
+    b->key_size = key_size;
+    b->val_size = val_size;
+    b->comp = comp;
+
+    b->max_keys = (node_bytes > sizeof(struct btree_node_t))
+            ? (node_bytes - sizeof(struct btree_node_t)) / entry_bytes : 0;
+    if (b->max_keys < MIN_KEYS_PER_NODE) {
+        b->max_keys = MIN_KEYS_PER_NODE;
+    }
+
+    cap = b->max_keys + 1;
+    b->vals_offset = round_up(cap * key_size, align_for(val_size));
+    b->leaf_bytes = b->vals_offset + cap * val_size;
+    b->children_offset = round_up(b->leaf_bytes, _Alignof(struct btree_node_t *));
+    b->inner_bytes = b->children_offset + (cap + 1) * sizeof(struct btree_node_t *);
+
+    STATS_INIT(b);
+    b->root = node_init(b, true);
+    b->scratch = malloc(key_size);
+    return b;
+}
+
+btree *btree_clone(const btree * const b) {
+    struct btree_t *clone = malloc(sizeof(*clone));
+
+    memcpy(clone, b, sizeof(*clone));
+    STATS_INIT(clone);
+    clone->root = clone_subtree(clone, b->root, NULL);
+    clone->scratch = malloc(b->key_size);
+    return clone;
+}
+
+void btree_del(btree **b) {
+    if (*b != NULL) {
+        subtree_del(*b, (*b)->root);
+        free((*b)->scratch);
+        STATS_DEL(*b);
+        free(*b);
+        *b = NULL;
+    }
+}
+
+size_t btree_size(const btree * const b) {
+    return b->size;
+}
+
+void *btree_key(const btree * const b, struct btree_pos_t pos) {
+    return (pos.node == NULL) ? NULL : key_at(b, pos.node, pos.index);
+}
+
+void *btree_val(const btree * const b, struct btree_pos_t pos) {
+    return (pos.node == NULL) ? NULL : val_at(b, pos.node, pos.index);
+}
+
+struct btree_pos_t btree_find(const btree * const b, void *key) {
+    struct btree_pos_t pos = { b->root, 0 };
+    bool found;
+
+    while (true) {
+        pos.index = node_search(b, pos.node, key, &found);
+
+        if (found) {
+            return pos;
+        } else if (pos.node->leaf) {
+            pos.node = NULL;    // |key| is not in the tree
+            return pos;
+        }
+
+        pos.node = children(b, pos.node)[pos.index];
+    }
+}
+
+bool btree_insert(btree * const b, void *key, void *val) {
+    struct btree_node_t *n = b->root;
+    size_t i;
+    bool found;
+
+    while (true) {
+        i = node_search(b, n, key, &found);
+
+        if (found) {
+            return false;
+        } else if (n->leaf) {
+            break;
+        }
+
+        n = children(b, n)[i];
+    }
+
+    insert_at(b, n, i, key, val, NULL);
+    adjust_totals(n, 1);
+    b->size++;
+
+    while (n->count > b->max_keys) {
+        n = split(b, n);
+    }
+
+    return true;
+}
+
+bool btree_remove(btree * const b, void *key) {
+    struct btree_pos_t pos = btree_find(b, key);
+    struct btree_node_t *n = pos.node;
+
+    if (n == NULL) {
+        return false;
+    }
+
+    if (!n->leaf) {     // trade places with the predecessor, which is in a leaf
+        struct btree_node_t *leaf = children(b, n)[pos.index];
+
+        while (!leaf->leaf) {
+            leaf = children(b, leaf)[leaf->count];
+        }
+
+        move_entries(b, n, pos.index, leaf, leaf->count - 1, 1);
+        n = leaf;
+        pos.index = leaf->count - 1;
+    }
+
+    erase_at(b, n, pos.index);
+    adjust_totals(n, (size_t)-1);
+    b->size--;
+    rebalance(b, n);
+    return true;
+}
+
+/*
+ * Erases the entry at |pos| and moves |pos| to the entry after it.
+ * Rebalancing may shift entries between nodes, so the next entry is found
+ * again by key.
+ */
+void btree_erase(btree * const b, struct btree_pos_t *pos) {
+    memcpy(b->scratch, key_at(b, pos->node, pos->index), b->key_size);
+    btree_remove(b, b->scratch);
+    *pos = btree_higher(b, b->scratch);
+}
+
+struct btree_pos_t btree_first(const btree * const b) {
+    struct btree_pos_t pos = { b->root, 0 };
+
+    while (!pos.node->leaf) {
+        pos.node = children(b, pos.node)[0];
+    }
+
+    if (pos.node->count == 0) {
+        pos.node = NULL;
+    }
+
+    return pos;
+}
+
+struct btree_pos_t btree_last(const btree * const b) {
+    struct btree_pos_t pos = { b->root, 0 };
+
+    while (!pos.node->leaf) {
+        pos.node = children(b, pos.node)[pos.node->count];
+    }
+
+    if (pos.node->count == 0) {
+        pos.node = NULL;
+    } else {
+        pos.index = pos.node->count - 1;
+    }
+
+    return pos;
+}
+
+struct btree_pos_t btree_lower(const btree * const b, void *key) {
+    struct btree_pos_t lo = { NULL, 0 };
+    struct btree_node_t *n = b->root;
+
+    // every entry found deeper is after the ones found above it
+    while (n != NULL) {
+        bool found;
+        size_t i = node_search(b, n, key, &found);
+
+        if (i > 0) {
+            lo.node = n;
+            lo.index = i - 1;
+        }
+
+        n = n->leaf ? NULL : children(b, n)[i];
+    }
+
+    return lo;  // greatest entry before |key|
+}
+
+struct btree_pos_t btree_higher(const btree * const b, void *key) {
+    struct btree_pos_t hi = { NULL, 0 };
+    struct btree_node_t *n = b->root;
+
+    // every entry found deeper is before the ones found above it
+    while (n != NULL) {
+        bool found;
+        size_t i = node_search(b, n, key, &found);
+
+        if (found) {
+            i++;
+        }
+
+        if (i < n->count) {
+            hi.node = n;
+            hi.index = i;
+        }
+
+        n = n->leaf ? NULL : children(b, n)[i];
+    }
+
+    return hi;  // least entry after |key|
+}
+
+struct btree_pos_t btree_seek(const btree * const b, void *key) {
+    struct btree_pos_t at = { NULL, 0 };
+    struct btree_node_t *n = b->root;
+
+    while (n != NULL) {
+        bool found;
+        size_t i = node_search(b, n, key, &found);
+
+        if (i < n->count) {
+            at.node = n;
+            at.index = i;
+        }
+
+        if (found) {
+            break;
+        }
+
+        n = n->leaf ? NULL : children(b, n)[i];
+    }
+
+    return at;  // least entry not before |key|
+}
+
+// number of keys in |b| before |key|
+size_t btree_rank(const btree * const b, void *key) {
+    struct btree_node_t *n = b->root;
+    size_t rank = 0;
+
+    while (true) {
+        bool found;
+        size_t i = node_search(b, n, key, &found);
+        size_t j;
+
+        rank += i;
+        if (n->leaf) {
+            return rank;
+        }
+
+        for (j = 0; j < i; j++) {
+            rank += children(b, n)[j]->total;
+        }
+
+        if (found) {
+            return rank + children(b, n)[i]->total;
+        }
+
+        n = children(b, n)[i];
+    }
+}
+
+// entry with |k| keys before it, or a NULL position if |k| is not less than the size
+struct btree_pos_t btree_select(const btree * const b, size_t k) {
+    struct btree_pos_t pos = { NULL, 0 };
+    struct btree_node_t *n = b->root;
+
+    if (k >= n->total) {
+        return pos;
+    }
+
+    while (true) {
+        size_t i;
+
+        if (n->leaf) {
+            pos.node = n;
+            pos.index = k;
+            return pos;
+        }
+
+        // skip whole subtrees, each followed by one separator
+        for (i = 0; k >= children(b, n)[i]->total; i++) {
+            k -= children(b, n)[i]->total;
+
+            if (k == 0) {
+                pos.node = n;
+                pos.index = i;
+                return pos;
+            }
+            k--;
+        }
+
+        n = children(b, n)[i];
+    }
+}
+
+void btree_next(const btree * const b, struct btree_pos_t *pos) {
+    struct btree_node_t *n = pos->node;
+
+    if (!n->leaf) {     // leftmost entry of the right subtree
+        n = children(b, n)[pos->index + 1];
+        while (!n->leaf) {
+            n = children(b, n)[0];
+        }
+        pos->node = n;
+        pos->index = 0;
+    } else if (pos->index + 1 < n->count) {
+        pos->index++;
+    } else {    // climb until coming up from a child with an entry after it
+        while (n->parent != NULL) {
+            size_t i = child_index(b, n->parent, n);
+            n = n->parent;
+
+            if (i < n->count) {
+                pos->node = n;
+                pos->index = i;
+                return;
+            }
+        }
+
+        pos->node = NULL;
+    }
+}
+
+void btree_prev(const btree * const b, struct btree_pos_t *pos) {
+    struct btree_node_t *n = pos->node;
+
+    if (!n->leaf) {     // rightmost entry of the left subtree
+        n = children(b, n)[pos->index];
+        while (!n->leaf) {
+            n = children(b, n)[n->count];
+        }
+        pos->node = n;
+        pos->index = n->count - 1;
+    } else if (pos->index > 0) {
+        pos->index--;
+    } else {
+        while (n->parent != NULL) {
+            size_t i = child_index(b, n->parent, n);
+            n = n->parent;
+
+            if (i > 0) {
+                pos->node = n;
+                pos->index = i - 1;
+                return;
+            }
+        }
+
+        pos->node = NULL;
+    }
+}
+
+void btree_stats(const btree * const b, container_stats *out) {
+    STATS_GET(b, out);
+
+#ifdef CONTAINERS_STATS
+    out->height = height(b);
+    if (out->height > out->max_height) {
+        out->max_height = out->height;
+    }
+#endif
+}
+
+void btree_stats_reset(btree * const b) {
+    STATS_RESET(b);
+}
+
@@ -0,0 +1,75 @@
+#ifndef BTREE_H
+#define BTREE_H
+
+#include <stddef.h>     // size_t
+#include <stdbool.h>    // bool
+
+#include "stats.h"
+
+/*
+ * B-tree backend for omap. Each node keeps its keys sorted in one array,
+ * its values in a parallel array, and is sized to span a few cache lines,
+ * so a lookup takes one binary search per level over a much shallower
+ * tree than a binary one.
+ *
+ * Entries move between nodes as the tree changes, so pointers to keys and
+ * values are only valid until the next insert or remove.
+ */
+
+struct btree_node_t;
+
+typedef struct btree_t {
+    size_t size;
+    size_t key_size, val_size;
+    size_t max_keys;
+    size_t vals_offset, children_offset;    // byte offsets within a node
+    size_t leaf_bytes, inner_bytes;
+    struct btree_node_t *root;
+    void *scratch;      // holds a key while its entry is being erased
+
+    /*
+     * < 0    *a before *b
+     * 0      *a and *b equivalent
+     * > 0    *a after *b
+     */
+    int (*comp)(void *a, void *b);
+
+    STATS_FIELD
+} btree;
+
+// an entry's position; |node| is NULL past either end of the tree
+struct btree_pos_t {
+    struct btree_node_t *node;
+    size_t index;
+};
+
+btree *btree_init(size_t key_size, size_t val_size, int (*comp)(void *a, void *b), size_t node_bytes);
+btree *btree_clone(const btree * const b);
+void btree_del(btree **b);
+
+size_t btree_size(const btree * const b);
+
+void *btree_key(const btree * const b, struct btree_pos_t pos);
+void *btree_val(const btree * const b, struct btree_pos_t pos);
+
+struct btree_pos_t btree_find(const btree * const b, void *key);
+bool btree_insert(btree * const b, void *key, void *val);
+bool btree_remove(btree * const b, void *key);
+void btree_erase(btree * const b, struct btree_pos_t *pos);
+
+struct btree_pos_t btree_first(const btree * const b);
+struct btree_pos_t btree_last(const btree * const b);
+struct btree_pos_t btree_lower(const btree * const b, void *key);
+struct btree_pos_t btree_higher(const btree * const b, void *key);
+struct btree_pos_t btree_seek(const btree * const b, void *key);
+
+size_t btree_rank(const btree * const b, void *key);
+struct btree_pos_t btree_select(const btree * const b, size_t k);
+
+void btree_next(const btree * const b, struct btree_pos_t *pos);
+void btree_prev(const btree * const b, struct btree_pos_t *pos);
+
+void btree_stats(const btree * const b, container_stats *out);
+void btree_stats_reset(btree * const b);
+
+#endif
@@ -0,0 +1,237 @@
+#include "cmap.h"
+
+#include <stdlib.h>     // malloc(), aligned_alloc(), free()
+#include <string.h>     // memcpy()
+#include <stdint.h>     // uint64_t
+#include <pthread.h>    // pthread_rwlock_t, pthread_rwlock_*()
+
+#include "htable.h"
+
+#define CACHE_LINE 64
+#define SHARD_BITS 6
+
+#ifdef CONTAINERS_STATS
+// lookups bump the shard's counters, so they cannot share its lock
+#define LOOKUP_LOCK(lock) pthread_rwlock_wrlock(lock)
+#else
+#define LOOKUP_LOCK(lock) pthread_rwlock_rdlock(lock)
+#endif
+
+// padded to a cache line so locking one shard never slows its neighbours
+struct shard_t {
+    _Alignas(CACHE_LINE) pthread_rwlock_t lock;
+    htable *h;
+    void *scratch;      // value being built by cmap_compute()
+};
+
+struct concurrent_map_t {
+    size_t val_size;
+    size_t (*hash)(void *key);
+    struct shard_t *shards;
+};
+
+/*
+ * Each operation hashes its key once, here, and hands the hash on to the
+ * shard's table with the htable_*_hashed() calls.
+ */
+static struct shard_t *shard_for(const cmap * const m, size_t hash) {
+    uint64_t bits = hash;
+
+    /*
+     * The shard tables place keys by the high bits of a multiplied hash,
+     * so pick the shard from the low bits, folded down to mix in the rest.
+     */
+    bits ^= bits >> 32;
+    bits ^= bits >> 16;
+    return &m->shards[bits & (((size_t)1 << SHARD_BITS) - 1)];
+}
+
+static bool shard_get(const cmap * const m, struct shard_t *s, void *key, size_t hash, void *out) {
+    unsigned char *slot;
+
+    LOOKUP_LOCK(&s->lock);
+    slot = htable_find_hashed(s->h, key, hash);
+    if (slot != NULL) {
+        memcpy(out, slot + s->h->val_offset, m->val_size);
+    }
+    pthread_rwlock_unlock(&s->lock);
+
+    return slot != NULL;
+}
+
+cmap *cmap_init(size_t key_size, size_t val_size,
+        size_t (*hash)(void *key), bool (*equal)(void *a, void *b)) {
+    struct concurrent_map_t *m = malloc(sizeof(*m));
+    size_t i;
+
+    m->val_size = val_size;
+    m->hash = hash;
+    m->shards = aligned_alloc(CACHE_LINE, sizeof(*m->shards) << SHARD_BITS);
+
+    for (i = 0; i < (size_t)1 << SHARD_BITS; i++) {
+        pthread_rwlock_init(&m->shards[i].lock, NULL);
+        m->shards[i].h = htable_init(key_size, val_size, hash, equal);
+        m->shards[i].scratch = malloc(val_size > 0 ? val_size : 1);
+    }
+
+    return m;
+}
+
+// no other thread may still be using |*m|
+void cmap_del(cmap **m) {
+    if (*m != NULL) {
+        size_t i;
+
+        for (i = 0; i < (size_t)1 << SHARD_BITS; i++) {
+            pthread_rwlock_destroy(&(*m)->shards[i].lock);
+            htable_del(&(*m)->shards[i].h);
+            free((*m)->shards[i].scratch);
+        }
+
+        free((*m)->shards);
+        free(*m);
+        *m = NULL;
+    }
+}
+
+// each shard is counted at a different instant while updates go on
+size_t cmap_size(cmap * const m) {
+    size_t size = 0;
+    size_t i;
+
+    for (i = 0; i < (size_t)1 << SHARD_BITS; i++) {
+        pthread_rwlock_rdlock(&m->shards[i].lock);
+        size += htable_size(m->shards[i].h);
+        pthread_rwlock_unlock(&m->shards[i].lock);
+    }
+
+    return size;
+}
+
+// copies the value for |key| into |out| if there is one
+bool cmap_get(cmap * const m, void *key, void *out) {
+    size_t hash = (*m->hash)(key);
+    return shard_get(m, shard_for(m, hash), key, hash, out);
+}
+
+bool cmap_contains(cmap * const m, void *key) {
+    size_t hash = (*m->hash)(key);
+    struct shard_t *s = shard_for(m, hash);
+    bool found;
+
+    LOOKUP_LOCK(&s->lock);
+    found = htable_find_hashed(s->h, key, hash) != NULL;
+    pthread_rwlock_unlock(&s->lock);
+
+    return found;
+}
+
+bool cmap_insert(cmap * const m, void *key, void *val) {
+    size_t hash = (*m->hash)(key);
+    struct shard_t *s = shard_for(m, hash);
+    bool inserted;
+
+    pthread_rwlock_wrlock(&s->lock);
+    inserted = htable_insert_hashed(s->h, key, val, hash);
+    pthread_rwlock_unlock(&s->lock);
+
+    return inserted;
+}
+
+bool cmap_remove(cmap * const m, void *key) {
+    size_t hash = (*m->hash)(key);
+    struct shard_t *s = shard_for(m, hash);
+    bool removed;
+
+    pthread_rwlock_wrlock(&s->lock);
+    removed = htable_remove_hashed(s->h, key, hash);
+    pthread_rwlock_unlock(&s->lock);
+
+    return removed;
+}
+
+/*
+ * Inserts |val| under |key| unless |key| is already present, then copies
+ * whichever value the map ends up holding into |out|. Returns true if
+ * |val| was inserted.
+ */
+bool cmap_get_or_insert(cmap * const m, void *key, void *val, void *out) {
+    size_t hash = (*m->hash)(key);
+    struct shard_t *s = shard_for(m, hash);
+    unsigned char *slot;
+    bool inserted = false;
+
+    // most calls find the key, which needs only the shared lock
+    if (shard_get(m, s, key, hash, out)) {
+        return false;
+    }
+
+    pthread_rwlock_wrlock(&s->lock);
+    slot = htable_find_hashed(s->h, key, hash);
+    if (slot == NULL) {
+        htable_insert_hashed(s->h, key, val, hash);
+        memcpy(out, val, m->val_size);
+        inserted = true;
+    } else {
+        memcpy(out, slot + s->h->val_offset, m->val_size);
+    }
+    pthread_rwlock_unlock(&s->lock);
+
+    return inserted;
+}
+
+/*
+ * Runs |update| on the entry for |key| with no other thread able to touch
+ * it. |val| points at the stored value when |found|, and at uninitialized
+ * space otherwise; |update| may change it in place and returns whether
+ * |key| should be in the map afterwards.
+ */
+void cmap_compute(cmap * const m, void *key,
+        bool (*update)(void *key, void *val, bool found, void *arg), void *arg) {
+    size_t hash = (*m->hash)(key);
+    struct shard_t *s = shard_for(m, hash);
+    unsigned char *slot;
+
+    pthread_rwlock_wrlock(&s->lock);
+    slot = htable_find_hashed(s->h, key, hash);
+    if (slot != NULL) {
+        if (!(*update)(key, slot + s->h->val_offset, true, arg)) {
+            htable_remove_hashed(s->h, key, hash);
+        }
+    } else if ((*update)(key, s->scratch, false, arg)) {
+        htable_insert_hashed(s->h, key, s->scratch, hash);
+    }
+    pthread_rwlock_unlock(&s->lock);
+}
+
+// sums the counters of every shard
+void cmap_stats(cmap * const m, container_stats *out) {
+    container_stats shard;
+    size_t i;
+
+    memset(out, 0, sizeof(*out));
+
+    for (i = 0; i < (size_t)1 << SHARD_BITS; i++) {
+        pthread_rwlock_rdlock(&m->shards[i].lock);
+        htable_stats(m->shards[i].h, &shard);
+        pthread_rwlock_unlock(&m->shards[i].lock);
+
+        out->comparisons += shard.comparisons;
+        out->allocs += shard.allocs;
+        out->frees += shard.frees;
+        out->reallocs += shard.reallocs;
+        out->bytes_copied += shard.bytes_copied;
+        out->node_visits += shard.node_visits;
+    }
+}
+
+void cmap_stats_reset(cmap * const m) {
+    size_t i;
+
+    for (i = 0; i < (size_t)1 << SHARD_BITS; i++) {
+        pthread_rwlock_wrlock(&m->shards[i].lock);
+        htable_stats_reset(m->shards[i].h);
+        pthread_rwlock_unlock(&m->shards[i].lock);
+    }
+}
+
@@ -0,0 +1,39 @@
+#ifndef CMAP_H
+#define CMAP_H
+
+#include <stddef.h>     // size_t
+#include <stdbool.h>    // bool
+
+#include "stats.h"
+
+/*
+ * Unordered map that any number of threads may use at once. Entries are
+ * spread over shards by hash, each an open-addressing hash table behind
+ * its own reader/writer lock, so lookups never wait on one another and
+ * updates only wait on others to the same shard.
+ *
+ * Keys and values are copied in and out; no pointer into the map is ever
+ * handed back, since another thread could move or free the entry.
+ */
+
+typedef struct concurrent_map_t cmap;
+
+cmap *cmap_init(size_t key_size, size_t val_size,
+        size_t (*hash)(void *key), bool (*equal)(void *a, void *b));
+void cmap_del(cmap **m);
+
+size_t cmap_size(cmap * const m);
+
+bool cmap_get(cmap * const m, void *key, void *out);
+bool cmap_contains(cmap * const m, void *key);
+bool cmap_insert(cmap * const m, void *key, void *val);
+bool cmap_remove(cmap * const m, void *key);
+
+bool cmap_get_or_insert(cmap * const m, void *key, void *val, void *out);
+void cmap_compute(cmap * const m, void *key,
+        bool (*update)(void *key, void *val, bool found, void *arg), void *arg);
+
+void cmap_stats(cmap * const m, container_stats *out);
+void cmap_stats_reset(cmap * const m);
+
+#endif
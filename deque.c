@@ -1,38 +1,203 @@
 #include "deque.h"
 
+#include <stdlib.h>     // malloc(), calloc(), free()
+#include <string.h>     // memcpy()
+
+#define BLOCK_BYTES 512
+#define MIN_BLOCK_LEN 16
+#define INIT_MAP_CAP 8
+
+static size_t block_len(const deque * const d) {
+    return (size_t)1 << d->block_shift;
+}
+
+static void *pos_addr(const deque * const d, size_t pos) {
+    return d->map[pos >> d->block_shift] + (pos & (block_len(d) - 1)) * d->elem_size;
+}
+
+static void *block_alloc(deque * const d) {
+    void *b = d->spare;
+
+    if (b == NULL) {
+        b = malloc(block_len(d) * d->elem_size);
+        STATS_ADD(d, allocs, 1);
+    } else {
+        d->spare = NULL;
+    }
+
+    return b;
+}
+
+static void block_free(deque * const d, void *b) {
+    // keeping one block back stops a push/pop pair at a block edge from thrashing
+    if (d->spare == NULL) {
+        d->spare = b;
+    } else {
+        free(b);
+        STATS_ADD(d, frees, 1);
+    }
+}
+
+// recentres the blocks in use, doubling the map if it is at least half full
+static void map_grow(deque * const d) {
+    size_t first = d->start >> d->block_shift;
+    size_t used = (d->size == 0) ? 0 : ((d->start + d->size - 1) >> d->block_shift) - first + 1;
+    size_t new_cap = (used * 2 >= d->map_cap) ? d->map_cap * 2 : d->map_cap;
+    size_t new_first = (new_cap - used) / 2;
+    void **map = calloc(new_cap, sizeof(*map));
+
+    memcpy(map + new_first, d->map + first, used * sizeof(*map));
+    free(d->map);
+    STATS_ADD(d, reallocs, 1);
+    STATS_ADD(d, bytes_copied, used * sizeof(*map));
+
+    d->map = map;
+    d->map_cap = new_cap;
+    d->start = (new_first << d->block_shift) + (d->start & (block_len(d) - 1));
+}
+
 deque *deque_init(size_t elem_size) {
-    return list_init(elem_size);
+    struct deque_t *d;
+
+    // no number of empty elems would fill a block
+    if (elem_size == 0) {
+        return NULL;
+    }
+
+    d = malloc(sizeof(*d));
+    d->size = 0;
+    d->elem_size = elem_size;
+
+    d->block_shift = 0;
+    while (block_len(d) < MIN_BLOCK_LEN || block_len(d) * elem_size < BLOCK_BYTES) {
+        d->block_shift++;
+    }
+
+    d->map_cap = INIT_MAP_CAP;
+    d->map = calloc(d->map_cap, sizeof(*d->map));
+    d->start = (d->map_cap / 2) << d->block_shift;
+    d->spare = NULL;
+
+    STATS_INIT(d);
+    STATS_ADD(d, allocs, 1);
+    return d;
 }
 
 void deque_del(deque **d) {
-    list_del(d);
+    if (*d != NULL) {
+        size_t i;
+
+        for (i = 0; i < (*d)->map_cap; i++) {
+            free((*d)->map[i]);
+        }
+
+        free((*d)->map);
+        free((*d)->spare);
+        STATS_DEL(*d);
+        free(*d);
+        *d = NULL;
+    }
 }
 
 size_t deque_size(const deque * const d) {
-    return list_size(d);
+    return d->size;
+}
+
+void deque_set(deque * const d, size_t index, void *val) {
+    void *p = deque_get(d, index);
+
+    if (p) {    // |index| is within bounds
+        memcpy(p, val, d->elem_size);
+        STATS_ADD(d, bytes_copied, d->elem_size);
+    }
+}
+
+void *deque_get(const deque * const d, size_t index) {
+    if (index < d->size) {
+        return pos_addr(d, d->start + index);
+    } else {
+        return NULL;
+    }
 }
 
 void *deque_front(const deque * const d) {
-    return list_front(d);
+    return deque_get(d, 0);
 }
 
 void *deque_back(const deque * const d) {
-    return list_back(d);
+    return deque_get(d, d->size - 1);
 }
 
 void deque_push_front(deque * const d, void *val) {
-    list_push_front(d, val);
+    size_t block;
+
+    if (d->start == 0) {
+        map_grow(d);
+    }
+
+    d->start--;
+    block = d->start >> d->block_shift;
+    if (d->map[block] == NULL) {
+        d->map[block] = block_alloc(d);
+    }
+
+    memcpy(pos_addr(d, d->start), val, d->elem_size);
+    STATS_ADD(d, bytes_copied, d->elem_size);
+    d->size++;
 }
 
 void deque_pop_front(deque * const d) {
-    list_pop_front(d);
+    if (d->size > 0) {
+        size_t block = d->start >> d->block_shift;
+
+        d->start++;
+        d->size--;
+
+        // free the block once its last elem is gone
+        if (d->size == 0 || (d->start >> d->block_shift) != block) {
+            block_free(d, d->map[block]);
+            d->map[block] = NULL;
+        }
+    }
 }
 
 void deque_push_back(deque * const d, void *val) {
-    list_push_back(d, val);
+    size_t pos = d->start + d->size;
+    size_t block;
+
+    if ((pos >> d->block_shift) >= d->map_cap) {
+        map_grow(d);
+        pos = d->start + d->size;
+    }
+
+    block = pos >> d->block_shift;
+    if (d->map[block] == NULL) {
+        d->map[block] = block_alloc(d);
+    }
+
+    memcpy(pos_addr(d, pos), val, d->elem_size);
+    STATS_ADD(d, bytes_copied, d->elem_size);
+    d->size++;
 }
 
 void deque_pop_back(deque * const d) {
-    list_pop_back(d);
+    if (d->size > 0) {
+        size_t block = (d->start + d->size - 1) >> d->block_shift;
+
+        d->size--;
+
+        if (d->size == 0 || ((d->start + d->size - 1) >> d->block_shift) != block) {
+            block_free(d, d->map[block]);
+            d->map[block] = NULL;
+        }
+    }
+}
+
+void deque_stats(const deque * const d, container_stats *out) {
+    STATS_GET(d, out);
+}
+
+void deque_stats_reset(deque * const d) {
+    STATS_RESET(d);
 }
 
@@ -3,15 +3,36 @@
 
 #include <stddef.h>     // size_t
 
-#include "list.h"
-
-typedef list deque;
-
+#include "stats.h"
+
+/*
+ * Elems live in fixed-size blocks reached through |map|, an array of block
+ * pointers. Pushing at either end only ever allocates a new block or a
+ * larger map, so elems never move once written.
+ *
+ * The layout is public so the typed deques in typed.h can find an elem's
+ * block without a call.
+ */
+typedef struct deque_t {
+    size_t size;
+    size_t elem_size;
+    size_t block_shift;     // each block holds 2^|block_shift| elems
+    void **map;
+    size_t map_cap;
+    size_t start;           // position of the front elem, counted from map[0]
+    void *spare;            // an emptied block kept for reuse
+    STATS_FIELD
+} deque;
+
+// returns NULL if |elem_size| is 0
 deque *deque_init(size_t elem_size);
 void deque_del(deque **d);
 
 size_t deque_size(const deque * const d);
 
+void deque_set(deque * const d, size_t index, void *val);
+void *deque_get(const deque * const d, size_t index);
+
 void *deque_front(const deque * const d);
 void *deque_back(const deque * const d);
 
@@ -21,4 +42,7 @@ void deque_pop_front(deque * const d);
 void deque_push_back(deque * const d, void *val);
 void deque_pop_back(deque * const d);
 
+void deque_stats(const deque * const d, container_stats *out);
+void deque_stats_reset(deque * const d);
+
 #endif
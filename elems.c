@@ -0,0 +1,739 @@
+#include "elems.h"
+
+#include <stdbool.h>    // bool
+#include <stdint.h>     // uint*_t, int*_t
+#include <stdlib.h>     // malloc(), free()
+#include <string.h>     // memcpy(), memset(), memcmp(), memmove()
+#include <pthread.h>    // pthread_create(), pthread_join()
+#include <unistd.h>     // sysconf()
+
+#if defined(__x86_64__) && defined(__GNUC__)
+#define ELEMS_X86 1
+#include <immintrin.h>
+#endif
+
+// fills grow a copied prefix up to this many bytes, then stamp it out
+#define FILL_CHUNK 4096
+
+// introsort leaves runs this short to insertion sort
+#define INSERTION_MAX 16
+
+// parallel sorts give each thread at least this many elems
+#define PARALLEL_MIN_RUN 16384
+
+void elems_fill(void *data, size_t n, size_t elem_size, const void *val) {
+    unsigned char *p = data;
+    size_t total = n * elem_size;
+    size_t done, chunk;
+
+    if (n == 0) {
+        return;
+    } else if (elem_size == 1) {
+        memset(p, *(const unsigned char *)val, n);
+        return;
+    }
+
+    /*
+     * Doubling the filled prefix turns one memcpy() per elem into a few
+     * large ones. The prefix stops growing once it is a chunk that stays
+     * in L1, so stamping it out only ever reads from cache.
+     */
+    memcpy(p, val, elem_size);
+    for (done = elem_size; done < total && done < FILL_CHUNK; done += chunk) {
+        chunk = (done < total - done) ? done : total - done;
+        memcpy(p + done, p, chunk);
+    }
+
+    chunk = done;
+    while (done < total) {
+        size_t len = (chunk < total - done) ? chunk : total - done;
+        memcpy(p + done, p, len);
+        done += len;
+    }
+}
+
+/*
+ * find and count share one scan, which stops at the first match unless it
+ * is counting. Each returns the index or the count as appropriate.
+ */
+
+static size_t scan_bytes(const unsigned char *p, size_t from, size_t n,
+        size_t elem_size, const void *val, bool count) {
+    size_t i, hits = 0;
+
+    for (i = from; i < n; i++) {
+        if (memcmp(p + i * elem_size, val, elem_size) == 0) {
+            if (!count) {
+                return i;
+            }
+            hits++;
+        }
+    }
+
+    return count ? hits : n;
+}
+
+#ifdef ELEMS_X86
+
+/*
+ * A byte-wise movemask of an elem-wise compare sets all |elem_size| bits
+ * of an equal elem, so keeping one bit per elem leaves a bit per match.
+ * 8-byte elems are compared as two 4-byte halves under SSE2, which has no
+ * 64-bit compare, so both halves' bits must be set.
+ */
+static const uint32_t lead_bits[9] = {
+    [1] = 0xFFFFFFFF, [2] = 0x55555555, [4] = 0x11111111, [8] = 0x01010101,
+};
+
+static uint64_t load_val(const void *val, size_t elem_size) {
+    uint8_t b;
+    uint16_t h;
+    uint32_t w;
+    uint64_t d;
+
+    switch (elem_size) {
+        case 1: memcpy(&b, val, 1); return b;
+        case 2: memcpy(&h, val, 2); return h;
+        case 4: memcpy(&w, val, 4); return w;
+        default: memcpy(&d, val, 8); return d;
+    }
+}
+
+static size_t scan_sse2(const unsigned char *p, size_t n, size_t elem_size,
+        const void *val, bool count) {
+    uint64_t x = load_val(val, elem_size);
+    uint32_t lead = lead_bits[elem_size] & 0xFFFF;
+    size_t bytes = n * elem_size, i, hits = 0;
+    __m128i v;
+
+    switch (elem_size) {
+        case 1: v = _mm_set1_epi8((char)x); break;
+        case 2: v = _mm_set1_epi16((short)x); break;
+        case 4: v = _mm_set1_epi32((int)x); break;
+        default: v = _mm_set1_epi64x((long long)x); break;
+    }
+
+    for (i = 0; i + 16 <= bytes; i += 16) {
+        __m128i chunk = _mm_loadu_si128((const __m128i *)(p + i));
+        __m128i eq;
+        uint32_t m;
+
+        switch (elem_size) {
+            case 1: eq = _mm_cmpeq_epi8(chunk, v); break;
+            case 2: eq = _mm_cmpeq_epi16(chunk, v); break;
+            default: eq = _mm_cmpeq_epi32(chunk, v); break;
+        }
+
+        m = (uint32_t)_mm_movemask_epi8(eq);
+        if (elem_size == 8) {
+            m &= m >> 4;
+        }
+        m &= lead;
+
+        if (count) {
+            hits += __builtin_popcount(m);
+        } else if (m != 0) {
+            return (i + __builtin_ctz(m)) / elem_size;
+        }
+    }
+
+    if (count) {
+        return hits + scan_bytes(p, i / elem_size, n, elem_size, val, true);
+    }
+    return scan_bytes(p, i / elem_size, n, elem_size, val, false);
+}
+
+__attribute__((target("avx2,popcnt")))
+static size_t scan_avx2(const unsigned char *p, size_t n, size_t elem_size,
+        const void *val, bool count) {
+    uint64_t x = load_val(val, elem_size);
+    uint32_t lead = lead_bits[elem_size];
+    size_t bytes = n * elem_size, i, hits = 0;
+    __m256i v;
+
+    switch (elem_size) {
+        case 1: v = _mm256_set1_epi8((char)x); break;
+        case 2: v = _mm256_set1_epi16((short)x); break;
+        case 4: v = _mm256_set1_epi32((int)x); break;
+        default: v = _mm256_set1_epi64x((long long)x); break;
+    }
+
+    for (i = 0; i + 32 <= bytes; i += 32) {
+        __m256i chunk = _mm256_loadu_si256((const __m256i *)(p + i));
+        __m256i eq;
+        uint32_t m;
+
+        switch (elem_size) {
+            case 1: eq = _mm256_cmpeq_epi8(chunk, v); break;
+            case 2: eq = _mm256_cmpeq_epi16(chunk, v); break;
+            case 4: eq = _mm256_cmpeq_epi32(chunk, v); break;
+            default: eq = _mm256_cmpeq_epi64(chunk, v); break;
+        }
+
+        m = (uint32_t)_mm256_movemask_epi8(eq) & lead;
+
+        if (count) {
+            hits += __builtin_popcount(m);
+        } else if (m != 0) {
+            return (i + __builtin_ctz(m)) / elem_size;
+        }
+    }
+
+    if (count) {
+        return hits + scan_bytes(p, i / elem_size, n, elem_size, val, true);
+    }
+    return scan_bytes(p, i / elem_size, n, elem_size, val, false);
+}
+
+#endif
+
+static size_t scan(const void *data, size_t n, size_t elem_size,
+        const void *val, bool count) {
+#ifdef ELEMS_X86
+    if (elem_size == 1 || elem_size == 2 || elem_size == 4 || elem_size == 8) {
+        // SSE2 is part of x86-64, AVX2 has to be checked for
+        if (__builtin_cpu_supports("avx2")) {
+            return scan_avx2(data, n, elem_size, val, count);
+        }
+        return scan_sse2(data, n, elem_size, val, count);
+    }
+#endif
+
+    return scan_bytes(data, 0, n, elem_size, val, count);
+}
+
+size_t elems_find(const void *data, size_t n, size_t elem_size, const void *val) {
+    return scan(data, n, elem_size, val, false);
+}
+
+size_t elems_count(const void *data, size_t n, size_t elem_size, const void *val) {
+    return scan(data, n, elem_size, val, true);
+}
+
+struct sorter_t {
+    unsigned char *base;
+    size_t elem_size;
+    int (*comp)(void *a, void *b);
+    unsigned char *tmp;     // room for one elem
+};
+
+static inline unsigned char *at(const struct sorter_t * const s, size_t i) {
+    return s->base + i * s->elem_size;
+}
+
+static inline int compare(const struct sorter_t * const s, size_t i, size_t j) {
+    return s->comp(at(s, i), at(s, j));
+}
+
+#define SWAP_AS(T, a, b) \
+    do { \
+        T t_; \
+        memcpy(&t_, a, sizeof(T)); \
+        memcpy(a, b, sizeof(T)); \
+        memcpy(b, &t_, sizeof(T)); \
+    } while (0)
+
+static void swap(const struct sorter_t * const s, size_t i, size_t j) {
+    unsigned char buf[64];
+    unsigned char *a = at(s, i), *b = at(s, j);
+    size_t left = s->elem_size;
+
+    // common sizes swap in registers instead of through |buf|
+    if (left == 4) {
+        SWAP_AS(uint32_t, a, b);
+        return;
+    } else if (left == 8) {
+        SWAP_AS(uint64_t, a, b);
+        return;
+    }
+
+    while (left > 0) {
+        size_t len = (left < sizeof(buf)) ? left : sizeof(buf);
+        memcpy(buf, a, len);
+        memcpy(a, b, len);
+        memcpy(b, buf, len);
+        a += len;
+        b += len;
+        left -= len;
+    }
+}
+
+static void insertion_sort(const struct sorter_t * const s, size_t lo, size_t hi) {
+    size_t i, j;
+
+    for (i = lo + 1; i < hi; i++) {
+        if (compare(s, i - 1, i) <= 0) {
+            continue;
+        }
+
+        // shift the larger elems up in one move rather than swapping down
+        memcpy(s->tmp, at(s, i), s->elem_size);
+        for (j = i - 1; j > lo && s->comp(at(s, j - 1), s->tmp) > 0; j--) {
+        }
+
+        memmove(at(s, j + 1), at(s, j), (i - j) * s->elem_size);
+        memcpy(at(s, j), s->tmp, s->elem_size);
+    }
+}
+
+static void sift_down(const struct sorter_t * const s, size_t lo, size_t i, size_t n) {
+    size_t child;
+
+    while ((child = 2 * i + 1) < n) {
+        if (child + 1 < n && compare(s, lo + child, lo + child + 1) < 0) {
+            child++;
+        }
+
+        if (compare(s, lo + i, lo + child) >= 0) {
+            break;
+        }
+
+        swap(s, lo + i, lo + child);
+        i = child;
+    }
+}
+
+static void heap_sort(const struct sorter_t * const s, size_t lo, size_t hi) {
+    size_t n = hi - lo, i;
+
+    for (i = n / 2; i > 0; i--) {
+        sift_down(s, lo, i - 1, n);
+    }
+
+    for (i = n - 1; i > 0; i--) {
+        swap(s, lo, lo + i);
+        sift_down(s, lo, 0, i);
+    }
+}
+
+/*
+ * Hoare partition around the median of the first, middle and last elems,
+ * which is parked at |lo| and so also stops the downward scan. Both scans
+ * stop on elems equal to the pivot, which keeps runs of duplicates split
+ * evenly. Returns the pivot's final index.
+ */
+static size_t partition(const struct sorter_t * const s, size_t lo, size_t hi) {
+    size_t mid = lo + (hi - lo) / 2, last = hi - 1;
+    size_t i = lo, j = hi;
+
+    if (compare(s, mid, lo) < 0) {
+        swap(s, mid, lo);
+    }
+    if (compare(s, last, mid) < 0) {
+        swap(s, last, mid);
+        if (compare(s, mid, lo) < 0) {
+            swap(s, mid, lo);
+        }
+    }
+    swap(s, lo, mid);
+
+    for (;;) {
+        do {
+            i++;
+        } while (i < hi && compare(s, i, lo) < 0);
+
+        do {
+            j--;
+        } while (compare(s, j, lo) > 0);
+
+        if (i >= j) {
+            break;
+        }
+        swap(s, i, j);
+    }
+
+    swap(s, lo, j);
+    return j;
+}
+
+static void intro_sort(const struct sorter_t * const s, size_t lo, size_t hi, int depth) {
+    while (hi - lo > INSERTION_MAX) {
+        size_t p;
+
+        if (depth-- == 0) {
+            heap_sort(s, lo, hi);
+            return;
+        }
+
+        // recurse into the smaller side so the stack stays O(log n)
+        p = partition(s, lo, hi);
+        if (p - lo < hi - p) {
+            intro_sort(s, lo, p, depth);
+            lo = p + 1;
+        } else {
+            intro_sort(s, p + 1, hi, depth);
+            hi = p;
+        }
+    }
+
+    insertion_sort(s, lo, hi);
+}
+
+static void sort_with(void *data, size_t n, size_t elem_size,
+        int (*comp)(void *a, void *b), unsigned char *tmp) {
+    struct sorter_t s = { data, elem_size, comp, tmp };
+    int depth = 0;
+    size_t m;
+
+    for (m = n; m > 1; m >>= 1) {
+        depth += 2;
+    }
+
+    intro_sort(&s, 0, n, depth);
+}
+
+void elems_sort(void *data, size_t n, size_t elem_size, int (*comp)(void *a, void *b)) {
+    unsigned char *tmp;
+
+    if (n < 2 || (tmp = malloc(elem_size)) == NULL) {
+        return;
+    }
+
+    sort_with(data, n, elem_size, comp, tmp);
+    free(tmp);
+}
+
+/*
+ * The integer comparators back elems_sort_ints() when it cannot get the
+ * scratch buffer a radix sort needs.
+ */
+
+#define INT_COMP(name, T) \
+    static int name(void *a, void *b) { \
+        T x = *(T *)a, y = *(T *)b; \
+        return (x > y) - (x < y); \
+    }
+
+INT_COMP(comp_u8, uint8_t)
+INT_COMP(comp_u16, uint16_t)
+INT_COMP(comp_u32, uint32_t)
+INT_COMP(comp_u64, uint64_t)
+INT_COMP(comp_i8, int8_t)
+INT_COMP(comp_i16, int16_t)
+INT_COMP(comp_i32, int32_t)
+INT_COMP(comp_i64, int64_t)
+
+static int (*int_comp(size_t elem_size, bool is_signed))(void *, void *) {
+    switch (elem_size) {
+        case 1: return is_signed ? comp_i8 : comp_u8;
+        case 2: return is_signed ? comp_i16 : comp_u16;
+        case 4: return is_signed ? comp_i32 : comp_u32;
+        default: return is_signed ? comp_i64 : comp_u64;
+    }
+}
+
+static void swap_bufs(unsigned char **a, unsigned char **b) {
+    unsigned char *t = *a;
+    *a = *b;
+    *b = t;
+}
+
+/*
+ * One counting pass per byte, least significant first, ping-ponging
+ * between |data| and |buf|. All the histograms are taken in a single read
+ * up front, and a byte that is the same in every elem costs no pass. Signed
+ * elems sort as unsigned with the top byte's sign bit flipped.
+ */
+// one pass's scatter, with the elem copies sized at compile time
+#define SCATTER_AS(T) \
+    for (i = 0; i < n; i++) { \
+        const unsigned char *e = src + i * sizeof(T); \
+        memcpy(dst + offsets[e[byte] ^ flip]++ * sizeof(T), e, sizeof(T)); \
+    }
+
+static void radix_sort(unsigned char *data, size_t n, size_t elem_size,
+        bool is_signed, unsigned char *buf) {
+    size_t counts[8][256] = { { 0 } };
+    unsigned char *src = data, *dst = buf;
+    size_t i, b;
+
+    for (i = 0; i < n; i++) {
+        const unsigned char *e = data + i * elem_size;
+        for (b = 0; b < elem_size; b++) {
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+            counts[b][e[elem_size - 1 - b]]++;
+#else
+            counts[b][e[b]]++;
+#endif
+        }
+    }
+
+    for (b = 0; b < elem_size; b++) {
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+        size_t byte = elem_size - 1 - b;
+#else
+        size_t byte = b;
+#endif
+        unsigned flip = (is_signed && b == elem_size - 1) ? 0x80 : 0;
+        size_t offsets[256], sum = 0;
+        unsigned d;
+
+        if (counts[b][src[byte]] == n) {
+            continue;
+        }
+
+        for (d = 0; d < 256; d++) {
+            offsets[d] = counts[b][d ^ flip];
+        }
+        for (d = 0; d < 256; d++) {
+            size_t c = offsets[d];
+            offsets[d] = sum;
+            sum += c;
+        }
+
+        switch (elem_size) {
+            case 1: SCATTER_AS(uint8_t); break;
+            case 2: SCATTER_AS(uint16_t); break;
+            case 4: SCATTER_AS(uint32_t); break;
+            default: SCATTER_AS(uint64_t); break;
+        }
+
+        swap_bufs(&src, &dst);
+    }
+
+    if (src != data) {
+        memcpy(data, src, n * elem_size);
+    }
+}
+
+void elems_sort_ints(void *data, size_t n, size_t elem_size, bool is_signed) {
+    unsigned char *buf;
+
+    if (n < 2 || (elem_size != 1 && elem_size != 2 && elem_size != 4 && elem_size != 8)) {
+        return;
+    }
+
+    // small inputs do not repay the histogram and the scratch buffer
+    if (n <= INSERTION_MAX * 4) {
+        elems_sort(data, n, elem_size, int_comp(elem_size, is_signed));
+    } else if ((buf = malloc(n * elem_size)) != NULL) {
+        radix_sort(data, n, elem_size, is_signed, buf);
+        free(buf);
+    } else {
+        elems_sort(data, n, elem_size, int_comp(elem_size, is_signed));
+    }
+}
+
+/*
+ * A parallel sort first sorts one run per thread in place, then merges
+ * neighbouring runs pairwise, each merge on its own thread, bouncing
+ * between |data| and a scratch buffer until one run is left.
+ */
+
+struct run_t {
+    unsigned char *src, *dst;   // runs are read from |src| and merged into |dst|
+    size_t lo, mid, hi;         // sort [lo, hi), or merge [lo, mid) with [mid, hi)
+    size_t elem_size;
+    int (*comp)(void *a, void *b);
+    unsigned char *tmp;
+};
+
+static void *sort_run(void *arg) {
+    struct run_t *r = arg;
+
+    sort_with(r->src + r->lo * r->elem_size, r->hi - r->lo, r->elem_size, r->comp, r->tmp);
+    return NULL;
+}
+
+static void *merge_runs(void *arg) {
+    struct run_t *r = arg;
+    size_t size = r->elem_size;
+    unsigned char *a = r->src + r->lo * size, *a_end = r->src + r->mid * size;
+    unsigned char *b = a_end, *b_end = r->src + r->hi * size;
+    unsigned char *out = r->dst + r->lo * size;
+
+    while (a != a_end && b != b_end) {
+        // take from the left run on ties so merging is stable
+        if (r->comp(b, a) < 0) {
+            memcpy(out, b, size);
+            b += size;
+        } else {
+            memcpy(out, a, size);
+            a += size;
+        }
+        out += size;
+    }
+
+    memcpy(out, a, a_end - a);
+    memcpy(out + (a_end - a), b, b_end - b);
+    return NULL;
+}
+
+// runs each job on its own thread, or on this one if a thread can't start
+static void run_all(struct run_t *jobs, size_t n, void *(*fn)(void *)) {
+    pthread_t threads[n];
+    bool started[n];
+    size_t i;
+
+    for (i = 1; i < n; i++) {
+        started[i] = pthread_create(&threads[i], NULL, fn, &jobs[i]) == 0;
+        if (!started[i]) {
+            fn(&jobs[i]);
+        }
+    }
+
+    fn(&jobs[0]);
+
+    for (i = 1; i < n; i++) {
+        if (started[i]) {
+            pthread_join(threads[i], NULL);
+        }
+    }
+}
+
+void elems_parallel_sort(void *data, size_t n, size_t elem_size,
+        int (*comp)(void *a, void *b), size_t threads) {
+    unsigned char *buf, *tmp, *src = data, *dst;
+    size_t bounds[65], runs, i;
+
+    if (threads == 0) {
+        long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        threads = (cpus > 0) ? (size_t)cpus : 1;
+    }
+    if (threads > 64) {
+        threads = 64;
+    }
+    if (threads > n / PARALLEL_MIN_RUN) {
+        threads = n / PARALLEL_MIN_RUN;
+    }
+
+    if (threads < 2) {
+        elems_sort(data, n, elem_size, comp);
+        return;
+    }
+
+    buf = malloc(n * elem_size);
+    tmp = malloc(threads * elem_size);
+    if (buf == NULL || tmp == NULL) {
+        free(buf);
+        free(tmp);
+        elems_sort(data, n, elem_size, comp);
+        return;
+    }
+
+    struct run_t jobs[threads];
+
+    runs = threads;
+    for (i = 0; i <= runs; i++) {
+        bounds[i] = n / runs * i + ((i < n % runs) ? i : n % runs);
+    }
+
+    for (i = 0; i < runs; i++) {
+        jobs[i] = (struct run_t){ src, NULL, bounds[i], 0, bounds[i + 1],
+                                  elem_size, comp, tmp + i * elem_size };
+    }
+    run_all(jobs, runs, sort_run);
+
+    dst = buf;
+    while (runs > 1) {
+        size_t merges = runs / 2;
+
+        for (i = 0; i < merges; i++) {
+            jobs[i] = (struct run_t){ src, dst, bounds[2 * i], bounds[2 * i + 1],
+                                      bounds[2 * i + 2], elem_size, comp, NULL };
+        }
+        run_all(jobs, merges, merge_runs);
+
+        // an odd run out is carried over to the next round as it is
+        if (runs % 2 == 1) {
+            memcpy(dst + bounds[runs - 1] * elem_size, src + bounds[runs - 1] * elem_size,
+                   (bounds[runs] - bounds[runs - 1]) * elem_size);
+        }
+
+        for (i = 0; i <= merges; i++) {
+            bounds[i] = bounds[2 * i];
+        }
+        runs = merges + runs % 2;
+        bounds[runs] = n;
+
+        swap_bufs(&src, &dst);
+    }
+
+    if (src != data) {
+        memcpy(data, src, n * elem_size);
+    }
+
+    free(buf);
+    free(tmp);
+}
+
+void elems_stable_sort(void *data, size_t n, size_t elem_size, int (*comp)(void *a, void *b)) {
+    unsigned char *buf, *tmp, *src = data, *dst;
+    struct sorter_t s = { data, elem_size, comp, NULL };
+    size_t width, lo;
+
+    if (n < 2 || (tmp = malloc(elem_size)) == NULL) {
+        return;
+    }
+
+    s.tmp = tmp;
+    buf = malloc(n * elem_size);
+    if (buf == NULL) {
+        insertion_sort(&s, 0, n);   // stable too, if quadratic
+        free(tmp);
+        return;
+    }
+
+    // insertion sort short runs, then merge them bottom-up
+    for (lo = 0; lo < n; lo += INSERTION_MAX) {
+        insertion_sort(&s, lo, (n - lo < INSERTION_MAX) ? n : lo + INSERTION_MAX);
+    }
+
+    dst = buf;
+    for (width = INSERTION_MAX; width < n; width *= 2) {
+        for (lo = 0; lo < n; lo += 2 * width) {
+            struct run_t r = { src, dst, lo, (n - lo < width) ? n : lo + width,
+                               (n - lo < 2 * width) ? n : lo + 2 * width, elem_size, comp, NULL };
+            merge_runs(&r);
+        }
+
+        swap_bufs(&src, &dst);
+    }
+
+    if (src != data) {
+        memcpy(data, src, n * elem_size);
+    }
+
+    free(buf);
+    free(tmp);
+}
+
+size_t elems_unique(void *data, size_t n, size_t elem_size, int (*comp)(void *a, void *b)) {
+    unsigned char *p = data;
+    size_t i, kept = (n > 0);
+
+    for (i = 1; i < n; i++) {
+        if (comp(p + (kept - 1) * elem_size, p + i * elem_size) != 0) {
+            if (kept != i) {
+                memcpy(p + kept * elem_size, p + i * elem_size, elem_size);
+            }
+            kept++;
+        }
+    }
+
+    return kept;
+}
+
+size_t elems_lower_bound(const void *data, size_t n, size_t elem_size, void *val,
+        int (*comp)(void *a, void *b)) {
+    const unsigned char *base = data;
+
+    if (n == 0) {
+        return 0;
+    }
+
+    /*
+     * Halve the range without branching on the comparison, so the search
+     * costs no mispredictions; the answer stays within [base, base + n].
+     */
+    while (n > 1) {
+        size_t half = n / 2;
+        const unsigned char *mid = base + half * elem_size;
+
+        base = (comp((void *)mid, val) < 0) ? mid : base;
+        n -= half;
+    }
+
+    return (base - (const unsigned char *)data) / elem_size + (comp((void *)base, val) < 0);
+}
+
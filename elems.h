@@ -0,0 +1,49 @@
+#ifndef ELEMS_H
+#define ELEMS_H
+
+#include <stddef.h>     // size_t
+#include <stdbool.h>    // bool
+
+/*
+ * Bulk operations over |n| packed elems of |elem_size| bytes each, shared
+ * by the array and vector. Elems compare equal when their bytes do, so
+ * padding inside struct elems must be zeroed for find and count to match.
+ *
+ * Elems of 1, 2, 4 or 8 bytes are compared a vector register at a time,
+ * with AVX2 used when the CPU running the code has it; other sizes fall
+ * back to memcmp().
+ */
+
+void elems_fill(void *data, size_t n, size_t elem_size, const void *val);
+
+// index of the first elem equal to |val|, or |n| if there is none
+size_t elems_find(const void *data, size_t n, size_t elem_size, const void *val);
+size_t elems_count(const void *data, size_t n, size_t elem_size, const void *val);
+
+/*
+ * Sorting is in place. elems_sort() is an introsort, so it is not stable
+ * but never goes quadratic. elems_sort_ints() is an LSD radix sort for
+ * elems that are 1, 2, 4 or 8-byte integers; other sizes are left as they
+ * are. elems_parallel_sort() sorts runs on up to |threads| threads, or one
+ * per online CPU if |threads| is 0, and merges them; below a few tens of
+ * thousands of elems it is the same as elems_sort().
+ */
+void elems_sort(void *data, size_t n, size_t elem_size, int (*comp)(void *a, void *b));
+void elems_sort_ints(void *data, size_t n, size_t elem_size, bool is_signed);
+void elems_parallel_sort(void *data, size_t n, size_t elem_size,
+        int (*comp)(void *a, void *b), size_t threads);
+
+// a merge sort that keeps equal elems in their original order
+void elems_stable_sort(void *data, size_t n, size_t elem_size, int (*comp)(void *a, void *b));
+
+/*
+ * On sorted elems: elems_unique() keeps the first of each run of equal
+ * elems, packed at the front, and returns how many there are.
+ * elems_lower_bound() returns the index of the first elem not less than
+ * |val|, with a binary search that does not branch on the comparisons.
+ */
+size_t elems_unique(void *data, size_t n, size_t elem_size, int (*comp)(void *a, void *b));
+size_t elems_lower_bound(const void *data, size_t n, size_t elem_size, void *val,
+        int (*comp)(void *a, void *b));
+
+#endif
@@ -0,0 +1,284 @@
+#include "fmap.h"
+
+#include <stdlib.h>     // malloc(), free()
+#include <string.h>     // memcpy(), memmove()
+
+#include "vector.h"
+#include "elems.h"
+
+struct flat_map_t {
+    // keys in strictly increasing order, and the value of each at the same index
+    vector *keys, *vals;
+    int (*comp)(void *a, void *b);
+};
+
+static inline void *key_at(const fmap * const m, size_t i) {
+    return (unsigned char *)m->keys->data + i * m->keys->elem_size;
+}
+
+static inline void *val_at(const fmap * const m, size_t i) {
+    return (unsigned char *)m->vals->data + i * m->vals->elem_size;
+}
+
+// index of the first key not before |key|
+static size_t seek(const fmap * const m, void *key) {
+    return elems_lower_bound(m->keys->data, m->keys->size, m->keys->elem_size, key, m->comp);
+}
+
+static bool holds(const fmap * const m, size_t i, void *key) {
+    return i < m->keys->size && (*m->comp)(key_at(m, i), key) == 0;
+}
+
+static pair entry(const fmap * const m, size_t i) {
+    pair e = { NULL, NULL };
+
+    if (i < m->keys->size) {
+        e.key = key_at(m, i);
+        e.val = val_at(m, i);
+    }
+
+    return e;
+}
+
+static pair *entry_pair(pair e) {
+    struct pair_t *p = NULL;
+
+    if (e.key != NULL) {
+        p = pair_init();
+        p->key = e.key;
+        p->val = e.val;
+    }
+
+    return p;
+}
+
+// inserts |n| entries at |index| into both vectors, or into neither if either cannot grow
+static bool insert_entries(fmap * const m, size_t index, void *keys, void *vals, size_t n) {
+    size_t size = m->keys->size;
+
+    vector_insert_n(m->keys, index, keys, n);
+    if (m->keys->size == size) {
+        return n == 0;
+    }
+
+    vector_insert_n(m->vals, index, vals, n);
+    if (m->vals->size == size) {
+        vector_erase_range(m->keys, index, index + n);
+        return false;
+    }
+
+    return true;
+}
+
+static void erase_entries(fmap * const m, size_t first, size_t last) {
+    vector_erase_range(m->keys, first, last);
+    vector_erase_range(m->vals, first, last);
+}
+
+// moves |n| entries from index |from| to index |to|
+static void move_entries(fmap * const m, size_t to, size_t from, size_t n) {
+    memmove(key_at(m, to), key_at(m, from), n * m->keys->elem_size);
+    memmove(val_at(m, to), val_at(m, from), n * m->vals->elem_size);
+    STATS_ADD(m->keys, bytes_copied, n * m->keys->elem_size);
+    STATS_ADD(m->vals, bytes_copied, n * m->vals->elem_size);
+}
+
+fmap *fmap_init(size_t key_size, size_t val_size, int (*comp)(void *a, void *b)) {
+    struct flat_map_t *m = malloc(sizeof(*m));
+    m->keys = vector_init(key_size);
+    m->vals = vector_init(val_size);
+    m->comp = comp;
+    return m;
+}
+
+// |keys| holds |n| keys in strictly increasing order, which is not checked
+fmap *fmap_from_sorted(size_t key_size, size_t val_size, int (*comp)(void *a, void *b),
+        void *keys, void *vals, size_t n) {
+    fmap *m = fmap_init(key_size, val_size, comp);
+    insert_entries(m, 0, keys, vals, n);
+    return m;
+}
+
+fmap *fmap_clone(const fmap * const m) {
+    return fmap_from_sorted(m->keys->elem_size, m->vals->elem_size, m->comp,
+                            m->keys->data, m->vals->data, m->keys->size);
+}
+
+void fmap_del(fmap **m) {
+    if (*m != NULL) {
+        vector_del(&(*m)->keys);
+        vector_del(&(*m)->vals);
+        free(*m);
+        *m = NULL;
+    }
+}
+
+size_t fmap_size(const fmap * const m) {
+    return m->keys->size;
+}
+
+void *fmap_get(fmap * const m, void *key) {
+    size_t i = seek(m, key);
+    return holds(m, i, key) ? val_at(m, i) : NULL;
+}
+
+bool fmap_insert(fmap * const m, void *key, void *val) {
+    size_t i = seek(m, key);
+    return !holds(m, i, key) && insert_entries(m, i, key, val, 1);
+}
+
+/*
+ * Packs the batch into records of key then value to sort and dedupe it,
+ * then merges it in from the back, so the whole batch costs one pass over
+ * |m|. Of equal keys, the entry already in |m| or else the first in the
+ * batch is kept, as with repeated fmap_insert() calls.
+ */
+void fmap_insert_many(fmap * const m, void *keys, void *vals, size_t n) {
+    size_t key_size = m->keys->elem_size, val_size = m->vals->elem_size;
+    size_t size = m->keys->size, a, b, out, i;
+    unsigned char *sorted_keys, *sorted_vals;
+
+    // records stay max-aligned so the comparator can read keys in place
+    size_t align = _Alignof(max_align_t);
+    size_t stride = (key_size + val_size + align - 1) / align * align;
+    unsigned char *batch = malloc(n * stride);
+    unsigned char *sorted = malloc(n * (key_size + val_size));
+
+    if (batch == NULL || sorted == NULL) {
+        free(batch);
+        free(sorted);
+        return;
+    }
+
+    for (i = 0; i < n; i++) {
+        memcpy(batch + i * stride, (unsigned char *)keys + i * key_size, key_size);
+        memcpy(batch + i * stride + key_size, (unsigned char *)vals + i * val_size, val_size);
+    }
+
+    elems_stable_sort(batch, n, stride, m->comp);
+    n = elems_unique(batch, n, stride, m->comp);
+
+    sorted_keys = sorted;
+    sorted_vals = sorted + n * key_size;
+    for (i = 0; i < n; i++) {
+        memcpy(sorted_keys + i * key_size, batch + i * stride, key_size);
+        memcpy(sorted_vals + i * val_size, batch + i * stride + key_size, val_size);
+    }
+    free(batch);
+
+    // grow |m| by the whole batch, then fill the new slots back to front
+    if (!insert_entries(m, size, sorted_keys, sorted_vals, n)) {
+        free(sorted);
+        return;
+    }
+
+    for (a = size, b = n, out = size + n; b > 0; ) {
+        int c = (a == 0) ? -1 : (*m->comp)(key_at(m, a - 1), sorted_keys + (b - 1) * key_size);
+
+        if (c >= 0) {
+            move_entries(m, --out, --a, 1);
+            b -= (c == 0);
+        } else {
+            out--;
+            b--;
+            memcpy(key_at(m, out), sorted_keys + b * key_size, key_size);
+            memcpy(val_at(m, out), sorted_vals + b * val_size, val_size);
+        }
+    }
+
+    // keys already in |m| leave a gap as wide as their count
+    erase_entries(m, a, out);
+    free(sorted);
+}
+
+bool fmap_remove(fmap * const m, void *key) {
+    size_t i = seek(m, key);
+
+    if (!holds(m, i, key)) {
+        return false;
+    }
+
+    erase_entries(m, i, i + 1);
+    return true;
+}
+
+bool fmap_contains(const fmap * const m, void *key) {
+    return holds(m, seek(m, key), key);
+}
+
+pair *fmap_floor(const fmap * const m) {
+    return entry_pair(entry(m, 0));
+}
+
+pair *fmap_ceil(const fmap * const m) {
+    return entry_pair(entry(m, m->keys->size - 1));     // wraps past the end when empty
+}
+
+pair *fmap_lower(const fmap * const m, void *key) {
+    return entry_pair(entry(m, seek(m, key) - 1));      // likewise when nothing is before |key|
+}
+
+pair *fmap_higher(const fmap * const m, void *key) {
+    size_t i = seek(m, key);
+    return entry_pair(entry(m, i + holds(m, i, key)));
+}
+
+// number of keys in |m| before |key|
+size_t fmap_rank(const fmap * const m, void *key) {
+    return seek(m, key);
+}
+
+// entry with |k| keys before it, or NULL if |m| has no more than |k| entries
+pair *fmap_select(const fmap * const m, size_t k) {
+    return entry_pair(entry(m, k));
+}
+
+// number of keys in |m| from |lo| to |hi| inclusive
+size_t fmap_count_range(const fmap * const m, void *lo, void *hi) {
+    size_t end;
+
+    if ((*m->comp)(lo, hi) > 0) {
+        return 0;
+    }
+
+    end = seek(m, hi);
+    return end - seek(m, lo) + holds(m, end, hi);
+}
+
+void *fmap_floor_key(const fmap * const m) {
+    return entry(m, 0).key;
+}
+
+void *fmap_ceil_key(const fmap * const m) {
+    return entry(m, m->keys->size - 1).key;
+}
+
+void *fmap_lower_key(const fmap * const m, void *key) {
+    return entry(m, seek(m, key) - 1).key;
+}
+
+void *fmap_higher_key(const fmap * const m, void *key) {
+    size_t i = seek(m, key);
+    return entry(m, i + holds(m, i, key)).key;
+}
+
+void *fmap_select_key(const fmap * const m, size_t k) {
+    return entry(m, k).key;
+}
+
+void fmap_stats(const fmap * const m, container_stats *out) {
+    container_stats vals;
+
+    vector_stats(m->keys, out);
+    vector_stats(m->vals, &vals);
+    out->allocs += vals.allocs;
+    out->frees += vals.frees;
+    out->reallocs += vals.reallocs;
+    out->bytes_copied += vals.bytes_copied;
+}
+
+void fmap_stats_reset(fmap * const m) {
+    vector_stats_reset(m->keys);
+    vector_stats_reset(m->vals);
+}
+
@@ -0,0 +1,55 @@
+#ifndef FMAP_H
+#define FMAP_H
+
+#include <stddef.h>     // size_t
+#include <stdbool.h>    // bool
+
+#include "pair.h"
+#include "stats.h"
+
+/*
+ * Ordered map kept as a sorted vector of keys and a parallel vector of
+ * values, for maps that are built once and then mostly read; see fset.h
+ * for the trade-offs. Pointers to keys and values are invalidated by any
+ * insert or remove.
+ *
+ * The lookup, floor/ceil/lower/higher, rank and select functions match
+ * omap's, and the pairs they return are freed with pair_del().
+ */
+
+typedef struct flat_map_t fmap;
+
+fmap *fmap_init(size_t key_size, size_t val_size, int (*comp)(void *a, void *b));
+fmap *fmap_from_sorted(size_t key_size, size_t val_size, int (*comp)(void *a, void *b),
+        void *keys, void *vals, size_t n);
+fmap *fmap_clone(const fmap * const m);
+void fmap_del(fmap **m);
+
+size_t fmap_size(const fmap * const m);
+
+void *fmap_get(fmap * const m, void *key);
+bool fmap_insert(fmap * const m, void *key, void *val);
+void fmap_insert_many(fmap * const m, void *keys, void *vals, size_t n);
+bool fmap_remove(fmap * const m, void *key);
+bool fmap_contains(const fmap * const m, void *key);
+
+pair *fmap_floor(const fmap * const m);
+pair *fmap_ceil(const fmap * const m);
+pair *fmap_lower(const fmap * const m, void *key);
+pair *fmap_higher(const fmap * const m, void *key);
+
+size_t fmap_rank(const fmap * const m, void *key);
+pair *fmap_select(const fmap * const m, size_t k);
+size_t fmap_count_range(const fmap * const m, void *lo, void *hi);
+
+void *fmap_floor_key(const fmap * const m);
+void *fmap_ceil_key(const fmap * const m);
+void *fmap_lower_key(const fmap * const m, void *key);
+void *fmap_higher_key(const fmap * const m, void *key);
+void *fmap_select_key(const fmap * const m, size_t k);
+
+// the counts are those of the key and value vectors together
+void fmap_stats(const fmap * const m, container_stats *out);
+void fmap_stats_reset(fmap * const m);
+
+#endif
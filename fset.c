@@ -0,0 +1,174 @@
+#include "fset.h"
+
+#include <stdlib.h>     // malloc(), free()
+#include <string.h>     // memcpy()
+
+#include "vector.h"
+#include "elems.h"
+
+struct flat_set_t {
+    vector *v;      // elems in strictly increasing order
+    int (*comp)(void *a, void *b);
+};
+
+static inline void *elem(const fset * const s, size_t i) {
+    return (unsigned char *)s->v->data + i * s->v->elem_size;
+}
+
+// index of the first elem not before |val|
+static size_t seek(const fset * const s, void *val) {
+    return elems_lower_bound(s->v->data, s->v->size, s->v->elem_size, val, s->comp);
+}
+
+static bool holds(const fset * const s, size_t i, void *val) {
+    return i < s->v->size && (*s->comp)(elem(s, i), val) == 0;
+}
+
+fset *fset_init(size_t elem_size, int (*comp)(void *a, void *b)) {
+    struct flat_set_t *s = malloc(sizeof(*s));
+    s->v = vector_init(elem_size);
+    s->comp = comp;
+    return s;
+}
+
+// |data| holds |n| elems in strictly increasing order, which is not checked
+fset *fset_from_sorted(size_t elem_size, int (*comp)(void *a, void *b), void *data, size_t n) {
+    fset *s = fset_init(elem_size, comp);
+    vector_append(s->v, data, n);
+    return s;
+}
+
+fset *fset_clone(const fset * const s) {
+    return fset_from_sorted(s->v->elem_size, s->comp, s->v->data, s->v->size);
+}
+
+void fset_del(fset **s) {
+    if (*s != NULL) {
+        vector_del(&(*s)->v);
+        free(*s);
+        *s = NULL;
+    }
+}
+
+size_t fset_size(const fset * const s) {
+    return s->v->size;
+}
+
+bool fset_insert(fset * const s, void *val) {
+    size_t i = seek(s, val), size = s->v->size;
+
+    if (holds(s, i, val)) {
+        return false;
+    }
+
+    vector_insert_n(s->v, i, val, 1);
+    return s->v->size > size;   // false if out of memory
+}
+
+/*
+ * Sorts a copy of |data| and merges it in from the back, so the whole
+ * batch costs one pass over |s| rather than one per elem. Of elems that
+ * compare equal, the one already in |s| or else the first in |data| is
+ * kept, as with repeated fset_insert() calls.
+ */
+void fset_insert_many(fset * const s, void *data, size_t n) {
+    size_t elem_size = s->v->elem_size, size = s->v->size;
+    size_t a, b, out;
+    unsigned char *batch = malloc(n * elem_size);
+
+    if (batch == NULL) {
+        return;
+    }
+
+    memcpy(batch, data, n * elem_size);
+    elems_stable_sort(batch, n, elem_size, s->comp);
+    n = elems_unique(batch, n, elem_size, s->comp);
+
+    // grow |s| by the whole batch, then fill the new slots back to front
+    vector_append(s->v, batch, n);
+    if (s->v->size != size + n) {
+        free(batch);
+        return;
+    }
+
+    for (a = size, b = n, out = size + n; b > 0; ) {
+        int c = (a == 0) ? -1 : (*s->comp)(elem(s, a - 1), batch + (b - 1) * elem_size);
+
+        if (c >= 0) {
+            memcpy(elem(s, --out), elem(s, --a), elem_size);
+            b -= (c == 0);
+        } else {
+            memcpy(elem(s, --out), batch + --b * elem_size, elem_size);
+        }
+    }
+
+    STATS_ADD(s->v, bytes_copied, (size + n - out) * elem_size);
+
+    // elems already in |s| leave a gap as wide as their count
+    vector_erase_range(s->v, a, out);
+    free(batch);
+}
+
+bool fset_remove(fset * const s, void *val) {
+    size_t i = seek(s, val);
+
+    if (!holds(s, i, val)) {
+        return false;
+    }
+
+    vector_erase_range(s->v, i, i + 1);
+    return true;
+}
+
+bool fset_contains(const fset * const s, void *val) {
+    return holds(s, seek(s, val), val);
+}
+
+void *fset_floor(const fset * const s) {
+    return fset_select(s, 0);
+}
+
+void *fset_ceil(const fset * const s) {
+    return (s->v->size == 0) ? NULL : elem(s, s->v->size - 1);
+}
+
+void *fset_lower(const fset * const s, void *val) {
+    size_t i = seek(s, val);
+    return (i == 0) ? NULL : elem(s, i - 1);
+}
+
+void *fset_higher(const fset * const s, void *val) {
+    size_t i = seek(s, val);
+    return fset_select(s, i + holds(s, i, val));
+}
+
+// number of elems in |s| before |val|
+size_t fset_rank(const fset * const s, void *val) {
+    return seek(s, val);
+}
+
+// elem with |k| elems before it, or NULL if |s| has no more than |k| elems
+void *fset_select(const fset * const s, size_t k) {
+    return (k < s->v->size) ? elem(s, k) : NULL;
+}
+
+// number of elems in |s| from |lo| to |hi| inclusive
+size_t fset_count_range(const fset * const s, void *lo, void *hi) {
+    size_t end;
+
+    if ((*s->comp)(lo, hi) > 0) {
+        return 0;
+    }
+
+    end = seek(s, hi);
+    return end - seek(s, lo) + holds(s, end, hi);
+}
+
+void fset_stats(const fset * const s, container_stats *out) {
+    vector_stats(s->v, out);
+}
+
+void fset_stats_reset(fset * const s) {
+    vector_stats_reset(s->v);
+}
+
@@ -0,0 +1,47 @@
+#ifndef FSET_H
+#define FSET_H
+
+#include <stddef.h>     // size_t
+#include <stdbool.h>    // bool
+
+#include "stats.h"
+
+/*
+ * Ordered set kept as one sorted vector of elems, for sets that are built
+ * once and then mostly read. Lookups binary search contiguous memory and
+ * each elem costs only its own bytes, but a single insert or remove moves
+ * every elem after it; build large sets with fset_insert_many(). Pointers
+ * to elems are invalidated by any insert or remove.
+ *
+ * The floor/ceil/lower/higher, rank and select functions match oset's;
+ * the elem with index k is fset_select(s, k).
+ */
+
+typedef struct flat_set_t fset;
+
+fset *fset_init(size_t elem_size, int (*comp)(void *a, void *b));
+fset *fset_from_sorted(size_t elem_size, int (*comp)(void *a, void *b), void *data, size_t n);
+fset *fset_clone(const fset * const s);
+void fset_del(fset **s);
+
+size_t fset_size(const fset * const s);
+
+bool fset_insert(fset * const s, void *val);
+void fset_insert_many(fset * const s, void *data, size_t n);
+bool fset_remove(fset * const s, void *val);
+bool fset_contains(const fset * const s, void *val);
+
+void *fset_floor(const fset * const s);
+void *fset_ceil(const fset * const s);
+void *fset_lower(const fset * const s, void *val);
+void *fset_higher(const fset * const s, void *val);
+
+size_t fset_rank(const fset * const s, void *val);
+void *fset_select(const fset * const s, size_t k);
+size_t fset_count_range(const fset * const s, void *lo, void *hi);
+
+// the counts are those of the underlying vector
+void fset_stats(const fset * const s, container_stats *out);
+void fset_stats_reset(fset * const s);
+
+#endif
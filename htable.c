@@ -0,0 +1,362 @@
+#include "htable.h"
+
+#include <stdlib.h>     // malloc(), calloc(), free()
+#include <string.h>     // memcpy()
+#include <stdint.h>     // uint64_t
+
+#define INIT_BITS 4
+#define DEFAULT_MAX_LOAD 0.75
+#define MIGRATE_STEP 16     // old slots moved per insert or remove
+
+#define HASH_TAG ((size_t)1 << (sizeof(size_t) * 8 - 1))
+
+// largest alignment a type of |size| bytes can require
+static size_t align_for(size_t size) {
+    size_t align = size & -size;
+
+    if (align == 0 || align > _Alignof(max_align_t)) {
+        align = _Alignof(max_align_t);
+    }
+
+    return align;
+}
+
+static size_t round_up(size_t n, size_t align) {
+    return (n + align - 1) / align * align;
+}
+
+static void slots_init(const htable * const h, struct htable_slots_t *t, unsigned int bits) {
+    t->bits = bits;
+    t->cap = (size_t)1 << bits;
+    t->count = 0;
+    t->hashes = calloc(t->cap, sizeof(*t->hashes));
+    t->data = malloc(t->cap * h->slot_size);
+    STATS_ADD(h, allocs, 2);
+}
+
+static void slots_del(const htable * const h, struct htable_slots_t *t) {
+    if (t->data != NULL) {
+        STATS_ADD(h, frees, 2);
+    }
+
+    free(t->hashes);
+    free(t->data);
+    t->hashes = t->data = NULL;
+    t->cap = t->count = 0;
+}
+
+static size_t tag(size_t hash) {
+    /*
+     * Never 0. The tag flips the top bit of the product home_slot() shifts
+     * down, so it does move keys, but it does so alike for every key.
+     */
+    return hash | HASH_TAG;
+}
+
+static size_t tagged_hash(const htable * const h, void *key) {
+    STATS_ADD(h, comparisons, 1);
+    return tag((*h->hash)(key));
+}
+
+static size_t home_slot(const struct htable_slots_t * const t, size_t hash) {
+    // Fibonacci hashing spreads keys whose hashes differ only in high bits
+    return (size_t)(((uint64_t)hash * 0x9E3779B97F4A7C15ull) >> (64 - t->bits));
+}
+
+static size_t probe_dist(const struct htable_slots_t * const t, size_t i) {
+    return (i - home_slot(t, t->hashes[i])) & (t->cap - 1);
+}
+
+static void *slot_at(const htable * const h, const struct htable_slots_t * const t, size_t i) {
+    return (unsigned char *)t->data + i * h->slot_size;
+}
+
+/*
+ * Returns the index of |key| in |t|, or |t->cap| if absent. The |done|
+ * slots from |start| on, wrapping around, have all been emptied by
+ * migration, so a probe starting among them can jump to the first slot
+ * past them. Migration starts at a slot that was empty, so no probe run
+ * reaches into the emptied slots from before them.
+ */
+static size_t slots_find(const htable * const h, const struct htable_slots_t * const t,
+        void *key, size_t hash, size_t start, size_t done) {
+    size_t i = home_slot(t, hash);
+    size_t dist = 0, from_start = (i - start) & (t->cap - 1);
+
+    if (from_start < done) {
+        dist = done - from_start;
+        i = (start + done) & (t->cap - 1);
+    }
+
+    for (; dist < t->cap; dist++, i = (i + 1) & (t->cap - 1)) {
+        STATS_ADD(h, node_visits, 1);
+
+        if (t->hashes[i] == 0) {
+            break;
+        } else if (probe_dist(t, i) < dist) {
+            break;
+        } else if (t->hashes[i] == hash) {
+            STATS_ADD(h, comparisons, 1);
+            if ((*h->equal)(slot_at(h, t, i), key)) {
+                return i;
+            }
+        }
+    }
+
+    return t->cap;
+}
+
+// places the entry in |h->carry|; |t| must have a free slot
+static void slots_put(htable * const h, struct htable_slots_t *t, size_t hash) {
+    size_t i = home_slot(t, hash);
+    size_t dist = 0;
+
+    while (t->hashes[i] != 0) {
+        size_t other = probe_dist(t, i);
+        STATS_ADD(h, node_visits, 1);
+
+        if (other < dist) {     // rob the richer entry and carry it on
+            size_t tmp = t->hashes[i];
+            t->hashes[i] = hash;
+            hash = tmp;
+
+            memcpy(h->swap, slot_at(h, t, i), h->slot_size);
+            memcpy(slot_at(h, t, i), h->carry, h->slot_size);
+            memcpy(h->carry, h->swap, h->slot_size);
+            STATS_ADD(h, bytes_copied, 3 * h->slot_size);
+
+            dist = other;
+        }
+
+        i = (i + 1) & (t->cap - 1);
+        dist++;
+    }
+
+    t->hashes[i] = hash;
+    memcpy(slot_at(h, t, i), h->carry, h->slot_size);
+    STATS_ADD(h, bytes_copied, h->slot_size);
+    t->count++;
+}
+
+// backward-shift deletion keeps probe sequences free of tombstones
+static void slots_erase(const htable * const h, struct htable_slots_t *t, size_t i) {
+    size_t next = (i + 1) & (t->cap - 1);
+
+    while (t->hashes[next] != 0 && probe_dist(t, next) > 0) {
+        t->hashes[i] = t->hashes[next];
+        memcpy(slot_at(h, t, i), slot_at(h, t, next), h->slot_size);
+        STATS_ADD(h, bytes_copied, h->slot_size);
+        i = next;
+        next = (next + 1) & (t->cap - 1);
+    }
+
+    t->hashes[i] = 0;
+    t->count--;
+}
+
+static void migrate(htable * const h, size_t steps) {
+    while (h->old.data != NULL && steps-- > 0) {
+        if (h->old.count == 0) {
+            slots_del(h, &h->old);
+        } else {
+            size_t i = (h->migrate_start + h->migrate_pos++) & (h->old.cap - 1);
+
+            if (h->old.hashes[i] != 0) {
+                memcpy(h->carry, slot_at(h, &h->old, i), h->slot_size);
+                STATS_ADD(h, bytes_copied, h->slot_size);
+                slots_put(h, &h->cur, h->old.hashes[i]);
+                h->old.hashes[i] = 0;
+                h->old.count--;
+            }
+        }
+    }
+}
+
+// moves |h->cur| to |h->old| and starts a table of |bits| to migrate it into
+static void begin_rehash(htable * const h, unsigned int bits) {
+    migrate(h, (size_t)-1);     // finish any rehash already under way
+
+    h->old = h->cur;
+    h->migrate_start = 0;
+    h->migrate_pos = 0;
+    while (h->old.hashes[h->migrate_start] != 0) {
+        h->migrate_start++;     // the max load leaves at least one empty slot
+    }
+
+    slots_init(h, &h->cur, bits);
+}
+
+static void grow(htable * const h) {
+    begin_rehash(h, h->cur.bits + 1);
+}
+
+htable *htable_init(size_t key_size, size_t val_size,
+        size_t (*hash)(void *key), bool (*equal)(void *a, void *b)) {
+    struct htable_t *h = malloc(sizeof(*h));
+    size_t key_align = align_for(key_size);
+    size_t val_align = align_for(val_size);
+
+    h->size = 0;
+    h->key_size = key_size;
+    h->val_size = val_size;
+    h->val_offset = round_up(key_size, val_align);
+    h->slot_size = round_up(h->val_offset + val_size,
+            (key_align > val_align) ? key_align : val_align);
+    h->max_load = DEFAULT_MAX_LOAD;
+    h->hash = hash;
+    h->equal = equal;
+    STATS_INIT(h);
+
+    slots_init(h, &h->cur, INIT_BITS);
+    h->old.hashes = h->old.data = NULL;
+    h->old.cap = h->old.count = 0;
+    h->migrate_start = h->migrate_pos = 0;
+
+    h->carry = malloc(h->slot_size);
+    h->swap = malloc(h->slot_size);
+    return h;
+}
+
+void htable_del(htable **h) {
+    if (*h != NULL) {
+        slots_del(*h, &(*h)->cur);
+        slots_del(*h, &(*h)->old);
+        free((*h)->carry);
+        free((*h)->swap);
+        STATS_DEL(*h);
+        free(*h);
+        *h = NULL;
+    }
+}
+
+size_t htable_size(const htable * const h) {
+    return h->size;
+}
+
+void htable_set_max_load(htable * const h, double max_load) {
+    // probing needs at least one free slot to terminate
+    if (max_load > 0.0 && max_load < 1.0) {
+        h->max_load = max_load;
+    }
+}
+
+/*
+ * Grows the table to hold |n| entries without passing the max load, moving
+ * every entry across at once.
+ */
+void htable_reserve(htable * const h, size_t n) {
+    unsigned int bits = h->cur.bits;
+
+    while (n > h->max_load * ((size_t)1 << bits)) {
+        bits++;
+    }
+
+    if (bits > h->cur.bits) {
+        begin_rehash(h, bits);
+        migrate(h, (size_t)-1);
+    }
+}
+
+static void *find_slot(const htable * const h, void *key, size_t hash) {
+    size_t i = slots_find(h, &h->cur, key, hash, 0, 0);
+
+    if (i < h->cur.cap) {
+        return slot_at(h, &h->cur, i);
+    } else if (h->old.data != NULL) {
+        i = slots_find(h, &h->old, key, hash, h->migrate_start, h->migrate_pos);
+        return (i < h->old.cap) ? slot_at(h, &h->old, i) : NULL;
+    } else {
+        return NULL;
+    }
+}
+
+void *htable_find(const htable * const h, void *key) {
+    return find_slot(h, key, tagged_hash(h, key));
+}
+
+void *htable_find_hashed(const htable * const h, void *key, size_t hash) {
+    return find_slot(h, key, tag(hash));
+}
+
+static bool insert(htable * const h, void *key, void *val, size_t hash) {
+    if (find_slot(h, key, hash) != NULL) {
+        return false;
+    }
+
+    if (h->size + 1 > h->max_load * h->cur.cap) {
+        grow(h);
+    }
+    migrate(h, MIGRATE_STEP);
+
+    memcpy(h->carry, key, h->key_size);
+    if (h->val_size > 0) {
+        memcpy(h->carry + h->val_offset, val, h->val_size);
+    }
+    STATS_ADD(h, bytes_copied, h->key_size + h->val_size);
+    slots_put(h, &h->cur, hash);
+    h->size++;
+    return true;
+}
+
+bool htable_insert(htable * const h, void *key, void *val) {
+    return insert(h, key, val, tagged_hash(h, key));
+}
+
+bool htable_insert_hashed(htable * const h, void *key, void *val, size_t hash) {
+    return insert(h, key, val, tag(hash));
+}
+
+static bool remove_key(htable * const h, void *key, size_t hash) {
+    size_t i = slots_find(h, &h->cur, key, hash, 0, 0);
+
+    if (i < h->cur.cap) {
+        slots_erase(h, &h->cur, i);
+    } else if (h->old.data != NULL
+            && (i = slots_find(h, &h->old, key, hash, h->migrate_start, h->migrate_pos)) < h->old.cap) {
+        slots_erase(h, &h->old, i);
+    } else {
+        return false;
+    }
+
+    h->size--;
+    migrate(h, MIGRATE_STEP);
+    return true;
+}
+
+bool htable_remove(htable * const h, void *key) {
+    return remove_key(h, key, tagged_hash(h, key));
+}
+
+bool htable_remove_hashed(htable * const h, void *key, size_t hash) {
+    return remove_key(h, key, tag(hash));
+}
+
+/*
+ * Returns the key of the first entry at or after |*pos| and moves |*pos|
+ * past it, or NULL once every entry has been visited. Start from 0; the
+ * walk is invalidated by inserts and removes.
+ */
+void *htable_next(const htable * const h, size_t *pos) {
+    while (*pos < h->old.cap + h->cur.cap) {
+        size_t i = (*pos)++;
+
+        if (i < h->old.cap) {
+            if (h->old.hashes[i] != 0) {
+                return slot_at(h, &h->old, i);
+            }
+        } else if (h->cur.hashes[i - h->old.cap] != 0) {
+            return slot_at(h, &h->cur, i - h->old.cap);
+        }
+    }
+
+    return NULL;
+}
+
+void htable_stats(const htable * const h, container_stats *out) {
+    STATS_GET(h, out);
+}
+
+void htable_stats_reset(htable * const h) {
+    STATS_RESET(h);
+}
+
@@ -0,0 +1,69 @@
+#ifndef HTABLE_H
+#define HTABLE_H
+
+#include <stddef.h>     // size_t
+#include <stdbool.h>    // bool
+
+#include "stats.h"
+
+/*
+ * Open-addressing hash table with Robin Hood probing underlying uset and
+ * umap. Keys and values are stored inline in a flat slot array; a slot's
+ * value, if any, sits |val_offset| bytes after its key.
+ *
+ * Growing allocates a table twice the size and moves entries across a few
+ * slots at a time on later inserts and removes, so no single call pays for
+ * the whole rehash. Until then, lookups consult both tables.
+ */
+
+struct htable_slots_t {
+    size_t cap, count;
+    unsigned int bits;      // log2(|cap|)
+    size_t *hashes;         // 0 marks an empty slot
+    void *data;
+};
+
+typedef struct htable_t {
+    size_t size;
+    size_t key_size, val_size;
+    size_t val_offset, slot_size;
+    double max_load;
+
+    struct htable_slots_t cur, old;     // |old.data| is NULL unless rehashing
+    size_t migrate_start;               // an old slot that was empty when rehashing began
+    size_t migrate_pos;                 // old slots moved so far, from |migrate_start| on
+
+    void *carry, *swap;                 // scratch slots for Robin Hood swaps
+
+    size_t (*hash)(void *key);
+    bool (*equal)(void *a, void *b);
+
+    STATS_FIELD
+} htable;
+
+htable *htable_init(size_t key_size, size_t val_size,
+        size_t (*hash)(void *key), bool (*equal)(void *a, void *b));
+void htable_del(htable **h);
+
+size_t htable_size(const htable * const h);
+void htable_set_max_load(htable * const h, double max_load);
+void htable_reserve(htable * const h, size_t n);
+
+void *htable_find(const htable * const h, void *key);
+bool htable_insert(htable * const h, void *key, void *val);
+bool htable_remove(htable * const h, void *key);
+
+/*
+ * The same, for callers that have already hashed |key| for another use;
+ * |hash| must be what the table's hash function returns for it.
+ */
+void *htable_find_hashed(const htable * const h, void *key, size_t hash);
+bool htable_insert_hashed(htable * const h, void *key, void *val, size_t hash);
+bool htable_remove_hashed(htable * const h, void *key, size_t hash);
+
+void *htable_next(const htable * const h, size_t *pos);
+
+void htable_stats(const htable * const h, container_stats *out);
+void htable_stats_reset(htable * const h);
+
+#endif
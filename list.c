@@ -3,16 +3,20 @@
 #include <stdlib.h>     // malloc(), free()
 #include <string.h>     // memcpy()
 
+#include "pool.h"
+
 struct node_t {
-    void *val;
     struct node_t *next, *prev;
+    _Alignas(max_align_t) unsigned char val[];  // stored inline, one malloc per node
 };
 
 struct linked_list_t {
     size_t size;
     size_t elem_size;
     struct node_t *front, *back;
-}; 
+    pool *nodes;    // NULL unless the list was made with list_init_pooled()
+    STATS_FIELD
+};
 
 static struct node_t *get_node(const list * const l, size_t index) {
     struct node_t *n = NULL;
@@ -23,21 +27,69 @@ static struct node_t *get_node(const list * const l, size_t index) {
         for (i = 0; i < index; i++) {
             n = n->next;
         }
+        STATS_ADD(l, node_visits, index);
     } else if (index < l->size) {
         n = l->back;
         for (i = l->size - 1; i > index; i--) {
             n = n->prev;
         }
+        STATS_ADD(l, node_visits, l->size - 1 - index);
     }
 
     return n;   // NULL iff |index| is out of bounds
 }
 
-static void node_del(struct node_t *n) {
-    if (n != NULL) {
-        free(n->val);
+static struct node_t *node_init(const list * const l) {
+    STATS_ADD(l, allocs, 1);
+    return (l->nodes == NULL) ? malloc(sizeof(struct node_t) + l->elem_size) : pool_alloc(l->nodes);
+}
+
+static void node_del(const list * const l, struct node_t *n) {
+    STATS_ADD(l, frees, 1);
+    if (l->nodes == NULL) {
         free(n);
+    } else {
+        pool_free(l->nodes, n);
+    }
+}
+
+// links the run |first| to |last| in before |pos|, or at the back if |pos| is NULL
+static void link_run(list * const l, struct node_t *pos,
+        struct node_t *first, struct node_t *last, size_t n) {
+    struct node_t *prev = (pos == NULL) ? l->back : pos->prev;
+
+    first->prev = prev;
+    last->next = pos;
+
+    if (prev == NULL) {
+        l->front = first;
+    } else {
+        prev->next = first;
+    }
+
+    if (pos == NULL) {
+        l->back = last;
+    } else {
+        pos->prev = last;
+    }
+
+    l->size += n;
+}
+
+static void unlink_run(list * const l, struct node_t *first, struct node_t *last, size_t n) {
+    if (first->prev == NULL) {
+        l->front = last->next;
+    } else {
+        first->prev->next = last->next;
     }
+
+    if (last->next == NULL) {
+        l->back = first->prev;
+    } else {
+        last->next->prev = first->prev;
+    }
+
+    l->size -= n;
 }
 
 list *list_init(size_t elem_size) {
@@ -45,6 +97,14 @@ list *list_init(size_t elem_size) {
     l->size = 0;
     l->elem_size = elem_size;
     l->front = l->back = NULL;
+    l->nodes = NULL;
+    STATS_INIT(l);
+    return l;
+}
+
+list *list_init_pooled(size_t elem_size) {
+    struct linked_list_t *l = list_init(elem_size);
+    l->nodes = pool_init(sizeof(struct node_t) + elem_size);
     return l;
 }
 
@@ -52,12 +112,17 @@ void list_del(list **l) {
     if (*l != NULL) {
         struct node_t *cur = (*l)->front;
 
-        while ((*l)->size-- > 0) {
-            (*l)->front = (*l)->front->next;
-            node_del(cur);
-            cur = (*l)->front;
+        if ((*l)->nodes == NULL) {
+            while ((*l)->size-- > 0) {
+                (*l)->front = (*l)->front->next;
+                node_del(*l, cur);
+                cur = (*l)->front;
+            }
+        } else {
+            pool_del(&(*l)->nodes);     // no need to visit each node
         }
 
+        STATS_DEL(*l);
         free(*l);
         *l = NULL;
     }
@@ -72,6 +137,7 @@ void list_set(list * const l, size_t index, void *val) {
 
     if (n) {    // |index| is within bounds
         memcpy(n->val, val, l->elem_size);
+        STATS_ADD(l, bytes_copied, l->elem_size);
     }
 }
 
@@ -89,50 +155,24 @@ void *list_back(const list * const l) {
 }
 
 void list_insert(list * const l, size_t index, void *val) {
-    struct node_t *n = malloc(sizeof(*n));
-    n->val = malloc(l->elem_size);
-    memcpy(n->val, val, l->elem_size);
-
-    if (l->size == 0) {
-        n->next = n->prev = NULL;
-        l->front = l->back = n; 
-    } else if (index == 0) {
-        n->next = l->front;
-        n->prev = NULL;
-        l->front = n->next->prev = n;
-    } else if (index == l->size) {
-        n->next = NULL;
-        n->prev = l->back;
-        l->back = n->prev->next = n;
-    } else {
-        struct node_t *cur = get_node(l, index);
-        n->next = cur;
-        n->prev = cur->prev;
-        n->prev->next = n->next->prev = n;
+    if (index <= l->size) {
+        // inserting at |l->size| leaves |pos| NULL, which appends
+        struct node_t *pos = get_node(l, index);
+        struct node_t *n = node_init(l);
+        memcpy(n->val, val, l->elem_size);
+        STATS_ADD(l, bytes_copied, l->elem_size);
+        link_run(l, pos, n, n, 1);
     }
-
-    l->size++;
 }
 
 void list_remove(list * const l, size_t index) {
     struct node_t *n = get_node(l, index);
 
     if (n) {    // |index| is within bounds
-        if (l->size == 1) {
-            l->front = l->back = NULL;
-        } else if (index == 0) {
-            l->front = n->next;
-        } else if (index == l->size - 1) {
-            l->back = n->prev;
-        } else {
-            n->next->prev = n->prev;
-            n->prev->next = n->next;
-        }
-
-        node_del(n);
-        l->size--;
-    } 
-} 
+        unlink_run(l, n, n, 1);
+        node_del(l, n);
+    }
+}
 
 void list_push_front(list * const l, void *val) {
     list_insert(l, 0, val);
@@ -151,3 +191,114 @@ void list_pop_back(list * const l) {
     list_remove(l, l->size - 1);
 }
 
+list_cursor list_cursor_front(const list * const l) {
+    list_cursor c = { l, l->front };
+    return c;
+}
+
+list_cursor list_cursor_back(const list * const l) {
+    list_cursor c = { l, l->back };
+    return c;
+}
+
+list_cursor list_cursor_end(const list * const l) {
+    list_cursor c = { l, NULL };
+    return c;
+}
+
+list_cursor list_cursor_at(const list * const l, size_t index) {
+    list_cursor c = { l, get_node(l, index) };
+    return c;
+}
+
+void list_cursor_next(list_cursor * const c) {
+    if (c->node != NULL) {
+        c->node = ((struct node_t *)c->node)->next;
+    }
+}
+
+void list_cursor_prev(list_cursor * const c) {
+    // stepping back from the end lands on the back elem
+    c->node = (c->node == NULL) ? c->l->back : ((struct node_t *)c->node)->prev;
+}
+
+void *list_cursor_get(const list_cursor * const c) {
+    return (c->node == NULL) ? NULL : ((struct node_t *)c->node)->val;
+}
+
+// inserting before the end pushes to the back
+void list_cursor_insert_before(list * const l, list_cursor * const c, void *val) {
+    struct node_t *n = node_init(l);
+    memcpy(n->val, val, l->elem_size);
+    STATS_ADD(l, bytes_copied, l->elem_size);
+    link_run(l, c->node, n, n, 1);
+}
+
+// inserting after the end pushes to the front
+void list_cursor_insert_after(list * const l, list_cursor * const c, void *val) {
+    struct node_t *n = node_init(l);
+    memcpy(n->val, val, l->elem_size);
+    STATS_ADD(l, bytes_copied, l->elem_size);
+    link_run(l, (c->node == NULL) ? l->front : ((struct node_t *)c->node)->next, n, n, 1);
+}
+
+// removes the elem at |c| and moves |c| to the next one
+void list_cursor_erase(list * const l, list_cursor * const c) {
+    struct node_t *n = c->node;
+
+    if (n != NULL) {
+        c->node = n->next;
+        unlink_run(l, n, n, 1);
+        node_del(l, n);
+    }
+}
+
+/*
+ * Moves the elems from |first| up to but not including |last| out of |src|
+ * and in before |pos| in |dst|. |pos| must not lie within the moved run.
+ *
+ * The nodes are relinked without copying, in O(1) given |n|, the length of
+ * the run; pass 0 to have it counted. Lists with their own node pools
+ * cannot share nodes, so between those the elems are copied instead.
+ */
+void list_splice(list * const dst, list_cursor * const pos,
+        list * const src, list_cursor * const first, list_cursor * const last, size_t n) {
+    struct node_t *run_first = first->node;
+    struct node_t *run_last = (last->node == NULL) ? src->back : ((struct node_t *)last->node)->prev;
+    struct node_t *cur;
+
+    if (run_first == NULL || run_first == last->node) {    // empty run
+        return;
+    }
+
+    if (n == 0) {
+        for (cur = run_first; cur != last->node; cur = cur->next) {
+            n++;
+        }
+        STATS_ADD(src, node_visits, n);
+    }
+
+    if (dst == src || (dst->nodes == NULL && src->nodes == NULL)) {
+        unlink_run(src, run_first, run_last, n);
+        link_run(dst, pos->node, run_first, run_last, n);
+    } else {
+        while (run_first != last->node) {
+            cur = run_first;
+            run_first = run_first->next;
+            list_cursor_insert_before(dst, pos, cur->val);
+            unlink_run(src, cur, cur, 1);
+            node_del(src, cur);
+        }
+    }
+
+    first->node = last->node;
+}
+
+void list_stats(const list * const l, container_stats *out) {
+    STATS_GET(l, out);
+}
+
+void list_stats_reset(list * const l) {
+    STATS_RESET(l);
+}
+
@@ -3,9 +3,18 @@
 
 #include <stddef.h>     // size_t
 
+#include "stats.h"
+
 typedef struct linked_list_t list;
 
+// position of an elem in a list; |node| is NULL past the end
+typedef struct list_cursor_t {
+    const list *l;
+    void *node;
+} list_cursor;
+
 list *list_init(size_t elem_size);
+list *list_init_pooled(size_t elem_size);
 void list_del(list **l);
 
 size_t list_size(const list * const l);
@@ -25,4 +34,23 @@ void list_pop_front(list * const l);
 void list_push_back(list * const l, void *val);
 void list_pop_back(list * const l);
 
+list_cursor list_cursor_front(const list * const l);
+list_cursor list_cursor_back(const list * const l);
+list_cursor list_cursor_end(const list * const l);
+list_cursor list_cursor_at(const list * const l, size_t index);
+
+void list_cursor_next(list_cursor * const c);
+void list_cursor_prev(list_cursor * const c);
+void *list_cursor_get(const list_cursor * const c);
+
+void list_cursor_insert_before(list * const l, list_cursor * const c, void *val);
+void list_cursor_insert_after(list * const l, list_cursor * const c, void *val);
+void list_cursor_erase(list * const l, list_cursor * const c);
+
+void list_splice(list * const dst, list_cursor * const pos,
+        list * const src, list_cursor * const first, list_cursor * const last, size_t n);
+
+void list_stats(const list * const l, container_stats *out);
+void list_stats_reset(list * const l);
+
 #endif
@@ -0,0 +1,176 @@
+#include "mpmc_queue.h"
+
+#include <stdlib.h>     // aligned_alloc(), free()
+#include <string.h>     // memcpy()
+#include <stdatomic.h>  // atomic_size_t, atomic_load_explicit(), ...
+
+#define CACHE_LINE 64
+
+/*
+ * Each cell's |seq| says whose turn it is: equal to a push position p when
+ * the cell is free for the push at p, and p + 1 once that push has filled
+ * it. The pop at p then frees it for the push at p + |cap|.
+ */
+struct cell_t {
+    atomic_size_t seq;
+    _Alignas(max_align_t) unsigned char val[];
+};
+
+struct mpmc_queue_t {
+    _Alignas(CACHE_LINE) atomic_size_t push_pos;
+    _Alignas(CACHE_LINE) atomic_size_t pop_pos;
+
+    _Alignas(CACHE_LINE) size_t cap;
+    size_t elem_size, cell_size;
+    void *cells;
+};
+
+static struct cell_t *cell_at(const mpmc_queue * const q, size_t pos) {
+    return q->cells + (pos & (q->cap - 1)) * q->cell_size;
+}
+
+/*
+ * Counts how many of the up to |n| cells from |pos| on have |seq| equal to
+ * their position plus |lag|, ie. are ready for the caller.
+ */
+static size_t ready_cells(const mpmc_queue * const q, size_t pos, size_t lag, size_t n, bool *behind) {
+    size_t i;
+
+    *behind = false;
+    for (i = 0; i < n; i++) {
+        size_t seq = atomic_load_explicit(&cell_at(q, pos + i)->seq, memory_order_acquire);
+        ptrdiff_t diff = (ptrdiff_t)(seq - (pos + i + lag));
+
+        if (diff != 0) {
+            // a later |seq| means another thread took |pos| since it was read
+            *behind = (i == 0 && diff > 0);
+            break;
+        }
+    }
+
+    return i;
+}
+
+/*
+ * Claims up to |n| consecutive positions from |*pos_var| whose cells are
+ * ready; returns how many, with the first in |*pos|.
+ */
+static size_t claim(mpmc_queue * const q, atomic_size_t *pos_var, size_t lag, size_t n, size_t *pos) {
+    *pos = atomic_load_explicit(pos_var, memory_order_relaxed);
+
+    while (true) {
+        bool behind;
+        size_t k = ready_cells(q, *pos, lag, n, &behind);
+
+        if (k > 0) {
+            if (atomic_compare_exchange_weak_explicit(pos_var, pos, *pos + k,
+                        memory_order_relaxed, memory_order_relaxed)) {
+                return k;
+            }
+        } else if (behind) {
+            *pos = atomic_load_explicit(pos_var, memory_order_relaxed);
+        } else {
+            return 0;   // full for pushes, empty for pops
+        }
+    }
+}
+
+mpmc_queue *mpmc_queue_init(size_t elem_size, size_t cap) {
+    struct mpmc_queue_t *q = aligned_alloc(CACHE_LINE, sizeof(*q));
+    size_t align = _Alignof(max_align_t);
+    size_t i;
+
+    // a power of 2 lets positions wrap with a mask
+    q->cap = 2;
+    while (q->cap < cap) {
+        q->cap *= 2;
+    }
+
+    q->elem_size = elem_size;
+    q->cell_size = sizeof(struct cell_t) + (elem_size + align - 1) / align * align;
+    q->cells = aligned_alloc(CACHE_LINE, (q->cap * q->cell_size + CACHE_LINE - 1) / CACHE_LINE * CACHE_LINE);
+
+    for (i = 0; i < q->cap; i++) {
+        atomic_init(&cell_at(q, i)->seq, i);
+    }
+
+    atomic_init(&q->push_pos, 0);
+    atomic_init(&q->pop_pos, 0);
+    return q;
+}
+
+void mpmc_queue_del(mpmc_queue **q) {
+    if (*q != NULL) {
+        free((*q)->cells);
+        free(*q);
+        *q = NULL;
+    }
+}
+
+// a snapshot; may be stale by the time it returns
+size_t mpmc_queue_size(const mpmc_queue * const q) {
+    size_t pop = atomic_load_explicit(&((struct mpmc_queue_t *)q)->pop_pos, memory_order_acquire);
+    size_t push = atomic_load_explicit(&((struct mpmc_queue_t *)q)->push_pos, memory_order_acquire);
+    return (push > pop) ? push - pop : 0;
+}
+
+size_t mpmc_queue_capacity(const mpmc_queue * const q) {
+    return q->cap;
+}
+
+bool mpmc_queue_push(mpmc_queue * const q, void *val) {
+    return mpmc_queue_push_n(q, val, 1) == 1;
+}
+
+bool mpmc_queue_pop(mpmc_queue * const q, void *out) {
+    return mpmc_queue_pop_n(q, out, 1) == 1;
+}
+
+/*
+ * Pushes |vals[0]| onwards, stopping at the first elem that does not fit
+ * or once all |n| are in; returns how many were pushed. Each claimed run
+ * of free cells costs a single compare-and-swap.
+ */
+size_t mpmc_queue_push_n(mpmc_queue * const q, void *vals, size_t n) {
+    size_t done = 0;
+
+    while (done < n) {
+        size_t pos, i;
+        size_t k = claim(q, &q->push_pos, 0, n - done, &pos);
+
+        if (k == 0) {
+            break;
+        }
+
+        for (i = 0; i < k; i++, done++) {
+            struct cell_t *c = cell_at(q, pos + i);
+            memcpy(c->val, vals + done * q->elem_size, q->elem_size);
+            atomic_store_explicit(&c->seq, pos + i + 1, memory_order_release);
+        }
+    }
+
+    return done;
+}
+
+// pops up to |n| elems into |out|; returns how many
+size_t mpmc_queue_pop_n(mpmc_queue * const q, void *out, size_t n) {
+    size_t done = 0;
+
+    while (done < n) {
+        size_t pos, i;
+        size_t k = claim(q, &q->pop_pos, 1, n - done, &pos);
+
+        if (k == 0) {
+            break;
+        }
+
+        for (i = 0; i < k; i++, done++) {
+            struct cell_t *c = cell_at(q, pos + i);
+            memcpy(out + done * q->elem_size, c->val, q->elem_size);
+            atomic_store_explicit(&c->seq, pos + i + q->cap, memory_order_release);
+        }
+    }
+
+    return done;
+}
+
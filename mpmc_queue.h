@@ -0,0 +1,26 @@
+#ifndef MPMC_QUEUE_H
+#define MPMC_QUEUE_H
+
+#include <stddef.h>     // size_t
+#include <stdbool.h>    // bool
+
+/*
+ * Bounded lock-free queue any number of threads may push to and pop from
+ * concurrently, after Dmitry Vyukov's array-based MPMC queue.
+ */
+
+typedef struct mpmc_queue_t mpmc_queue;
+
+mpmc_queue *mpmc_queue_init(size_t elem_size, size_t cap);
+void mpmc_queue_del(mpmc_queue **q);
+
+size_t mpmc_queue_size(const mpmc_queue * const q);
+size_t mpmc_queue_capacity(const mpmc_queue * const q);
+
+bool mpmc_queue_push(mpmc_queue * const q, void *val);
+bool mpmc_queue_pop(mpmc_queue * const q, void *out);
+
+size_t mpmc_queue_push_n(mpmc_queue * const q, void *vals, size_t n);
+size_t mpmc_queue_pop_n(mpmc_queue * const q, void *out, size_t n);
+
+#endif
@@ -1,326 +1,313 @@
 #include "omap.h"
 
 #include <stdlib.h>     // malloc(), free()
-#include <string.h>     // memcpy()
 
-struct node_t {
-    void *key, *val;
-    struct node_t *left, *right, *parent;
-};
+#include "tree.h"
+#include "btree.h"
 
 struct ordered_map_t {
-    size_t size;
-    size_t key_size, val_size;
-    struct node_t *data;
-
-    /*
-     * < 0    *a before *b
-     * 0      *a and *b equivalent
-     * > 0    *a after *b
-     */
-    int (*comp)(void *a, void *b);
+    // exactly one backend is non-NULL
+    tree *t;
+    btree *b;
 };
 
-static struct node_t *node_init(const omap * const m, void *key, void *val) {
-    struct node_t *n = malloc(sizeof(*n));
-    n->left = n->right = n->parent = NULL;
-
-    n->key = malloc(m->key_size);
-    memcpy(n->key, key, m->key_size);
-
-    n->val = malloc(m->val_size);
-    memcpy(n->val, val, m->val_size);
-
-    return n;
-}
+static pair tree_entry(const tree * const t, struct tree_node_t *n) {
+    pair e = { NULL, NULL };
 
-static void node_del(struct node_t *n) {
     if (n != NULL) {
-        free(n->key);
-        free(n->val);
-        free(n);
+        e.key = n->key;
+        e.val = tree_val(t, n);
     }
-}
 
-static void tree_del(struct node_t *root) {
-    if (root != NULL) {
-        tree_del(root->left);
-        tree_del(root->right);
-        node_del(root);
-    }
+    return e;
 }
 
-static struct node_t *get_node(const omap * const m, struct node_t *root, void *key) {
-    if (root == NULL || (*m->comp)(root->key, key) == 0) {
-        return root;
-    } else if ((*m->comp)(root->key, key) > 0) {
-        return get_node(m, root->left, key);
-    } else {
-        return get_node(m, root->right, key);
-    }
+static pair btree_entry(const btree * const b, struct btree_pos_t pos) {
+    pair e = { btree_key(b, pos), btree_val(b, pos) };
+    return e;
 }
 
-static struct node_t *get_floor_node(struct node_t *root) {
-    if (root == NULL || root->left == NULL) {
-        return root;
-    } else {
-        return get_floor_node(root->left);
-    }
-}
+static pair *entry_pair(pair e) {
+    struct pair_t *p = NULL;
 
-static struct node_t *get_ceil_node(struct node_t *root) {
-    if (root == NULL || root->right== NULL) {
-        return root;
-    } else {
-        return get_ceil_node(root->right);
+    if (e.key != NULL) {
+        p = pair_init();
+        p->key = e.key;
+        p->val = e.val;
     }
-}
 
-static struct node_t *get_lower_node(const omap * const m, void *key) {
-    struct node_t *n = get_node(m, m->data, key);
-    struct node_t *lo;
+    return p;
+}
 
-    if (n == get_floor_node(m->data)) {
-        lo = NULL;
-    } else if (n->left == NULL) {
-        bool done = false;
-        do {
-            lo = n->parent;
-            done = (n == lo->right);
-            n = lo;
-        } while (!done);
-    } else {
-        lo = get_ceil_node(n->left);
-    }
+static pair floor_entry(const omap * const m) {
+    return (m->b != NULL) ? btree_entry(m->b, btree_first(m->b)) : tree_entry(m->t, tree_first(m->t));
+}
 
-    return lo;
+static pair ceil_entry(const omap * const m) {
+    return (m->b != NULL) ? btree_entry(m->b, btree_last(m->b)) : tree_entry(m->t, tree_last(m->t));
 }
 
-static struct node_t *get_higher_node(const omap * const m, void *key) {
-    struct node_t *n = get_node(m, m->data, key);
-    struct node_t *hi;
+static pair lower_entry(const omap * const m, void *key) {
+    return (m->b != NULL)
+            ? btree_entry(m->b, btree_lower(m->b, key)) : tree_entry(m->t, tree_lower(m->t, key));
+}
 
-    if (n == get_ceil_node(m->data)) {
-        hi = NULL;
-    } else if (n->right == NULL) {
-        bool done = false;
-        do {
-            hi = n->parent;
-            done = (n == hi->left);
-            n = hi;
-        } while (!done);
-    } else {
-        hi = get_floor_node(n->right);
-    }
+static pair higher_entry(const omap * const m, void *key) {
+    return (m->b != NULL)
+            ? btree_entry(m->b, btree_higher(m->b, key)) : tree_entry(m->t, tree_higher(m->t, key));
+}
 
-    return hi;
+static pair select_entry(const omap * const m, size_t k) {
+    return (m->b != NULL) ? btree_entry(m->b, btree_select(m->b, k)) : tree_entry(m->t, tree_select(m->t, k));
 }
 
-static bool add_node(omap * const m, struct node_t *root, void *key, void *val) {
-    if (m->size == 0) {
-        m->data = node_init(m, key, val);
-        m->size = 1;
-        return true;
-    } else if ((*m->comp)(root->key, key) > 0) {
-        if (root->left == NULL) {
-            root->left = node_init(m, key, val);
-            root->left->parent = root;
-            m->size++;
-            return true;
-        } else {
-            add_node(m, root->left, key, val);
-        }
-    } else if ((*m->comp)(root->key, key) < 0) {
-        if (root->right == NULL) {
-            root->right = node_init(m, key, val);
-            root->right->parent = root;
-            m->size++;
-            return true;
-        } else {
-            add_node(m, root->right, key, val);
-        }
-    } else {
-        return false;
-    }
+static omap_iter tree_iter(const omap * const m, struct tree_node_t *n) {
+    omap_iter it = { m, n, 0 };
+    return it;
 }
 
-static bool remove_node(omap * const m, struct node_t *root, void *key) {
-    struct node_t *remove = get_node(m, root, key);
-    struct node_t *parent = (remove == NULL) ? NULL : remove->parent;
+static omap_iter btree_iter(const omap * const m, struct btree_pos_t pos) {
+    omap_iter it = { m, pos.node, pos.index };
+    return it;
+}
 
-    if (remove == NULL) {
-        return false;
-    } else if (remove->left == NULL && remove->right == NULL) {    // no children
-        if (parent != NULL) {
-            if ((*m->comp)(remove->key, parent->key) < 0) {
-                parent->left = NULL;
-            } else {
-                parent->right = NULL;
-            }
-        } else {
-            m->data = NULL;
-        }
+static struct btree_pos_t iter_pos(const omap_iter * const it) {
+    struct btree_pos_t pos = { it->node, it->index };
+    return pos;
+}
 
-        node_del(remove);
-        m->size--;
-        return true;
-    } else if (remove->right == NULL) {    // only has left child
-        if (parent == NULL) {
-            m->data = remove->left;
-            m->data->parent = NULL;
-        } else {
-            if ((*m->comp)(remove->key, parent->key) < 0) {
-                parent->left = remove->left;
-            } else {
-                parent->right = remove->left;
-            }
+static omap *omap_wrap(tree *t, btree *b) {
+    struct ordered_map_t *m = malloc(sizeof(*m));
+    m->t = t;
+    m->b = b;
+    return m;
+}
 
-            remove->left->parent = parent;
-        }
+omap *omap_init(size_t key_size, size_t val_size, int (*comp)(void *a, void *b)) {
+    return omap_wrap(tree_init(key_size, val_size, comp), NULL);
+}
 
-        node_del(remove);
-        m->size--;
-        return true;
-    } else if (remove->left == NULL) {    // only has right child
-        if (parent == NULL) {
-            m->data = remove->right;
-            m->data->parent = NULL;
-        } else {
-            if ((*m->comp)(remove->key, parent->key) < 0) {
-                parent->left = remove->right;
-            } else {
-                parent->right = remove->right;
-            }
+omap *omap_init_pooled(size_t key_size, size_t val_size, int (*comp)(void *a, void *b)) {
+    return omap_wrap(tree_init_pooled(key_size, val_size, comp), NULL);
+}
 
-            remove->right->parent = parent;
-        }
+/*
+ * Keeps entries in a B-tree whose nodes take up about |node_bytes| each;
+ * a few cache lines (eg. 256 bytes) suits most key sizes. Pointers into
+ * such a map are only valid until the next insert or remove.
+ */
+omap *omap_init_btree(size_t key_size, size_t val_size, int (*comp)(void *a, void *b), size_t node_bytes) {
+    return omap_wrap(NULL, btree_init(key_size, val_size, comp, node_bytes));
+}
 
-        node_del(remove);
-        m->size--;
-        return true;
-    } else {    // two children
-        struct node_t *floor = get_floor_node(remove->right);
-
-        void *tmp_key = malloc(m->key_size);
-        void *tmp_val = malloc(m->val_size);
-        memcpy(tmp_key, floor->key, m->key_size);
-        memcpy(tmp_val, floor->val, m->val_size);
-        remove_node(m, remove->right, floor->key);
-        memcpy(floor->key, tmp_key, m->key_size);
-        memcpy(floor->val, tmp_val, m->val_size);
-        free(tmp_key);
-        free(tmp_val);
-    }
+// |keys| holds |n| keys in strictly increasing order, which is not checked
+omap *omap_from_sorted(size_t key_size, size_t val_size, int (*comp)(void *a, void *b),
+        void *keys, void *vals, size_t n) {
+    return omap_wrap(tree_from_sorted(key_size, val_size, comp, keys, vals, n), NULL);
 }
 
-omap *omap_init(size_t key_size, size_t val_size, int (*comp)(void *a, void *b)) {
-    struct ordered_map_t *m = malloc(sizeof(*m));
-    m->size = 0;
-    m->key_size = key_size;
-    m->val_size = val_size;
-    m->data = NULL;
-    m->comp = comp;
-    return m;
+omap *omap_clone(const omap * const m) {
+    return (m->b != NULL) ? omap_wrap(NULL, btree_clone(m->b)) : omap_wrap(tree_clone(m->t), NULL);
 }
 
 void omap_del(omap **m) {
     if (*m != NULL) {
-        tree_del((*m)->data);
+        tree_del(&(*m)->t);
+        btree_del(&(*m)->b);
         free(*m);
         *m = NULL;
     }
 }
 
 size_t omap_size(const omap * const m) {
-    return m->size;
+    return (m->b != NULL) ? btree_size(m->b) : tree_size(m->t);
+}
+
+size_t omap_key_size(const omap * const m) {
+    return (m->b != NULL) ? m->b->key_size : m->t->key_size;
+}
+
+size_t omap_val_size(const omap * const m) {
+    return (m->b != NULL) ? m->b->val_size : m->t->val_size;
+}
+
+struct tree_t *omap_tree(const omap * const m) {
+    return m->t;
 }
 
 void *omap_get(omap * const m, void *key) {
-    struct node_t *n = get_node(m, m->data, key);
-    return (n == NULL) ? NULL : n->val;
+    if (m->b != NULL) {
+        return btree_val(m->b, btree_find(m->b, key));
+    } else {
+        struct tree_node_t *n = tree_find(m->t, key);
+        return (n == NULL) ? NULL : tree_val(m->t, n);
+    }
 }
 
 bool omap_insert(omap * const m, void *key, void *val) {
-    return add_node(m, m->data, key, val);
+    return (m->b != NULL) ? btree_insert(m->b, key, val) : tree_insert(m->t, key, val);
 }
 
 bool omap_remove(omap * const m, void *key) {
-    return remove_node(m, m->data, key);
+    return (m->b != NULL) ? btree_remove(m->b, key) : tree_remove(m->t, key);
 }
 
 bool omap_contains(const omap * const m, void *key) {
-    return get_node(m, m->data, key) != NULL;
+    return (m->b != NULL) ? btree_find(m->b, key).node != NULL : tree_find(m->t, key) != NULL;
 }
 
 pair *omap_floor(const omap * const m) {
-    struct node_t *floor = get_floor_node(m->data);
-    struct pair_t *p = NULL;
+    return entry_pair(floor_entry(m));
+}
 
-    if (floor != NULL) {
-        p = pair_init();
-        p->key = floor->key;
-        p->val = floor->val;
-    }
+pair *omap_ceil(const omap * const m) {
+    return entry_pair(ceil_entry(m));
+}
 
-    return p; 
+pair *omap_lower(const omap * const m, void *key) {
+    return entry_pair(lower_entry(m, key));
 }
 
-pair *omap_ceil(const omap * const m) {
-    struct node_t *ceil = get_ceil_node(m->data);
-    struct pair_t *p = NULL;
+pair *omap_higher(const omap * const m, void *key) {
+    return entry_pair(higher_entry(m, key));
+}
 
-    if (ceil != NULL) {
-        p = pair_init();
-        p->key = ceil->key;
-        p->val = ceil->val;
+// number of keys in |m| before |key|
+size_t omap_rank(const omap * const m, void *key) {
+    return (m->b != NULL) ? btree_rank(m->b, key) : tree_rank(m->t, key);
+}
+
+// entry with |k| keys before it, or NULL if |m| has no more than |k| entries
+pair *omap_select(const omap * const m, size_t k) {
+    return entry_pair(select_entry(m, k));
+}
+
+// number of keys in |m| from |lo| to |hi| inclusive
+size_t omap_count_range(const omap * const m, void *lo, void *hi) {
+    int (*comp)(void *a, void *b) = (m->b != NULL) ? m->b->comp : m->t->comp;
+
+    if ((*comp)(lo, hi) > 0) {
+        return 0;
     }
 
-    return p; 
+    return omap_rank(m, hi) - omap_rank(m, lo) + omap_contains(m, hi);
 }
 
-pair *omap_lower(const omap * const m, void *key) {
-    struct node_t *lo = get_lower_node(m, key);
-    struct pair_t *p = NULL;
+omap_iter omap_iter_begin(const omap * const m) {
+    return (m->b != NULL) ? btree_iter(m, btree_first(m->b)) : tree_iter(m, tree_first(m->t));
+}
 
-    if (lo != NULL) {
-        p = pair_init();
-        p->key = lo->key;
-        p->val = lo->val;
+omap_iter omap_iter_end(const omap * const m) {
+    omap_iter it = { m, NULL, 0 };
+    return it;
+}
+
+// first entry whose key is not before |key|
+omap_iter omap_iter_from(const omap * const m, void *key) {
+    return (m->b != NULL) ? btree_iter(m, btree_seek(m->b, key)) : tree_iter(m, tree_seek(m->t, key));
+}
+
+void omap_iter_next(omap_iter * const it) {
+    if (it->node == NULL) {
+        return;
+    } else if (it->m->b != NULL) {
+        struct btree_pos_t pos = iter_pos(it);
+        btree_next(it->m->b, &pos);
+        *it = btree_iter(it->m, pos);
+    } else {
+        it->node = tree_next(it->node);
     }
+}
 
-    return p;
+void omap_iter_prev(omap_iter * const it) {
+    // stepping back from the end lands on the last entry
+    if (it->m->b != NULL) {
+        struct btree_pos_t pos = iter_pos(it);
+
+        if (pos.node == NULL) {
+            pos = btree_last(it->m->b);
+        } else {
+            btree_prev(it->m->b, &pos);
+        }
+
+        *it = btree_iter(it->m, pos);
+    } else {
+        it->node = (it->node == NULL) ? tree_last(it->m->t) : tree_prev(it->node);
+    }
 }
 
-pair *omap_higher(const omap * const m, void *key) {
-    struct node_t *hi = get_higher_node(m, key);
-    struct pair_t *p = NULL;
+bool omap_iter_equal(const omap_iter * const a, const omap_iter * const b) {
+    return a->node == b->node && a->index == b->index;
+}
 
-    if (hi != NULL) {
-        p = pair_init();
-        p->key = hi->key;
-        p->val = hi->val;
+void *omap_iter_key(const omap_iter * const it) {
+    if (it->node == NULL) {
+        return NULL;
+    } else if (it->m->b != NULL) {
+        return btree_key(it->m->b, iter_pos(it));
+    } else {
+        return ((struct tree_node_t *)it->node)->key;
     }
+}
 
-    return p;
+void *omap_iter_val(const omap_iter * const it) {
+    if (it->node == NULL) {
+        return NULL;
+    } else if (it->m->b != NULL) {
+        return btree_val(it->m->b, iter_pos(it));
+    } else {
+        return tree_val(it->m->t, it->node);
+    }
+}
+
+// removes the entry at |it| and moves |it| to the next one
+void omap_iter_erase(omap * const m, omap_iter * const it) {
+    if (it->node == NULL) {
+        return;
+    } else if (m->b != NULL) {
+        struct btree_pos_t pos = iter_pos(it);
+        btree_erase(m->b, &pos);
+        *it = btree_iter(m, pos);
+    } else {
+        struct tree_node_t *next = tree_next(it->node);
+        tree_erase(m->t, it->node);
+        it->node = next;
+    }
 }
 
 void *omap_floor_key(const omap * const m) {
-    struct node_t *floor = get_floor_node(m->data);
-    return (floor == NULL) ? NULL : floor->key;
+    return floor_entry(m).key;
 }
 
 void *omap_ceil_key(const omap * const m) {
-    struct node_t *ceil = get_ceil_node(m->data);
-    return (ceil == NULL) ? NULL : ceil->key;
+    return ceil_entry(m).key;
 }
 
 void *omap_lower_key(const omap * const m, void *key) {
-    struct node_t *lo = get_lower_node(m, key);
-    return (lo == NULL) ? NULL : lo->key;
+    return lower_entry(m, key).key;
 }
 
 void *omap_higher_key(const omap * const m, void *key) {
-    struct node_t *hi = get_higher_node(m, key);
-    return (hi == NULL) ? NULL : hi->key;
+    return higher_entry(m, key).key;
+}
+
+void *omap_select_key(const omap * const m, size_t k) {
+    return select_entry(m, k).key;
+}
+
+void omap_stats(const omap * const m, container_stats *out) {
+    if (m->b != NULL) {
+        btree_stats(m->b, out);
+    } else {
+        tree_stats(m->t, out);
+    }
+}
+
+void omap_stats_reset(omap * const m) {
+    if (m->b != NULL) {
+        btree_stats_reset(m->b);
+    } else {
+        tree_stats_reset(m->t);
+    }
 }
 
@@ -5,13 +5,31 @@
 #include <stdbool.h>    // bool
 
 #include "pair.h"
+#include "stats.h"
 
 typedef struct ordered_map_t omap;
 
+// position of an entry in an omap; |node| is NULL past the end
+typedef struct omap_iter_t {
+    const omap *m;
+    void *node;
+    size_t index;   // entry within |node|, for B-tree maps
+} omap_iter;
+
 omap *omap_init(size_t key_size, size_t val_size, int (*comp)(void *a, void *b));
+omap *omap_init_pooled(size_t key_size, size_t val_size, int (*comp)(void *a, void *b));
+omap *omap_init_btree(size_t key_size, size_t val_size, int (*comp)(void *a, void *b), size_t node_bytes);
+omap *omap_from_sorted(size_t key_size, size_t val_size, int (*comp)(void *a, void *b),
+        void *keys, void *vals, size_t n);
+omap *omap_clone(const omap * const m);
 void omap_del(omap **m);
 
 size_t omap_size(const omap * const m);
+size_t omap_key_size(const omap * const m);
+size_t omap_val_size(const omap * const m);
+
+// the red-black tree holding the entries, or NULL for a B-tree map; for typed.h
+struct tree_t *omap_tree(const omap * const m);
 
 void *omap_get(omap * const m, void *key);
 bool omap_insert(omap * const m, void *key, void *val);
@@ -23,10 +41,30 @@ pair *omap_ceil(const omap * const m);
 pair *omap_lower(const omap * const m, void *key);
 pair *omap_higher(const omap * const m, void *key);
 
+size_t omap_rank(const omap * const m, void *key);
+pair *omap_select(const omap * const m, size_t k);
+size_t omap_count_range(const omap * const m, void *lo, void *hi);
+
+omap_iter omap_iter_begin(const omap * const m);
+omap_iter omap_iter_end(const omap * const m);
+omap_iter omap_iter_from(const omap * const m, void *key);
+
+void omap_iter_next(omap_iter * const it);
+void omap_iter_prev(omap_iter * const it);
+bool omap_iter_equal(const omap_iter * const a, const omap_iter * const b);
+
+void *omap_iter_key(const omap_iter * const it);
+void *omap_iter_val(const omap_iter * const it);
+void omap_iter_erase(omap * const m, omap_iter * const it);
+
 void *omap_floor_key(const omap * const m);
 void *omap_ceil_key(const omap * const m);
 void *omap_lower_key(const omap * const m, void *key);
 void *omap_higher_key(const omap * const m, void *key);
+void *omap_select_key(const omap * const m, size_t k);
+
+void omap_stats(const omap * const m, container_stats *out);
+void omap_stats_reset(omap * const m);
 
 #endif
 
@@ -1,306 +1,256 @@
 #include "oset.h"
 
 #include <stdlib.h>     // malloc(), free()
-#include <string.h>     // memcpy()
 
-struct node_t {
-    void *val;
-    struct node_t *left, *right, *parent;
-};
+#include "tree.h"
 
 struct ordered_set_t {
-    size_t size;
-    size_t elem_size;
-    struct node_t *data;
-
-    /*
-     * < 0    *a before *b
-     * 0      *a and *b equivalent
-     * > 0    *a after *b
-     */
-    int (*comp)(void *a, void *b);
+    tree *t;
 };
 
-static struct node_t *node_init(const oset * const s, void *val) {
-    struct node_t *n = malloc(sizeof(*n));
-    n->left = n->right = n->parent = NULL;
-    n->val = malloc(s->elem_size);
-    memcpy(n->val, val, s->elem_size);
-    return n;
-}
-
-static void node_del(struct node_t *n) {
-    if (n != NULL) {
-        free(n->val);
-        free(n);
-    }
-}
-
-static void tree_del(struct node_t *root) {
-    if (root != NULL) {
-        tree_del(root->left);
-        tree_del(root->right);
-        node_del(root);
-    }
-}
-
-static struct node_t *get_node(const oset * const s, struct node_t *root, void *val) {
-    if (root == NULL || (*s->comp)(root->val, val) == 0) {
-        return root;
-    } else if ((*s->comp)(root->val, val) > 0) {
-        return get_node(s, root->left, val);
-    } else {
-        return get_node(s, root->right, val);
-    }
-}
-
-static struct node_t *get_floor_node(struct node_t *root) {
-    if (root == NULL || root->left == NULL) {
-        return root;
-    } else {
-        return get_floor_node(root->left);
-    }
-}
-
-static struct node_t *get_ceil_node(struct node_t *root) {
-    if (root == NULL || root->right== NULL) {
-        return root;
-    } else {
-        return get_ceil_node(root->right);
-    }
-}
-
-static bool add_node(oset * const s, struct node_t *root, void *val) {
-    if (s->size == 0) {
-        s->data = node_init(s, val);
-        s->size = 1;
-        return true;
-    } else if ((*s->comp)(root->val, val) > 0) {
-        if (root->left == NULL) {
-            root->left = node_init(s, val);
-            root->left->parent = root;
-            s->size++;
-            return true;
-        } else {
-            add_node(s, root->left, val);
-        }
-    } else if ((*s->comp)(root->val, val) < 0) {
-        if (root->right == NULL) {
-            root->right = node_init(s, val);
-            root->right->parent = root;
-            s->size++;
-            return true;
-        } else {
-            add_node(s, root->right, val);
+// which elems a set operation keeps, by membership in its operands
+#define ONLY_A 1
+#define BOTH 2
+#define ONLY_B 4
+
+/*
+ * Walks |a| and |b| in order side by side and links the elems selected by
+ * |keep| into |dst|, which is either empty or |a| itself. Each operation is
+ * O(|a| + |b|); when |dst| is |a|, its kept nodes are reused as they are.
+ */
+static void merge(tree * const dst, const tree * const a, const tree * const b, int keep) {
+    bool in_place = (dst == a);
+    struct tree_node_t **nodes = malloc((a->size + b->size) * sizeof(*nodes));
+    struct tree_node_t **a_nodes = NULL;
+    struct tree_node_t *x = tree_first(a);
+    struct tree_node_t *y = tree_first(b);
+    size_t n = 0, i = 0, dropped = 0;
+
+    if (in_place) {
+        /*
+         * Gather |a| up front: the walk climbs through parent links, so it
+         * must not meet nodes that have already been dropped.
+         */
+        a_nodes = malloc(a->size * sizeof(*a_nodes));
+        for (; x != NULL; x = tree_next(x)) {
+            a_nodes[i++] = x;
         }
-    } else {
-        return false;
+
+        i = 0;
+        x = (a->size > 0) ? a_nodes[0] : NULL;
     }
-}
 
-static bool remove_node(oset * const s, struct node_t *root, void *val) {
-    struct node_t *remove = get_node(s, root, val);
-    struct node_t *parent = (remove == NULL) ? NULL : remove->parent;
+    while (x != NULL || y != NULL) {
+        int c = (x == NULL) ? 1 : (y == NULL) ? -1 : (*a->comp)(x->key, y->key);
+        STATS_ADD(dst, comparisons, x != NULL && y != NULL);
 
-    if (remove == NULL) {
-        return false;
-    } else if (remove->left == NULL && remove->right == NULL) {    // no children
-        if (parent != NULL) {
-            if ((*s->comp)(remove->val, parent->val) < 0) {
-                parent->left = NULL;
-            } else {
-                parent->right = NULL;
+        if (c <= 0) {
+            if (keep & ((c < 0) ? ONLY_A : BOTH)) {
+                nodes[n++] = in_place ? x : tree_node_init(dst, x->key, NULL);
+            } else if (in_place) {
+                a_nodes[dropped++] = x;     // never overtakes |i|
             }
-        } else {
-            s->data = NULL;
-        }
 
-        node_del(remove);
-        s->size--;
-        return true;
-    } else if (remove->right == NULL) {    // only has left child
-        if (parent == NULL) {
-            s->data = remove->left;
-            s->data->parent = NULL;
-        } else {
-            if ((*s->comp)(remove->val, parent->val) < 0) {
-                parent->left = remove->left;
+            if (in_place) {
+                x = (++i < a->size) ? a_nodes[i] : NULL;
             } else {
-                parent->right = remove->left;
+                x = tree_next(x);
             }
-
-            remove->left->parent = parent;
         }
 
-        node_del(remove);
-        s->size--;
-        return true;
-    } else if (remove->left == NULL) {    // only has right child
-        if (parent == NULL) {
-            s->data = remove->right;
-            s->data->parent = NULL;
-        } else {
-            if ((*s->comp)(remove->val, parent->val) < 0) {
-                parent->left = remove->right;
-            } else {
-                parent->right = remove->right;
+        if (c >= 0) {
+            if (c > 0 && (keep & ONLY_B)) {
+                nodes[n++] = tree_node_init(dst, y->key, NULL);
             }
 
-            remove->right->parent = parent;
+            y = tree_next(y);
         }
+    }
 
-        node_del(remove);
-        s->size--;
-        return true;
-    } else {    // two children
-        struct node_t *floor = get_floor_node(remove->right);
-        void *temp = malloc(s->elem_size);
-        memcpy(temp, floor->val, s->elem_size);
-        remove_node(s, remove->right, floor->val);
-        memcpy(floor->val, temp, s->elem_size);
-        free(temp);
+    for (i = 0; i < dropped; i++) {
+        tree_node_del(dst, a_nodes[i]);
     }
+
+    tree_link_sorted(dst, nodes, n);
+    free(nodes);
+    free(a_nodes);
 }
 
-oset *oset_init(size_t elem_size, int (*comp)(void *a, void *b)) {
+static oset *oset_wrap(tree *t) {
     struct ordered_set_t *s = malloc(sizeof(*s));
-    s->size = 0;
-    s->elem_size = elem_size;
-    s->data = NULL;
-    s->comp = comp;
+    s->t = t;
     return s;
 }
 
+oset *oset_init(size_t elem_size, int (*comp)(void *a, void *b)) {
+    return oset_wrap(tree_init(elem_size, 0, comp));
+}
+
+oset *oset_init_pooled(size_t elem_size, int (*comp)(void *a, void *b)) {
+    return oset_wrap(tree_init_pooled(elem_size, 0, comp));
+}
+
+// |data| holds |n| elems in strictly increasing order, which is not checked
+oset *oset_from_sorted(size_t elem_size, int (*comp)(void *a, void *b), void *data, size_t n) {
+    return oset_wrap(tree_from_sorted(elem_size, 0, comp, data, NULL, n));
+}
+
+oset *oset_clone(const oset * const s) {
+    return oset_wrap(tree_clone(s->t));
+}
+
 void oset_del(oset **s) {
     if (*s != NULL) {
-        tree_del((*s)->data);
+        tree_del(&(*s)->t);
         free(*s);
         *s = NULL;
     }
 }
 
 size_t oset_size(const oset * const s) {
-    return s->size;
+    return tree_size(s->t);
+}
+
+size_t oset_elem_size(const oset * const s) {
+    return s->t->key_size;
+}
+
+struct tree_t *oset_tree(const oset * const s) {
+    return s->t;
 }
 
 bool oset_insert(oset * const s, void *val) {
-    return add_node(s, s->data, val);
+    return tree_insert(s->t, val, NULL);
 }
 
 bool oset_remove(oset * const s, void *val) {
-    return remove_node(s, s->data, val);
+    return tree_remove(s->t, val);
 }
 
 bool oset_contains(const oset * const s, void *val) {
-    return get_node(s, s->data, val) != NULL;
+    return tree_find(s->t, val) != NULL;
 }
 
 void *oset_floor(const oset * const s) {
-    struct node_t *floor = get_floor_node(s->data);
-    return (floor == NULL) ? NULL : floor->val; 
+    struct tree_node_t *floor = tree_first(s->t);
+    return (floor == NULL) ? NULL : floor->key;
 }
 
 void *oset_ceil(const oset * const s) {
-    struct node_t *ceil = get_ceil_node(s->data);
-    return (ceil == NULL) ? NULL : ceil->val; 
+    struct tree_node_t *ceil = tree_last(s->t);
+    return (ceil == NULL) ? NULL : ceil->key;
 }
 
 void *oset_lower(const oset * const s, void *val) {
-    struct node_t *n = get_node(s, s->data, val);
-    struct node_t *lo;
-
-    if (n == get_floor_node(s->data)) {
-        lo = NULL;
-    } else if (n->left == NULL) {
-        bool done = false;
-        do {
-            lo = n->parent;
-            done = (n == lo->right);
-            n = lo;
-        } while (!done);
-    } else {
-        lo = get_ceil_node(n->left);
-    }
-
-    return (lo == NULL) ? NULL : lo->val;
+    struct tree_node_t *lo = tree_lower(s->t, val);
+    return (lo == NULL) ? NULL : lo->key;
 }
 
 void *oset_higher(const oset * const s, void *val) {
-    struct node_t *n = get_node(s, s->data, val);
-    struct node_t *hi;
-
-    if (n == get_ceil_node(s->data)) {
-        hi = NULL;
-    } else if (n->right == NULL) {
-        bool done = false;
-        do {
-            hi = n->parent;
-            done = (n == hi->left);
-            n = hi;
-        } while (!done);
-    } else {
-        hi = get_floor_node(n->right);
-    }
+    struct tree_node_t *hi = tree_higher(s->t, val);
+    return (hi == NULL) ? NULL : hi->key;
+}
 
-    return (hi == NULL) ? NULL : hi->val;
+// number of elems in |s| before |val|
+size_t oset_rank(const oset * const s, void *val) {
+    return tree_rank(s->t, val);
 }
 
-oset *oset_union(const oset * const a, const oset * const b) {
-    struct ordered_set_t *result = oset_init(a->elem_size, a->comp);
-    void *cur;
-    size_t i;
-
-    cur = oset_floor(a);
-    for (i = 0; i < a->size; i++) {
-        oset_insert(result, cur);
-        cur = oset_higher(a, cur);
-    }
+// elem with |k| elems before it, or NULL if |s| has no more than |k| elems
+void *oset_select(const oset * const s, size_t k) {
+    struct tree_node_t *n = tree_select(s->t, k);
+    return (n == NULL) ? NULL : n->key;
+}
 
-    cur = oset_floor(b);
-    for (i = 0; i < b->size; i++) {
-        oset_insert(result, cur);
-        cur = oset_higher(b, cur);
+// number of elems in |s| from |lo| to |hi| inclusive
+size_t oset_count_range(const oset * const s, void *lo, void *hi) {
+    if ((*s->t->comp)(lo, hi) > 0) {
+        return 0;
     }
 
-    return result;
+    return tree_rank(s->t, hi) - tree_rank(s->t, lo) + oset_contains(s, hi);
 }
 
-oset *oset_intxn(const oset * const a, const oset * const b) {
-    struct ordered_set_t *result = oset_init(a->elem_size, a->comp);
-    const struct ordered_set_t *base, *other;
-
-    if (a->size < b->size) {
-        base = a;
-        other = b;
-    } else {
-        base = b;
-        other = a;
+oset_iter oset_iter_begin(const oset * const s) {
+    oset_iter it = { s, tree_first(s->t) };
+    return it;
+}
+
+oset_iter oset_iter_end(const oset * const s) {
+    oset_iter it = { s, NULL };
+    return it;
+}
+
+// first elem not before |val|
+oset_iter oset_iter_from(const oset * const s, void *val) {
+    oset_iter it = { s, tree_seek(s->t, val) };
+    return it;
+}
+
+void oset_iter_next(oset_iter * const it) {
+    if (it->node != NULL) {
+        it->node = tree_next((struct tree_node_t *)it->node);
     }
+}
 
-    void *cur = oset_floor(base);
-    size_t i;
-    for (i = 0; i < base->size; i++) {
-        if (oset_contains(other, cur)) {
-            oset_insert(result, cur);
-        }
-        cur = oset_higher(base, cur);
+void oset_iter_prev(oset_iter * const it) {
+    // stepping back from the end lands on the last elem
+    it->node = (it->node == NULL) ? tree_last(it->s->t) : tree_prev((struct tree_node_t *)it->node);
+}
+
+bool oset_iter_equal(const oset_iter * const a, const oset_iter * const b) {
+    return a->node == b->node;
+}
+
+void *oset_iter_get(const oset_iter * const it) {
+    return (it->node == NULL) ? NULL : ((struct tree_node_t *)it->node)->key;
+}
+
+// removes the elem at |it| and moves |it| to the next one
+void oset_iter_erase(oset * const s, oset_iter * const it) {
+    if (it->node != NULL) {
+        // erasing relinks nodes rather than moving elems, so |next| stays valid
+        struct tree_node_t *next = tree_next((struct tree_node_t *)it->node);
+        tree_erase(s->t, it->node);
+        it->node = next;
     }
+}
+
+oset *oset_union(const oset * const a, const oset * const b) {
+    oset *result = oset_init(a->t->key_size, a->t->comp);
+    merge(result->t, a->t, b->t, ONLY_A | BOTH | ONLY_B);
+    return result;
+}
 
+oset *oset_intxn(const oset * const a, const oset * const b) {
+    oset *result = oset_init(a->t->key_size, a->t->comp);
+    merge(result->t, a->t, b->t, BOTH);
     return result;
 }
 
 oset *oset_diff(const oset * const a, const oset * const b) {
-    struct ordered_set_t *result = oset_init(a->elem_size, a->comp);
+    oset *result = oset_init(a->t->key_size, a->t->comp);
+    merge(result->t, a->t, b->t, ONLY_A);
+    return result;
+}
 
-    void *cur = oset_floor(a);
-    size_t i;
-    for (i = 0; i < a->size; i++) {
-        if (!oset_contains(b, cur)) {
-            oset_insert(result, cur);
-        }
-        cur = oset_higher(a, cur);
-    }
+void oset_union_into(oset * const a, const oset * const b) {
+    merge(a->t, a->t, b->t, ONLY_A | BOTH | ONLY_B);
+}
 
-    return result;
+void oset_intxn_into(oset * const a, const oset * const b) {
+    merge(a->t, a->t, b->t, BOTH);
+}
+
+void oset_diff_into(oset * const a, const oset * const b) {
+    merge(a->t, a->t, b->t, ONLY_A);
+}
+
+void oset_stats(const oset * const s, container_stats *out) {
+    tree_stats(s->t, out);
+}
+
+void oset_stats_reset(oset * const s) {
+    tree_stats_reset(s->t);
 }
 
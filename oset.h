@@ -4,12 +4,27 @@
 #include <stddef.h>     // size_t
 #include <stdbool.h>    // bool
 
+#include "stats.h"
+
 typedef struct ordered_set_t oset;
 
+// position of an elem in an oset; |node| is NULL past the end
+typedef struct oset_iter_t {
+    const oset *s;
+    void *node;
+} oset_iter;
+
 oset *oset_init(size_t elem_size, int (*comp)(void *a, void *b));
+oset *oset_init_pooled(size_t elem_size, int (*comp)(void *a, void *b));
+oset *oset_from_sorted(size_t elem_size, int (*comp)(void *a, void *b), void *data, size_t n);
+oset *oset_clone(const oset * const s);
 void oset_del(oset **s);
 
 size_t oset_size(const oset * const s);
+size_t oset_elem_size(const oset * const s);
+
+// the red-black tree holding the elems, for typed.h
+struct tree_t *oset_tree(const oset * const s);
 
 bool oset_insert(oset * const s, void *val);
 bool oset_remove(oset * const s, void *val);
@@ -20,9 +35,31 @@ void *oset_ceil(const oset * const s);
 void *oset_lower(const oset * const s, void *val);
 void *oset_higher(const oset * const s, void *val);
 
+size_t oset_rank(const oset * const s, void *val);
+void *oset_select(const oset * const s, size_t k);
+size_t oset_count_range(const oset * const s, void *lo, void *hi);
+
+oset_iter oset_iter_begin(const oset * const s);
+oset_iter oset_iter_end(const oset * const s);
+oset_iter oset_iter_from(const oset * const s, void *val);
+
+void oset_iter_next(oset_iter * const it);
+void oset_iter_prev(oset_iter * const it);
+bool oset_iter_equal(const oset_iter * const a, const oset_iter * const b);
+
+void *oset_iter_get(const oset_iter * const it);
+void oset_iter_erase(oset * const s, oset_iter * const it);
+
 oset *oset_union(const oset * const a, const oset * const b);
 oset *oset_intxn(const oset * const a, const oset * const b);
 oset *oset_diff(const oset * const a, const oset * const b);
 
+void oset_union_into(oset * const a, const oset * const b);
+void oset_intxn_into(oset * const a, const oset * const b);
+void oset_diff_into(oset * const a, const oset * const b);
+
+void oset_stats(const oset * const s, container_stats *out);
+void oset_stats_reset(oset * const s);
+
 #endif
 
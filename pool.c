@@ -0,0 +1,99 @@
+#include "pool.h"
+
+#include <stdlib.h>     // malloc(), free()
+
+#define INIT_CHUNK_NODES 64
+#define MAX_CHUNK_NODES ((size_t)1 << 20)
+
+struct chunk_t {
+    struct chunk_t *next;
+    _Alignas(max_align_t) unsigned char nodes[];
+};
+
+struct pool_t {
+    size_t node_size;
+    struct chunk_t *chunks;
+
+    // unused part of the newest chunk
+    unsigned char *next_node;
+    size_t nodes_left, chunk_nodes;
+
+    void *free_list;    // each free node stores a pointer to the next one
+};
+
+static void pool_grow(pool * const p) {
+    struct chunk_t *c = malloc(sizeof(*c) + p->chunk_nodes * p->node_size);
+
+    if (c != NULL) {
+        c->next = p->chunks;
+        p->chunks = c;
+        p->next_node = c->nodes;
+        p->nodes_left = p->chunk_nodes;
+
+        // chunks double in size so a pool of n nodes takes O(log n) of them
+        if (p->chunk_nodes < MAX_CHUNK_NODES) {
+            p->chunk_nodes *= 2;
+        }
+    }
+}
+
+pool *pool_init(size_t node_size) {
+    struct pool_t *p = malloc(sizeof(*p));
+    size_t align = _Alignof(max_align_t);
+
+    if (node_size < sizeof(void *)) {
+        node_size = sizeof(void *);
+    }
+
+    p->node_size = (node_size + align - 1) / align * align;
+    p->chunks = NULL;
+    p->next_node = NULL;
+    p->nodes_left = 0;
+    p->chunk_nodes = INIT_CHUNK_NODES;
+    p->free_list = NULL;
+    return p;
+}
+
+void pool_del(pool **p) {
+    if (*p != NULL) {
+        struct chunk_t *c = (*p)->chunks;
+
+        while (c != NULL) {
+            struct chunk_t *next = c->next;
+            free(c);
+            c = next;
+        }
+
+        free(*p);
+        *p = NULL;
+    }
+}
+
+void *pool_alloc(pool * const p) {
+    void *node = p->free_list;
+
+    if (node != NULL) {
+        p->free_list = *(void **)node;
+        return node;
+    }
+
+    if (p->nodes_left == 0) {
+        pool_grow(p);
+        if (p->nodes_left == 0) {   // out of memory
+            return NULL;
+        }
+    }
+
+    node = p->next_node;
+    p->next_node += p->node_size;
+    p->nodes_left--;
+    return node;
+}
+
+void pool_free(pool * const p, void *node) {
+    if (node != NULL) {
+        *(void **)node = p->free_list;
+        p->free_list = node;
+    }
+}
+
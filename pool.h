@@ -0,0 +1,20 @@
+#ifndef POOL_H
+#define POOL_H
+
+#include <stddef.h>     // size_t
+
+/*
+ * Fixed-size node allocator. Nodes are carved from large chunks and freed
+ * nodes are recycled through a free list; pool_del() releases every node
+ * at once with one free() per chunk.
+ */
+
+typedef struct pool_t pool;
+
+pool *pool_init(size_t node_size);
+void pool_del(pool **p);
+
+void *pool_alloc(pool * const p);
+void pool_free(pool * const p, void *node);
+
+#endif
@@ -0,0 +1,373 @@
+#include "pqueue.h"
+
+#include <stdlib.h>     // malloc(), free()
+#include <string.h>     // memcpy()
+
+#include "vector.h"
+
+#define MAX_SHIFT 6     // up to 64 children per node
+#define NO_SLOT SIZE_MAX
+
+struct priority_queue_t {
+    vector *heap;       // children of the elem at |i| from |i| * arity + 1 on
+    size_t shift;       // log2 of the arity
+    int (*comp)(void *a, void *b);
+    void *hole;         // the elem being sifted, held out of the heap meanwhile
+
+    // all NULL until the first handle is handed out
+    vector *ids;        // handle of the elem at each heap index, or PQUEUE_NO_HANDLE
+    vector *slots;      // heap index of the elem with each handle, or NO_SLOT
+    vector *free_ids;   // handles whose elems are gone, to reuse
+};
+
+static inline void *at(const pqueue * const q, size_t i) {
+    return (unsigned char *)q->heap->data + i * q->heap->elem_size;
+}
+
+static inline size_t *id_at(const pqueue * const q, size_t i) {
+    return (size_t *)q->ids->data + i;
+}
+
+static inline size_t *slot_of(const pqueue * const q, size_t id) {
+    return (size_t *)q->slots->data + id;
+}
+
+static inline size_t parent(const pqueue * const q, size_t i) {
+    return (i - 1) >> q->shift;
+}
+
+static inline bool before(const pqueue * const q, void *a, void *b) {
+    STATS_ADD(q->heap, comparisons, 1);
+    return (*q->comp)(a, b) < 0;
+}
+
+// copies |val| to heap index |i| and points handle |id|, if any, at it
+static void place(pqueue * const q, size_t i, void *val, size_t id) {
+    memcpy(at(q, i), val, q->heap->elem_size);
+    STATS_ADD(q->heap, bytes_copied, q->heap->elem_size);
+
+    if (q->ids != NULL) {
+        *id_at(q, i) = id;
+        if (id != PQUEUE_NO_HANDLE) {
+            *slot_of(q, id) = i;
+        }
+    }
+}
+
+static void move(pqueue * const q, size_t to, size_t from) {
+    place(q, to, at(q, from), (q->ids != NULL) ? *id_at(q, from) : PQUEUE_NO_HANDLE);
+}
+
+/*
+ * Both sifts move a hole at |i| towards where |q->hole| belongs, shifting
+ * the elems they pass over by one level rather than swapping, and return
+ * the index the hole ends at.
+ */
+static size_t sift_up(pqueue * const q, size_t i) {
+    while (i > 0 && before(q, q->hole, at(q, parent(q, i)))) {
+        move(q, i, parent(q, i));
+        i = parent(q, i);
+    }
+
+    return i;
+}
+
+static size_t sift_down(pqueue * const q, size_t i) {
+    size_t size = q->heap->size, arity = (size_t)1 << q->shift;
+    size_t first, last, least, c;
+
+    while ((first = (i << q->shift) + 1) < size) {
+        last = (size - first < arity) ? size : first + arity;
+
+        for (least = first, c = first + 1; c < last; c++) {
+            if (before(q, at(q, c), at(q, least))) {
+                least = c;
+            }
+        }
+
+        if (!before(q, at(q, least), q->hole)) {
+            break;
+        }
+
+        move(q, i, least);
+        i = least;
+    }
+
+    return i;
+}
+
+// fills the hole at |i| with |q->hole|, which has handle |id|, up or down the heap
+static void settle(pqueue * const q, size_t i, size_t id) {
+    size_t to = sift_up(q, i);
+
+    if (to == i) {
+        to = sift_down(q, i);
+    }
+
+    place(q, to, q->hole, id);
+}
+
+// sifts every parent down, deepest first, which takes O(n) comparisons in all
+static void rebuild(pqueue * const q) {
+    size_t i, id;
+
+    if (q->heap->size < 2) {
+        return;
+    }
+
+    for (i = parent(q, q->heap->size - 1) + 1; i-- > 0; ) {
+        // sift_down() overwrites the id at |i|, so take it first
+        id = (q->ids != NULL) ? *id_at(q, i) : PQUEUE_NO_HANDLE;
+        memcpy(q->hole, at(q, i), q->heap->elem_size);
+        place(q, sift_down(q, i), q->hole, id);
+    }
+}
+
+// grows |q->ids| to |size| entries of PQUEUE_NO_HANDLE, or leaves it be if out of memory
+static bool pad_ids(pqueue * const q, size_t size) {
+    size_t old_size = q->ids->size, none = PQUEUE_NO_HANDLE;
+
+    while (q->ids->size < size) {
+        size_t prev = q->ids->size;
+
+        vector_push_back(q->ids, &none);
+        if (q->ids->size == prev) {
+            vector_erase_range(q->ids, old_size, prev);
+            return false;
+        }
+    }
+
+    return true;
+}
+
+static bool push(pqueue * const q, void *val, size_t id) {
+    size_t size = q->heap->size;
+
+    // |val| may point into the heap, which growing it can move
+    memcpy(q->hole, val, q->heap->elem_size);
+
+    vector_push_back(q->heap, q->hole);
+    if (q->heap->size == size) {
+        return false;
+    }
+
+    if (q->ids != NULL && !pad_ids(q, size + 1)) {
+        vector_pop_back(q->heap);
+        return false;
+    }
+
+    place(q, sift_up(q, size), q->hole, id);
+    return true;
+}
+
+static void release(pqueue * const q, size_t id) {
+    if (id != PQUEUE_NO_HANDLE) {
+        *slot_of(q, id) = NO_SLOT;
+        vector_push_back(q->free_ids, &id);
+    }
+}
+
+// fills the gap at |i| with the last elem
+static void remove_at(pqueue * const q, size_t i) {
+    size_t last = q->heap->size - 1, id = PQUEUE_NO_HANDLE;
+
+    if (q->ids != NULL) {
+        release(q, *id_at(q, i));
+        id = *id_at(q, last);
+        vector_pop_back(q->ids);
+    }
+
+    memcpy(q->hole, at(q, last), q->heap->elem_size);
+    vector_pop_back(q->heap);
+
+    if (i < last) {
+        settle(q, i, id);
+    }
+}
+
+// heap index of the elem with |handle|, or NO_SLOT
+static size_t slot(const pqueue * const q, size_t handle) {
+    return (q->ids != NULL && handle < q->slots->size) ? *slot_of(q, handle) : NO_SLOT;
+}
+
+static bool track(pqueue * const q) {
+    if (q->ids == NULL) {
+        q->ids = vector_init(sizeof(size_t));
+        q->slots = vector_init(sizeof(size_t));
+        q->free_ids = vector_init(sizeof(size_t));
+
+        if (!pad_ids(q, q->heap->size)) {
+            vector_del(&q->ids);
+            vector_del(&q->slots);
+            vector_del(&q->free_ids);
+            return false;
+        }
+    }
+
+    return true;
+}
+
+pqueue *pqueue_init(size_t elem_size, size_t arity, int (*comp)(void *a, void *b)) {
+    struct priority_queue_t *q = malloc(sizeof(*q));
+    q->heap = vector_init(elem_size);
+    q->comp = comp;
+    q->hole = malloc(elem_size);
+    q->ids = q->slots = q->free_ids = NULL;
+
+    q->shift = 1;
+    while (q->shift < MAX_SHIFT && ((size_t)2 << q->shift) <= arity) {
+        q->shift++;
+    }
+
+    return q;
+}
+
+pqueue *pqueue_heapify(size_t elem_size, size_t arity, int (*comp)(void *a, void *b),
+        void *data, size_t n) {
+    pqueue *q = pqueue_init(elem_size, arity, comp);
+    vector_append(q->heap, data, n);
+    rebuild(q);
+    return q;
+}
+
+void pqueue_del(pqueue **q) {
+    if (*q != NULL) {
+        vector_del(&(*q)->heap);
+        vector_del(&(*q)->ids);
+        vector_del(&(*q)->slots);
+        vector_del(&(*q)->free_ids);
+        free((*q)->hole);
+        free(*q);
+        *q = NULL;
+    }
+}
+
+size_t pqueue_size(const pqueue * const q) {
+    return q->heap->size;
+}
+
+void *pqueue_top(const pqueue * const q) {
+    return (q->heap->size == 0) ? NULL : at(q, 0);
+}
+
+void pqueue_push(pqueue * const q, void *val) {
+    push(q, val, PQUEUE_NO_HANDLE);
+}
+
+void pqueue_pop(pqueue * const q) {
+    if (q->heap->size > 0) {
+        remove_at(q, 0);
+    }
+}
+
+/*
+ * Sifting each elem up costs O(log n) at worst, so a batch at least as big
+ * as the queue is cheaper appended whole and the heap rebuilt around it.
+ */
+void pqueue_push_n(pqueue * const q, void *vals, size_t n) {
+    size_t size = q->heap->size, i;
+
+    if (n < size) {
+        for (i = 0; i < n; i++) {
+            push(q, (unsigned char *)vals + i * q->heap->elem_size, PQUEUE_NO_HANDLE);
+        }
+        return;
+    }
+
+    vector_append(q->heap, vals, n);
+    if (q->heap->size == size) {
+        return;
+    }
+
+    if (q->ids != NULL && !pad_ids(q, size + n)) {
+        vector_erase_range(q->heap, size, size + n);
+        return;
+    }
+
+    rebuild(q);
+}
+
+size_t pqueue_push_handle(pqueue * const q, void *val) {
+    size_t id, none = NO_SLOT;
+
+    if (!track(q)) {
+        return PQUEUE_NO_HANDLE;
+    }
+
+    if (q->free_ids->size > 0) {
+        id = *(size_t *)vector_get(q->free_ids, q->free_ids->size - 1);
+        vector_pop_back(q->free_ids);
+    } else {
+        id = q->slots->size;
+        vector_push_back(q->slots, &none);
+        if (q->slots->size == id) {
+            return PQUEUE_NO_HANDLE;
+        }
+    }
+
+    if (!push(q, val, id)) {
+        release(q, id);
+        return PQUEUE_NO_HANDLE;
+    }
+
+    return id;
+}
+
+void *pqueue_get(const pqueue * const q, size_t handle) {
+    size_t i = slot(q, handle);
+    return (i == NO_SLOT) ? NULL : at(q, i);
+}
+
+bool pqueue_decrease_key(pqueue * const q, size_t handle, void *val) {
+    size_t i = slot(q, handle);
+
+    if (i == NO_SLOT) {
+        return false;
+    }
+
+    memcpy(q->hole, val, q->heap->elem_size);
+    settle(q, i, handle);
+    return true;
+}
+
+bool pqueue_remove(pqueue * const q, size_t handle) {
+    size_t i = slot(q, handle);
+
+    if (i == NO_SLOT) {
+        return false;
+    }
+
+    remove_at(q, i);
+    return true;
+}
+
+static void add_stats(container_stats *out, const vector * const v) {
+    container_stats s;
+
+    vector_stats(v, &s);
+    out->allocs += s.allocs;
+    out->frees += s.frees;
+    out->reallocs += s.reallocs;
+    out->bytes_copied += s.bytes_copied;
+}
+
+void pqueue_stats(const pqueue * const q, container_stats *out) {
+    vector_stats(q->heap, out);
+
+    if (q->ids != NULL) {
+        add_stats(out, q->ids);
+        add_stats(out, q->slots);
+        add_stats(out, q->free_ids);
+    }
+}
+
+void pqueue_stats_reset(pqueue * const q) {
+    vector_stats_reset(q->heap);
+
+    if (q->ids != NULL) {
+        vector_stats_reset(q->ids);
+        vector_stats_reset(q->slots);
+        vector_stats_reset(q->free_ids);
+    }
+}
+
@@ -0,0 +1,63 @@
+#ifndef PQUEUE_H
+#define PQUEUE_H
+
+#include <stddef.h>     // size_t
+#include <stdbool.h>    // bool
+#include <stdint.h>     // SIZE_MAX
+
+#include "stats.h"
+
+/*
+ * Priority queue kept as an implicit d-ary heap in one vector, with the
+ * least elem by |comp| on top; pass a reversed comparator for the greatest.
+ * |arity| is the number of children per node, rounded down to a power of
+ * two from 2 to 64. A 4-ary heap is shallower than a binary one and reads
+ * each node's children from one or two cache lines, so it is usually the
+ * faster of the two unless the elems are large.
+ *
+ * Elems pushed with pqueue_push_handle() get a handle that stays valid while
+ * the elem is in the queue, through which it can be changed or removed in
+ * O(log n). Handles of popped or removed elems are reused. Queues that never
+ * hand one out do not track them and pay nothing for it.
+ */
+
+typedef struct priority_queue_t pqueue;
+
+#define PQUEUE_NO_HANDLE SIZE_MAX
+
+pqueue *pqueue_init(size_t elem_size, size_t arity, int (*comp)(void *a, void *b));
+
+// builds the heap from |n| elems of |data| in O(n)
+pqueue *pqueue_heapify(size_t elem_size, size_t arity, int (*comp)(void *a, void *b),
+        void *data, size_t n);
+
+void pqueue_del(pqueue **q);
+
+size_t pqueue_size(const pqueue * const q);
+
+void *pqueue_top(const pqueue * const q);
+
+void pqueue_push(pqueue * const q, void *val);
+void pqueue_pop(pqueue * const q);
+
+// pushes |n| elems, rebuilding the heap in O(n) instead when |n| is at least the size
+void pqueue_push_n(pqueue * const q, void *vals, size_t n);
+
+// returns PQUEUE_NO_HANDLE if out of memory
+size_t pqueue_push_handle(pqueue * const q, void *val);
+
+// the elem with |handle|, or NULL if it is no longer in |q|
+void *pqueue_get(const pqueue * const q, size_t handle);
+
+/*
+ * Replaces the elem with |handle| by |val| and restores the heap order;
+ * |val| may also be greater. Both return false if the elem is no longer in |q|.
+ */
+bool pqueue_decrease_key(pqueue * const q, size_t handle, void *val);
+bool pqueue_remove(pqueue * const q, size_t handle);
+
+// the counts are those of the heap and handle vectors together
+void pqueue_stats(const pqueue * const q, container_stats *out);
+void pqueue_stats_reset(pqueue * const q);
+
+#endif
@@ -1,30 +1,149 @@
 #include "queue.h"
 
+#include <stdlib.h>     // malloc(), free()
+#include <string.h>     // memcpy()
+
+#define INIT_CAP 16     // must be a power of 2
+
+/*
+ * Ring buffer; the capacity is kept a power of 2 so positions wrap with a
+ * mask. |head| is the position of the oldest elem, which is at the back
+ * and popped next; pushes go on the front.
+ */
+struct queue_t {
+    size_t size, cap;
+    size_t elem_size;
+    size_t head;
+    void *data;
+    STATS_FIELD
+};
+
+static void *pos_addr(const queue * const q, size_t pos) {
+    return (unsigned char *)q->data + (pos & (q->cap - 1)) * q->elem_size;
+}
+
+/*
+ * Returns the old buffer if it had to grow, for the caller to free once it
+ * has copied in the elems being pushed, which may be among the old ones.
+ */
+static void *queue_reserve(queue * const q, size_t new_size) {
+    void *old = NULL;
+
+    if (new_size > q->cap) {
+        size_t new_cap = q->cap;
+        void *tmp;
+
+        while (new_cap < new_size) {
+            new_cap *= 2;
+        }
+
+        tmp = malloc(new_cap * q->elem_size);
+        if (tmp) {
+            // unwrap the elems to the start of the new buffer
+            size_t n = q->size;
+            queue_pop_n(q, tmp, n);
+            old = q->data;
+            STATS_ADD(q, allocs, 1);
+            STATS_ADD(q, frees, 1);
+            q->data = tmp;
+            q->cap = new_cap;
+            q->head = 0;
+            q->size = n;
+        }
+    }
+
+    return old;
+}
+
 queue *queue_init(size_t elem_size) {
-    return list_init(elem_size);
+    struct queue_t *q = malloc(sizeof(*q));
+    q->size = 0;
+    q->cap = INIT_CAP;
+    q->elem_size = elem_size;
+    q->head = 0;
+    q->data = malloc(q->cap * elem_size);
+
+    STATS_INIT(q);
+    STATS_ADD(q, allocs, 1);
+    return q;
 }
 
 void queue_del(queue **q) {
-    list_del(q);
+    if (*q != NULL) {
+        free((*q)->data);
+        STATS_DEL(*q);
+        free(*q);
+        *q = NULL;
+    }
 }
 
 size_t queue_size(const queue * const q) {
-    return list_size(q);
+    return q->size;
 }
 
 void *queue_front(const queue * const q) {
-    return list_front(q);
+    return (q->size == 0) ? NULL : pos_addr(q, q->head + q->size - 1);
 }
 
 void *queue_back(const queue * const q) {
-    return list_back(q);
+    return (q->size == 0) ? NULL : pos_addr(q, q->head);
 }
 
 void queue_push(queue * const q, void *val) {
-    list_push_front(q, val);
+    queue_push_n(q, val, 1);
 }
 
 void queue_pop(queue * const q) {
-    list_pop_back(q);
+    queue_pop_n(q, NULL, 1);
+}
+
+// pushes |vals[0]| through |vals[n - 1]| in order, leaving |vals[n - 1]| at the front
+void queue_push_n(queue * const q, void *vals, size_t n) {
+    unsigned char *data;
+    size_t tail, first;
+    void *old = queue_reserve(q, q->size + n);
+
+    if (q->size + n > q->cap) {     // out of memory
+        return;
+    }
+
+    // at most two copies: up to the end of the buffer, then from its start
+    tail = (q->head + q->size) & (q->cap - 1);
+    first = (n < q->cap - tail) ? n : q->cap - tail;
+    data = q->data;
+    memcpy(data + tail * q->elem_size, vals, first * q->elem_size);
+    memcpy(data, (unsigned char *)vals + first * q->elem_size, (n - first) * q->elem_size);
+    STATS_ADD(q, bytes_copied, n * q->elem_size);
+    q->size += n;
+    free(old);
+}
+
+/*
+ * Pops up to |n| elems from the back, copying them to |out| oldest first
+ * unless |out| is NULL. Returns the number of elems popped.
+ */
+size_t queue_pop_n(queue * const q, void *out, size_t n) {
+    if (n > q->size) {
+        n = q->size;
+    }
+
+    if (out != NULL) {
+        size_t first = (n < q->cap - q->head) ? n : q->cap - q->head;
+        memcpy(out, pos_addr(q, q->head), first * q->elem_size);
+        memcpy((unsigned char *)out + first * q->elem_size, q->data, (n - first) * q->elem_size);
+        STATS_ADD(q, bytes_copied, n * q->elem_size);
+    }
+
+    q->head = (q->head + n) & (q->cap - 1);
+    q->size -= n;
+    return n;
+}
+
+void queue_stats(const queue * const q, container_stats *out) {
+    STATS_GET(q, out);
+}
+
+void queue_stats_reset(queue * const q) {
+    STATS_RESET(q);
 }
 
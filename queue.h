@@ -3,19 +3,26 @@
 
 #include <stddef.h>     // size_t
 
-#include "list.h"
+#include "stats.h"
 
-typedef list queue;
+typedef struct queue_t queue;
 
 queue *queue_init(size_t elem_size);
 void queue_del(queue **q);
 
 size_t queue_size(const queue * const q);
 
+// elems are pushed on the front and popped off the back
 void *queue_front(const queue * const q);
 void *queue_back(const queue * const q);
 
 void queue_push(queue * const q, void *val);
 void queue_pop(queue * const q);
 
+void queue_push_n(queue * const q, void *vals, size_t n);
+size_t queue_pop_n(queue * const q, void *out, size_t n);
+
+void queue_stats(const queue * const q, container_stats *out);
+void queue_stats_reset(queue * const q);
+
 #endif
@@ -0,0 +1,439 @@
+#include "snapshot.h"
+
+#include <stdint.h>     // uint*_t
+#include <stdio.h>      // FILE, fopen(), fwrite(), rename(), remove()
+#include <stdlib.h>     // malloc(), calloc(), free()
+#include <string.h>     // memcpy(), memcmp(), strlen()
+#include <fcntl.h>      // open()
+#include <unistd.h>     // close(), fsync()
+#include <sys/mman.h>   // mmap(), munmap()
+#include <sys/stat.h>   // fstat()
+
+#include "elems.h"
+
+#define MAGIC "CNTSNAP"     // with its terminator, fills |magic|
+#define VERSION 2     // 1 left the header out of the checksum
+#define BYTE_ORDER_MARK 0x01020304u
+
+// sections start on cache line boundaries, so no key straddles more than it must
+#define SECTION_ALIGN 64
+
+// writers gather entries into blocks this big before writing and summing them
+#define WRITE_BLOCK 65536
+
+enum kind_t { KIND_VECTOR = 1, KIND_OSET, KIND_OMAP };
+
+struct header_t {
+    char magic[8];
+    uint32_t version;
+    uint32_t byte_order;    // BYTE_ORDER_MARK as the writer stored it
+    uint64_t kind;
+    uint64_t count, key_size, val_size;
+    uint64_t keys_offset, vals_offset;  // from the start of the file
+    uint64_t file_size;
+    uint64_t checksum;      // over the header, with this field 0, and every byte after it
+};
+
+struct snapshot_t {
+    void *map;
+    size_t map_size;
+    const unsigned char *keys, *vals;
+    size_t count, key_size, val_size;
+    int (*comp)(void *a, void *b);
+};
+
+/*
+ * The checksum mixes 8-byte words into four independent lanes with
+ * multiply and rotate steps, in the manner of xxHash64, so it runs at
+ * close to memory speed. Data is fed in 32-byte blocks, and the writer
+ * buffers partial blocks so that streaming and one-shot sums agree.
+ */
+
+#define PRIME1 0x9E3779B185EBCA87ull
+#define PRIME2 0xC2B2AE3D27D4EB4Full
+
+struct checksum_t {
+    uint64_t lanes[4];
+    unsigned char buf[32];
+    size_t buffered;
+    uint64_t total;
+};
+
+static inline uint64_t rotl(uint64_t x, int r) {
+    return (x << r) | (x >> (64 - r));
+}
+
+static void checksum_init(struct checksum_t * const c) {
+    c->lanes[0] = PRIME1 + PRIME2;
+    c->lanes[1] = PRIME2;
+    c->lanes[2] = 0;
+    c->lanes[3] = -PRIME1;
+    c->buffered = 0;
+    c->total = 0;
+}
+
+static void checksum_block(struct checksum_t * const c, const unsigned char *p) {
+    int i;
+
+    for (i = 0; i < 4; i++) {
+        uint64_t w;
+        memcpy(&w, p + 8 * i, 8);
+        c->lanes[i] = rotl(c->lanes[i] + w * PRIME2, 31) * PRIME1;
+    }
+}
+
+static void checksum_feed(struct checksum_t * const c, const void *data, size_t n) {
+    const unsigned char *p = data;
+
+    c->total += n;
+
+    if (c->buffered > 0) {
+        size_t len = (n < 32 - c->buffered) ? n : 32 - c->buffered;
+        memcpy(c->buf + c->buffered, p, len);
+        c->buffered += len;
+        p += len;
+        n -= len;
+
+        if (c->buffered < 32) {
+            return;
+        }
+        checksum_block(c, c->buf);
+        c->buffered = 0;
+    }
+
+    for (; n >= 32; p += 32, n -= 32) {
+        checksum_block(c, p);
+    }
+
+    memcpy(c->buf, p, n);
+    c->buffered = n;
+}
+
+static uint64_t checksum_final(const struct checksum_t * const c) {
+    uint64_t h = rotl(c->lanes[0], 1) + rotl(c->lanes[1], 7)
+               + rotl(c->lanes[2], 12) + rotl(c->lanes[3], 18);
+    size_t i;
+
+    h ^= c->total;
+    for (i = 0; i < c->buffered; i++) {
+        h = rotl(h ^ (c->buf[i] * PRIME1), 11) * PRIME2;
+    }
+
+    h ^= h >> 33;
+    h *= PRIME2;
+    h ^= h >> 29;
+    return h;
+}
+
+static size_t align_up(size_t n) {
+    return (n + SECTION_ALIGN - 1) / SECTION_ALIGN * SECTION_ALIGN;
+}
+
+/*
+ * A writer streams sections into |path|.tmp, summing as it goes, and on
+ * success fills in the header, syncs and renames the file into place.
+ */
+
+struct writer_t {
+    FILE *f;
+    char *tmp_path;
+    struct header_t h;
+    struct checksum_t sum;
+    uint64_t offset;
+    bool failed;
+
+    unsigned char block[WRITE_BLOCK];
+    size_t buffered;
+};
+
+static void writer_flush(struct writer_t * const w) {
+    if (!w->failed && w->buffered > 0) {
+        w->failed = fwrite(w->block, w->buffered, 1, w->f) != 1;
+        checksum_feed(&w->sum, w->block, w->buffered);
+    }
+
+    w->buffered = 0;
+}
+
+static struct writer_t *writer_open(const char *path, enum kind_t kind,
+        size_t count, size_t key_size, size_t val_size) {
+    size_t len = strlen(path);
+    struct writer_t *w = calloc(1, sizeof(*w));
+
+    if (w == NULL || (w->tmp_path = malloc(len + sizeof(".tmp"))) == NULL) {
+        free(w);
+        return NULL;
+    }
+    memcpy(w->tmp_path, path, len);
+    memcpy(w->tmp_path + len, ".tmp", sizeof(".tmp"));
+
+    w->f = fopen(w->tmp_path, "wb");
+    if (w->f == NULL) {
+        free(w->tmp_path);
+        free(w);
+        return NULL;
+    }
+
+    memcpy(w->h.magic, MAGIC, sizeof(w->h.magic));
+    w->h.version = VERSION;
+    w->h.byte_order = BYTE_ORDER_MARK;
+    w->h.kind = kind;
+    w->h.count = count;
+    w->h.key_size = key_size;
+    w->h.val_size = val_size;
+    w->h.keys_offset = align_up(sizeof(w->h));
+    w->h.vals_offset = w->h.keys_offset + count * key_size;
+    if (val_size > 0) {
+        w->h.vals_offset = align_up(w->h.vals_offset);
+    }
+    w->h.file_size = w->h.vals_offset + count * val_size;
+
+    checksum_init(&w->sum);
+    checksum_feed(&w->sum, &w->h, sizeof(w->h));
+
+    // the header is rewritten once the checksum is known
+    w->failed = fwrite(&w->h, sizeof(w->h), 1, w->f) != 1;
+    w->offset = sizeof(w->h);
+    return w;
+}
+
+static void writer_put(struct writer_t * const w, const void *data, size_t n) {
+    w->offset += n;
+
+    if (w->buffered + n <= WRITE_BLOCK) {
+        memcpy(w->block + w->buffered, data, n);
+        w->buffered += n;
+        return;
+    }
+
+    // big writes, like a whole vector, skip the block
+    writer_flush(w);
+    if (!w->failed) {
+        w->failed = fwrite(data, n, 1, w->f) != 1;
+        checksum_feed(&w->sum, data, n);
+    }
+}
+
+// zero-fills up to |offset|, where the next section begins
+static void writer_pad(struct writer_t * const w, uint64_t offset) {
+    static const unsigned char zeros[SECTION_ALIGN];
+
+    while (w->offset < offset) {
+        size_t len = (offset - w->offset < sizeof(zeros)) ? offset - w->offset : sizeof(zeros);
+        writer_put(w, zeros, len);
+    }
+}
+
+// frees |w| and reports whether the whole file made it into place
+static bool writer_close(struct writer_t * const w, const char *path) {
+    bool ok;
+
+    writer_flush(w);
+    w->failed |= w->offset != w->h.file_size;
+    w->h.checksum = checksum_final(&w->sum);
+
+    if (!w->failed) {
+        w->failed = fseek(w->f, 0, SEEK_SET) != 0
+                || fwrite(&w->h, sizeof(w->h), 1, w->f) != 1
+                || fflush(w->f) != 0
+                || fsync(fileno(w->f)) != 0;
+    }
+
+    w->failed |= fclose(w->f) != 0;
+    if (!w->failed) {
+        w->failed = rename(w->tmp_path, path) != 0;
+    }
+    if (w->failed) {
+        remove(w->tmp_path);
+    }
+
+    ok = !w->failed;
+    free(w->tmp_path);
+    free(w);
+    return ok;
+}
+
+bool vector_save(const vector * const v, const char *path) {
+    struct writer_t *w = writer_open(path, KIND_VECTOR, v->size, v->elem_size, 0);
+
+    if (w == NULL) {
+        return false;
+    }
+
+    writer_pad(w, w->h.keys_offset);
+    writer_put(w, v->data, v->size * v->elem_size);
+    return writer_close(w, path);
+}
+
+bool oset_save(const oset * const s, const char *path) {
+    size_t elem_size = oset_elem_size(s);
+    struct writer_t *w = writer_open(path, KIND_OSET, oset_size(s), elem_size, 0);
+    oset_iter it;
+
+    if (w == NULL) {
+        return false;
+    }
+
+    writer_pad(w, w->h.keys_offset);
+    for (it = oset_iter_begin(s); it.node != NULL; oset_iter_next(&it)) {
+        writer_put(w, oset_iter_get(&it), elem_size);
+    }
+
+    return writer_close(w, path);
+}
+
+bool omap_save(const omap * const m, const char *path) {
+    size_t key_size = omap_key_size(m), val_size = omap_val_size(m);
+    struct writer_t *w = writer_open(path, KIND_OMAP, omap_size(m), key_size, val_size);
+    omap_iter it;
+
+    if (w == NULL) {
+        return false;
+    }
+
+    // one walk per section keeps each section a single sequential write
+    writer_pad(w, w->h.keys_offset);
+    for (it = omap_iter_begin(m); it.node != NULL; omap_iter_next(&it)) {
+        writer_put(w, omap_iter_key(&it), key_size);
+    }
+
+    writer_pad(w, w->h.vals_offset);
+    for (it = omap_iter_begin(m); it.node != NULL; omap_iter_next(&it)) {
+        writer_put(w, omap_iter_val(&it), val_size);
+    }
+
+    return writer_close(w, path);
+}
+
+/*
+ * Whether |h| describes a file of |size| bytes whose sections fit inside
+ * it. The checksum would catch a corrupt header too, but only after it
+ * had been trusted to size the sum, so the bounds come first.
+ */
+static bool header_valid(const struct header_t * const h, size_t size, enum kind_t kind) {
+    uint64_t keys_end, vals_end;
+
+    if (memcmp(h->magic, MAGIC, sizeof(h->magic)) != 0 || h->version != VERSION
+            || h->byte_order != BYTE_ORDER_MARK || h->kind != (uint64_t)kind
+            || h->file_size != size || h->key_size == 0
+            || (kind != KIND_OMAP && h->val_size != 0)) {
+        return false;
+    }
+
+    // keep the section arithmetic below from overflowing
+    if (h->count > size / h->key_size || (h->val_size > 0 && h->count > size / h->val_size)
+            || h->keys_offset > size || h->vals_offset > size) {
+        return false;
+    }
+
+    keys_end = h->keys_offset + h->count * h->key_size;
+    vals_end = h->vals_offset + h->count * h->val_size;
+    return h->keys_offset >= sizeof(*h) && keys_end <= size
+        && h->vals_offset >= keys_end && vals_end <= size;
+}
+
+static uint64_t file_checksum(const struct header_t * const h, size_t size) {
+    struct header_t zeroed = *h;
+    struct checksum_t sum;
+
+    zeroed.checksum = 0;
+    checksum_init(&sum);
+    checksum_feed(&sum, &zeroed, sizeof(zeroed));
+    checksum_feed(&sum, (const unsigned char *)h + sizeof(*h), size - sizeof(*h));
+    return checksum_final(&sum);
+}
+
+static snapshot *open_mmap(const char *path, enum kind_t kind, int (*comp)(void *a, void *b)) {
+    struct snapshot_t *s;
+    const struct header_t *h;
+    struct stat st;
+    void *map;
+    bool valid;
+    int fd = open(path, O_RDONLY);
+
+    if (fd < 0) {
+        return NULL;
+    }
+
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(*h)) {
+        close(fd);
+        return NULL;
+    }
+
+    // the mapping outlives the descriptor
+    map = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        return NULL;
+    }
+
+    // summing reads the whole file once, which also faults it in
+    h = map;
+    valid = header_valid(h, st.st_size, kind) && file_checksum(h, st.st_size) == h->checksum;
+
+    if (!valid || (s = malloc(sizeof(*s))) == NULL) {
+        munmap(map, st.st_size);
+        return NULL;
+    }
+
+    s->map = map;
+    s->map_size = st.st_size;
+    s->keys = (unsigned char *)map + h->keys_offset;
+    s->vals = (unsigned char *)map + h->vals_offset;
+    s->count = h->count;
+    s->key_size = h->key_size;
+    s->val_size = h->val_size;
+    s->comp = comp;
+    return s;
+}
+
+snapshot *vector_open_mmap(const char *path) {
+    return open_mmap(path, KIND_VECTOR, NULL);
+}
+
+snapshot *oset_open_mmap(const char *path, int (*comp)(void *a, void *b)) {
+    return open_mmap(path, KIND_OSET, comp);
+}
+
+snapshot *omap_open_mmap(const char *path, int (*comp)(void *a, void *b)) {
+    return open_mmap(path, KIND_OMAP, comp);
+}
+
+void snapshot_close(snapshot **s) {
+    if (*s != NULL) {
+        munmap((*s)->map, (*s)->map_size);
+        free(*s);
+        *s = NULL;
+    }
+}
+
+size_t snapshot_size(const snapshot * const s) {
+    return s->count;
+}
+
+void *snapshot_key(const snapshot * const s, size_t i) {
+    return (i < s->count) ? (void *)(s->keys + i * s->key_size) : NULL;
+}
+
+void *snapshot_val(const snapshot * const s, size_t i) {
+    return (i < s->count && s->val_size > 0) ? (void *)(s->vals + i * s->val_size) : NULL;
+}
+
+// vector snapshots have no comparator, so every key search comes up empty
+size_t snapshot_seek(const snapshot * const s, void *key) {
+    return (s->comp == NULL) ? s->count : elems_lower_bound(s->keys, s->count, s->key_size, key, s->comp);
+}
+
+static bool found(const snapshot * const s, size_t i, void *key) {
+    return i < s->count && (*s->comp)(snapshot_key(s, i), key) == 0;
+}
+
+bool snapshot_contains(const snapshot * const s, void *key) {
+    return found(s, snapshot_seek(s, key), key);
+}
+
+void *snapshot_get(const snapshot * const s, void *key) {
+    size_t i = snapshot_seek(s, key);
+    return found(s, i, key) ? snapshot_val(s, i) : NULL;
+}
+
@@ -0,0 +1,53 @@
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include <stddef.h>     // size_t
+#include <stdbool.h>    // bool
+
+#include "vector.h"
+#include "oset.h"
+#include "omap.h"
+
+/*
+ * Binary snapshots of a vector, oset or omap. A snapshot file holds a
+ * versioned header, then every elem or key packed in order, then for maps
+ * every value in the same order, each section 64-byte aligned, and a
+ * checksum over all of it. Saving writes to |path|.tmp and renames it over
+ * |path|, so readers never see a partly written file.
+ *
+ * Opening maps the file read-only and checks it; after that lookups run
+ * against the mapped pages with no copying or allocation, and processes
+ * that open the same file share it through the page cache. The pointers a
+ * snapshot hands out point into the mapping and must not be written to.
+ * Files are only readable on a machine with the writer's byte order.
+ *
+ * The comparator is not saved, so ordered snapshots must be opened with
+ * the one they were saved with. Vector snapshots keep index order and have
+ * no comparator, so on them snapshot_seek() returns the size and
+ * snapshot_contains() and snapshot_get() find nothing.
+ */
+
+typedef struct snapshot_t snapshot;
+
+bool vector_save(const vector * const v, const char *path);
+bool oset_save(const oset * const s, const char *path);
+bool omap_save(const omap * const m, const char *path);
+
+// each returns NULL if |path| is not a valid snapshot of that container
+snapshot *vector_open_mmap(const char *path);
+snapshot *oset_open_mmap(const char *path, int (*comp)(void *a, void *b));
+snapshot *omap_open_mmap(const char *path, int (*comp)(void *a, void *b));
+void snapshot_close(snapshot **s);
+
+size_t snapshot_size(const snapshot * const s);
+
+// the elem or key, and the value, with |i| before it; NULL past the end
+void *snapshot_key(const snapshot * const s, size_t i);
+void *snapshot_val(const snapshot * const s, size_t i);
+
+// index of the first key not before |key|, so also the number before it
+size_t snapshot_seek(const snapshot * const s, void *key);
+bool snapshot_contains(const snapshot * const s, void *key);
+void *snapshot_get(const snapshot * const s, void *key);
+
+#endif
@@ -0,0 +1,116 @@
+#include "spsc_queue.h"
+
+#include <stdlib.h>     // malloc(), aligned_alloc(), free()
+#include <string.h>     // memcpy()
+#include <stdatomic.h>  // atomic_size_t, atomic_load_explicit(), atomic_store_explicit()
+
+#define CACHE_LINE 64
+
+/*
+ * |head| and |tail| count every elem ever popped and pushed; a slot is the
+ * count masked by |cap| - 1. Each side keeps the other's index cached on
+ * its own cache line and only reloads it when the cached value says the
+ * queue is empty or full.
+ */
+struct spsc_queue_t {
+    _Alignas(CACHE_LINE) atomic_size_t head;    // written by the consumer
+    size_t cached_tail;
+
+    _Alignas(CACHE_LINE) atomic_size_t tail;    // written by the producer
+    size_t cached_head;
+
+    _Alignas(CACHE_LINE) size_t cap;
+    size_t elem_size;
+    void *data;
+};
+
+spsc_queue *spsc_queue_init(size_t elem_size, size_t cap) {
+    struct spsc_queue_t *q = aligned_alloc(CACHE_LINE, sizeof(*q));
+
+    // a power of 2 lets indices wrap with a mask
+    q->cap = 1;
+    while (q->cap < cap) {
+        q->cap *= 2;
+    }
+
+    q->elem_size = elem_size;
+    q->data = malloc(q->cap * elem_size);
+    atomic_init(&q->head, 0);
+    atomic_init(&q->tail, 0);
+    q->cached_head = q->cached_tail = 0;
+    return q;
+}
+
+void spsc_queue_del(spsc_queue **q) {
+    if (*q != NULL) {
+        free((*q)->data);
+        free(*q);
+        *q = NULL;
+    }
+}
+
+// exact only when neither thread is mid-call
+size_t spsc_queue_size(const spsc_queue * const q) {
+    size_t head = atomic_load_explicit(&((struct spsc_queue_t *)q)->head, memory_order_acquire);
+    size_t tail = atomic_load_explicit(&((struct spsc_queue_t *)q)->tail, memory_order_acquire);
+    return tail - head;
+}
+
+size_t spsc_queue_capacity(const spsc_queue * const q) {
+    return q->cap;
+}
+
+bool spsc_queue_push(spsc_queue * const q, void *val) {
+    return spsc_queue_push_n(q, val, 1) == 1;
+}
+
+bool spsc_queue_pop(spsc_queue * const q, void *out) {
+    return spsc_queue_pop_n(q, out, 1) == 1;
+}
+
+// pushes as many of |vals[0]| through |vals[n - 1]| as fit; returns how many
+size_t spsc_queue_push_n(spsc_queue * const q, void *vals, size_t n) {
+    size_t tail = atomic_load_explicit(&q->tail, memory_order_relaxed);
+    size_t free_slots = q->cap - (tail - q->cached_head);
+    size_t slot, first;
+
+    if (free_slots < n) {
+        q->cached_head = atomic_load_explicit(&q->head, memory_order_acquire);
+        free_slots = q->cap - (tail - q->cached_head);
+        if (free_slots < n) {
+            n = free_slots;
+        }
+    }
+
+    slot = tail & (q->cap - 1);
+    first = (n < q->cap - slot) ? n : q->cap - slot;
+    memcpy(q->data + slot * q->elem_size, vals, first * q->elem_size);
+    memcpy(q->data, vals + first * q->elem_size, (n - first) * q->elem_size);
+
+    atomic_store_explicit(&q->tail, tail + n, memory_order_release);
+    return n;
+}
+
+// pops up to |n| elems into |out|, oldest first; returns how many
+size_t spsc_queue_pop_n(spsc_queue * const q, void *out, size_t n) {
+    size_t head = atomic_load_explicit(&q->head, memory_order_relaxed);
+    size_t avail = q->cached_tail - head;
+    size_t slot, first;
+
+    if (avail < n) {
+        q->cached_tail = atomic_load_explicit(&q->tail, memory_order_acquire);
+        avail = q->cached_tail - head;
+        if (avail < n) {
+            n = avail;
+        }
+    }
+
+    slot = head & (q->cap - 1);
+    first = (n < q->cap - slot) ? n : q->cap - slot;
+    memcpy(out, q->data + slot * q->elem_size, first * q->elem_size);
+    memcpy(out + first * q->elem_size, q->data, (n - first) * q->elem_size);
+
+    atomic_store_explicit(&q->head, head + n, memory_order_release);
+    return n;
+}
+
@@ -0,0 +1,27 @@
+#ifndef SPSC_QUEUE_H
+#define SPSC_QUEUE_H
+
+#include <stddef.h>     // size_t
+#include <stdbool.h>    // bool
+
+/*
+ * Bounded wait-free queue for exactly one producer thread and one consumer
+ * thread. Push calls may only be made by the producer and pop calls by the
+ * consumer; neither ever blocks.
+ */
+
+typedef struct spsc_queue_t spsc_queue;
+
+spsc_queue *spsc_queue_init(size_t elem_size, size_t cap);
+void spsc_queue_del(spsc_queue **q);
+
+size_t spsc_queue_size(const spsc_queue * const q);
+size_t spsc_queue_capacity(const spsc_queue * const q);
+
+bool spsc_queue_push(spsc_queue * const q, void *val);
+bool spsc_queue_pop(spsc_queue * const q, void *out);
+
+size_t spsc_queue_push_n(spsc_queue * const q, void *vals, size_t n);
+size_t spsc_queue_pop_n(spsc_queue * const q, void *out, size_t n);
+
+#endif
@@ -1,26 +1,117 @@
 #include "stack.h"
 
+#include <stdlib.h>     // malloc(), realloc(), free()
+#include <string.h>     // memcpy()
+#include <stdint.h>     // uintptr_t
+#include <stdbool.h>    // bool
+
+#define INIT_CAP 16
+
+struct stack_t {
+    size_t size, cap;
+    size_t elem_size;
+    void *data;     // bottom elem first
+    STATS_FIELD
+};
+
+static void stack_reserve(stack * const s, size_t new_size) {
+    if (new_size > s->cap) {
+        size_t new_cap = s->cap;
+        void *tmp;
+
+        while (new_cap < new_size) {
+            new_cap *= 2;
+        }
+
+        tmp = realloc(s->data, new_cap * s->elem_size);
+        STATS_ADD(s, reallocs, 1);
+        if (tmp) {
+            s->data = tmp;
+            s->cap = new_cap;
+        }
+    }
+}
+
 stack *stack_init(size_t elem_size) {
-    return list_init(elem_size);
+    struct stack_t *s = malloc(sizeof(*s));
+    s->size = 0;
+    s->cap = INIT_CAP;
+    s->elem_size = elem_size;
+    s->data = malloc(s->cap * elem_size);
+
+    STATS_INIT(s);
+    STATS_ADD(s, allocs, 1);
+    return s;
 }
 
 void stack_del(stack **s) {
-    list_del(s);
+    if (*s != NULL) {
+        free((*s)->data);
+        STATS_DEL(*s);
+        free(*s);
+        *s = NULL;
+    }
 }
 
 size_t stack_size(const stack * const s) {
-    return list_size(s);
+    return s->size;
 }
 
 void *stack_top(const stack * const s) {
-    return list_back(s);
+    return (s->size == 0) ? NULL : (unsigned char *)s->data + (s->size - 1) * s->elem_size;
 }
 
 void stack_push(stack * const s, void *val) {
-    list_push_back(s, val);
+    stack_push_n(s, val, 1);
 }
 
 void stack_pop(stack * const s) {
-    list_pop_back(s);
+    stack_pop_n(s, NULL, 1);
+}
+
+// pushes |vals[0]| through |vals[n - 1]| in order, leaving |vals[n - 1]| on top
+void stack_push_n(stack * const s, void *vals, size_t n) {
+    unsigned char *src = vals;
+    size_t offset = (uintptr_t)vals - (uintptr_t)s->data;
+    bool own = offset < s->size * s->elem_size;
+
+    stack_reserve(s, s->size + n);
+
+    // realloc() may have moved our own elems, but not within the buffer
+    if (own) {
+        src = (unsigned char *)s->data + offset;
+    }
+
+    if (s->size + n <= s->cap) {    // reserving may fail to allocate
+        memcpy((unsigned char *)s->data + s->size * s->elem_size, src, n * s->elem_size);
+        STATS_ADD(s, bytes_copied, n * s->elem_size);
+        s->size += n;
+    }
+}
+
+/*
+ * Pops up to |n| elems, copying them to |out| in the order they were pushed
+ * unless |out| is NULL. Returns the number of elems popped.
+ */
+size_t stack_pop_n(stack * const s, void *out, size_t n) {
+    if (n > s->size) {
+        n = s->size;
+    }
+
+    s->size -= n;
+    if (out != NULL) {
+        memcpy(out, (unsigned char *)s->data + s->size * s->elem_size, n * s->elem_size);
+        STATS_ADD(s, bytes_copied, n * s->elem_size);
+    }
+
+    return n;
+}
+
+void stack_stats(const stack * const s, container_stats *out) {
+    STATS_GET(s, out);
+}
+
+void stack_stats_reset(stack * const s) {
+    STATS_RESET(s);
 }
 
@@ -3,9 +3,9 @@
 
 #include <stddef.h>     // size_t
 
-#include "list.h"
+#include "stats.h"
 
-typedef list stack;
+typedef struct stack_t stack;
 
 stack *stack_init(size_t elem_size);
 void stack_del(stack **s);
@@ -17,4 +17,10 @@ void *stack_top(const stack * const s);
 void stack_push(stack * const s, void *val);
 void stack_pop(stack * const s);
 
+void stack_push_n(stack * const s, void *vals, size_t n);
+size_t stack_pop_n(stack * const s, void *out, size_t n);
+
+void stack_stats(const stack * const s, container_stats *out);
+void stack_stats_reset(stack * const s);
+
 #endif
@@ -0,0 +1,61 @@
+#ifndef STATS_H
+#define STATS_H
+
+#include <stddef.h>     // size_t
+#include <stdlib.h>     // calloc(), free()
+#include <string.h>     // memset()
+
+/*
+ * Per-container operation counters, compiled in only when the library is
+ * built with CONTAINERS_STATS defined. Otherwise the STATS_* macros count
+ * nothing and every *_stats() call reports zeros.
+ *
+ * The counters live behind a pointer so that const container functions
+ * can still update them. The pointer is there in every build, and NULL
+ * without CONTAINERS_STATS, so the structs laid out in public headers are
+ * the same whichever way the library and its callers were compiled.
+ * Counting code inlined into callers uses STATS_ADD_INLINE(), which skips
+ * the NULL pointer of a library built without the counters; a caller
+ * built without them just leaves its inlined operations uncounted.
+ */
+
+typedef struct container_stats_t {
+    size_t comparisons;     // calls to the comparator, or to hash and equal
+    size_t allocs, frees;   // nodes, blocks and buffers, pooled or not
+    size_t reallocs;        // buffers resized in place of a fresh allocation
+    size_t bytes_copied;    // elems, keys and values copied in or moved
+    size_t node_visits;     // nodes or slots stepped through to reach an elem
+    size_t height, max_height;  // levels in a tree now and at its tallest
+} container_stats;
+
+#define STATS_FIELD struct container_stats_t *stats;
+
+#ifdef CONTAINERS_STATS
+
+#define STATS_INIT(c) ((c)->stats = calloc(1, sizeof(*(c)->stats)))
+#define STATS_DEL(c) free((c)->stats)
+#define STATS_GET(c, out) (*(out) = *(c)->stats)
+#define STATS_RESET(c) memset((c)->stats, 0, sizeof(*(c)->stats))
+
+#define STATS_ADD(c, field, n) ((c)->stats->field += (n))
+#define STATS_MAX(c, field, n) \
+    ((c)->stats->field = ((n) > (c)->stats->field) ? (n) : (c)->stats->field)
+
+#define STATS_ADD_INLINE(c, field, n) \
+    ((c)->stats != NULL ? (void)((c)->stats->field += (n)) : (void)0)
+
+#else
+
+#define STATS_INIT(c) ((c)->stats = NULL)
+#define STATS_DEL(c) ((void)(c))
+#define STATS_GET(c, out) ((void)(c), memset((out), 0, sizeof(*(out))))
+#define STATS_RESET(c) ((void)(c))
+
+#define STATS_ADD(c, field, n) ((void)(c))
+#define STATS_MAX(c, field, n) ((void)(c))
+
+#define STATS_ADD_INLINE(c, field, n) ((void)(c))
+
+#endif
+
+#endif
@@ -0,0 +1,150 @@
+#include <stdio.h>          // printf(), fprintf()
+#include <stdlib.h>         // srand(), rand()
+#include <stdbool.h>        // bool
+
+#include "omap.h"
+
+/*
+ * Runs random inserts and removes on B-tree omaps against a table of
+ * which keys are present. Nodes of the smallest size split, borrow and
+ * merge on nearly every call, so checking every lookup and a full walk in
+ * both directions now and then covers each way entries move between them.
+ */
+
+#define KEYS 3000
+#define STEPS 60000
+
+static bool present[KEYS];
+
+static int compare_int(void *a, void *b) {
+    int x = *(int *)a, y = *(int *)b;
+    return (x > y) - (x < y);
+}
+
+// walks |m| both ways and by rank, checking it holds just the present keys
+static size_t check_walk(const omap * const m) {
+    omap_iter it;
+    size_t rank = 0, wrong = 0;
+    int k, *key;
+
+    it = omap_iter_begin(m);
+    for (k = 0; k < KEYS; k++) {
+        if (!present[k]) {
+            continue;
+        }
+
+        key = omap_iter_key(&it);
+        wrong += key == NULL || *key != k || *(long *)omap_iter_val(&it) != 3L * k;
+        wrong += omap_rank(m, &k) != rank;
+
+        key = omap_select_key(m, rank++);
+        wrong += key == NULL || *key != k;
+        omap_iter_next(&it);
+    }
+    wrong += it.node != NULL || rank != omap_size(m) || omap_select_key(m, rank) != NULL;
+
+    it = omap_iter_end(m);
+    for (k = KEYS - 1; k >= 0; k--) {
+        if (present[k]) {
+            omap_iter_prev(&it);
+            key = omap_iter_key(&it);
+            wrong += key == NULL || *key != k;
+        }
+    }
+
+    return wrong;
+}
+
+static size_t check_neighbours(omap * const m, int k) {
+    int lo = k - 1, hi = k + 1, *got_lo, *got_hi;
+
+    while (lo >= 0 && !present[lo]) {
+        lo--;
+    }
+    while (hi < KEYS && !present[hi]) {
+        hi++;
+    }
+
+    got_lo = omap_lower_key(m, &k);
+    got_hi = omap_higher_key(m, &k);
+    return (got_lo == NULL) != (lo < 0) || (got_lo != NULL && *got_lo != lo)
+        || (got_hi == NULL) != (hi >= KEYS) || (got_hi != NULL && *got_hi != hi);
+}
+
+static size_t run(size_t node_bytes) {
+    omap *m = omap_init_btree(sizeof(int), sizeof(long), compare_int, node_bytes);
+    omap *copy;
+    omap_iter it;
+    size_t i, size = 0, wrong = 0;
+    long val, *got;
+    int k;
+
+    for (k = 0; k < KEYS; k++) {
+        present[k] = false;
+    }
+
+    for (i = 0; i < STEPS; i++) {
+        k = rand() % KEYS;
+        val = 3L * k;
+
+        // mostly inserts for the first half, then mostly removes
+        if ((rand() % 4 != 0) == (i < STEPS / 2)) {
+            wrong += omap_insert(m, &k, &val) == present[k];
+            size += !present[k];
+            present[k] = true;
+        } else {
+            wrong += omap_remove(m, &k) != present[k];
+            size -= present[k];
+            present[k] = false;
+        }
+
+        k = rand() % KEYS;
+        got = omap_get(m, &k);
+        wrong += omap_size(m) != size || (got != NULL) != present[k] || (got != NULL && *got != 3L * k);
+        wrong += check_neighbours(m, k);
+
+        if (i % 2000 == 0) {
+            wrong += check_walk(m);
+        }
+    }
+
+    // a clone is a separate tree with the same entries
+    copy = omap_clone(m);
+    k = KEYS / 2;
+    omap_remove(m, &k);
+    wrong += check_walk(copy);
+    omap_del(&copy);
+    present[k] = false;
+
+    // erasing through an iterator leaves it on the next entry
+    for (it = omap_iter_begin(m); it.node != NULL; ) {
+        k = *(int *)omap_iter_key(&it);
+        if (k % 3 == 0) {
+            omap_iter_erase(m, &it);
+            present[k] = false;
+        } else {
+            omap_iter_next(&it);
+        }
+    }
+    wrong += check_walk(m);
+
+    omap_del(&m);
+    return wrong;
+}
+
+int main(void) {
+    size_t sizes[] = {0, 256, 4096}, i, wrong = 0;
+
+    srand(1);
+    for (i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+        size_t n = run(sizes[i]);
+
+        if (n > 0) {
+            fprintf(stderr, "%zu-byte nodes: %zu wrong results\n", sizes[i], n);
+        }
+        wrong += n;
+    }
+
+    printf("test_btree: %s\n", (wrong == 0) ? "ok" : "FAILED");
+    return wrong != 0;
+}
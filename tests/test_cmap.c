@@ -0,0 +1,131 @@
+#include <stdio.h>          // printf(), fprintf()
+#include <stdbool.h>        // bool
+#include <stdatomic.h>      // atomic_size_t, atomic_fetch_add()
+#include <pthread.h>        // pthread_create(), pthread_join()
+
+#include "cmap.h"
+
+/*
+ * Checks that each operation hashes its key just once, then has several
+ * threads insert, count up through cmap_compute() and remove over keys
+ * they share, and checks the totals.
+ */
+
+#define THREADS 4
+#define KEYS 5000
+#define ROUNDS 20
+
+static atomic_size_t hash_calls;
+
+static size_t hash_int(void *key) {
+    atomic_fetch_add(&hash_calls, 1);
+    return (size_t)*(int *)key * 0x9E3779B97F4A7C15ull;
+}
+
+static bool equal_int(void *a, void *b) {
+    return *(int *)a == *(int *)b;
+}
+
+static bool count_up(void *key, void *val, bool found, void *arg) {
+    (void)key;
+    (void)arg;
+    *(int *)val = found ? *(int *)val + 1 : 1;
+    return true;
+}
+
+static bool drop(void *key, void *val, bool found, void *arg) {
+    (void)key;
+    (void)val;
+    (void)found;
+    (void)arg;
+    return false;
+}
+
+// each call must hash its key exactly once
+static size_t check_hash_once(void) {
+    cmap *m = cmap_init(sizeof(int), sizeof(int), hash_int, equal_int);
+    size_t wrong = 0, before;
+    int k = 7, v = 1, out;
+
+#define ONCE(call) \
+    before = atomic_load(&hash_calls); \
+    call; \
+    wrong += atomic_load(&hash_calls) - before != 1;
+
+    ONCE(cmap_insert(m, &k, &v))
+    ONCE(cmap_get(m, &k, &out))
+    ONCE(cmap_contains(m, &k))
+    ONCE(cmap_get_or_insert(m, &k, &v, &out))
+    ONCE(cmap_compute(m, &k, count_up, NULL))
+    ONCE(cmap_compute(m, &k, drop, NULL))
+    ONCE(cmap_get_or_insert(m, &k, &v, &out))
+    ONCE(cmap_remove(m, &k))
+
+#undef ONCE
+
+    cmap_del(&m);
+    return wrong;
+}
+
+struct worker_t {
+    cmap *m;
+    pthread_t thread;
+};
+
+static void *work(void *arg) {
+    struct worker_t *w = arg;
+    int round, k, out, zero = 0;
+
+    for (round = 0; round < ROUNDS; round++) {
+        for (k = 0; k < KEYS; k++) {
+            cmap_get_or_insert(w->m, &k, &zero, &out);
+            cmap_compute(w->m, &k, count_up, NULL);
+        }
+    }
+
+    return NULL;
+}
+
+static size_t check_threads(void) {
+    cmap *m = cmap_init(sizeof(int), sizeof(int), hash_int, equal_int);
+    struct worker_t workers[THREADS];
+    size_t i, wrong = 0;
+    int k, out;
+
+    for (i = 0; i < THREADS; i++) {
+        workers[i].m = m;
+        pthread_create(&workers[i].thread, NULL, work, &workers[i]);
+    }
+    for (i = 0; i < THREADS; i++) {
+        pthread_join(workers[i].thread, NULL);
+    }
+
+    wrong += cmap_size(m) != KEYS;
+    for (k = 0; k < KEYS; k++) {
+        wrong += !cmap_get(m, &k, &out) || out != THREADS * ROUNDS;
+    }
+
+    for (k = 0; k < KEYS; k += 2) {
+        wrong += !cmap_remove(m, &k) || cmap_remove(m, &k);
+    }
+    for (k = 0; k < KEYS; k++) {
+        wrong += cmap_contains(m, &k) != (k % 2 == 1);
+    }
+
+    cmap_del(&m);
+    return wrong;
+}
+
+int main(void) {
+    size_t once = check_hash_once(), threads = check_threads();
+
+    if (once > 0) {
+        fprintf(stderr, "%zu calls hashed their key more than once\n", once);
+    }
+    if (threads > 0) {
+        fprintf(stderr, "%zu wrong results from concurrent updates\n", threads);
+    }
+
+    printf("test_cmap: %s\n", (once + threads == 0) ? "ok" : "FAILED");
+    return once + threads != 0;
+}
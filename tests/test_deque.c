@@ -0,0 +1,93 @@
+#include <stdio.h>          // printf(), fprintf()
+#include <stdlib.h>         // srand(), rand(), malloc(), free()
+#include <string.h>         // memset(), memcmp()
+
+#include "deque.h"
+
+/*
+ * Runs random pushes, pops and sets at both ends against a plain array
+ * for elems smaller and larger than a block, checking every index now
+ * and then, and that pushing never moves an elem already in the deque.
+ */
+
+#define STEPS 20000
+#define MODEL_CAP (2 * STEPS + 1)
+
+static size_t run(size_t elem_size) {
+    deque *d = deque_init(elem_size);
+    unsigned char *model = malloc(MODEL_CAP * elem_size), *val = malloc(elem_size);
+    size_t lo = STEPS, hi = STEPS, i, j, wrong = 0;     // the model holds [lo, hi)
+    void *front = NULL, *back = NULL;
+
+    for (i = 0; i < STEPS; i++) {
+        int op = rand() % 8;
+
+        memset(val, rand(), elem_size);
+        val[0] = (unsigned char)i;
+
+        if (op < 3) {
+            deque_push_back(d, val);
+            memcpy(model + hi++ * elem_size, val, elem_size);
+        } else if (op < 6) {
+            deque_push_front(d, val);
+            memcpy(model + --lo * elem_size, val, elem_size);
+        } else if (op == 6 && hi > lo) {
+            deque_pop_back(d);
+            hi--;
+        } else if (hi > lo) {
+            deque_pop_front(d);
+            lo++;
+        }
+
+        // the old ends are still where they were unless they were popped
+        if (op < 6 && front != NULL) {
+            wrong += (op < 3) ? deque_front(d) != front : deque_back(d) != back;
+        }
+
+        if (hi > lo && rand() % 16 == 0) {
+            j = lo + rand() % (hi - lo);
+            memset(val, rand(), elem_size);
+            deque_set(d, j - lo, val);
+            memcpy(model + j * elem_size, val, elem_size);
+        }
+
+        wrong += deque_size(d) != hi - lo;
+        front = deque_front(d);
+        back = deque_back(d);
+        wrong += (hi > lo) ? memcmp(front, model + lo * elem_size, elem_size) != 0
+                           || memcmp(back, model + (hi - 1) * elem_size, elem_size) != 0
+                           : front != NULL || back != NULL;
+
+        if (i % 1024 == 0) {
+            for (j = lo; j < hi; j++) {
+                wrong += memcmp(deque_get(d, j - lo), model + j * elem_size, elem_size) != 0;
+            }
+            wrong += deque_get(d, hi - lo) != NULL;
+        }
+    }
+
+    deque_del(&d);
+    wrong += d != NULL;
+    free(model);
+    free(val);
+    return wrong;
+}
+
+int main(void) {
+    size_t sizes[] = {1, 4, 24, 700}, i, wrong = 0;
+
+    srand(1);
+    wrong += deque_init(0) != NULL;
+
+    for (i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+        size_t n = run(sizes[i]);
+
+        if (n > 0) {
+            fprintf(stderr, "elem size %zu: %zu wrong results\n", sizes[i], n);
+        }
+        wrong += n;
+    }
+
+    printf("test_deque: %s\n", (wrong == 0) ? "ok" : "FAILED");
+    return wrong != 0;
+}
@@ -0,0 +1,275 @@
+#include <stdio.h>          // printf(), fprintf()
+#include <stdlib.h>         // srand(), rand()
+#include <stdbool.h>        // bool
+
+#include "fset.h"
+#include "fmap.h"
+
+/*
+ * Runs random single inserts and removes and bulk merges on fsets and
+ * fmaps against a table of which keys are present. Batches repeat keys
+ * within themselves and overlap the keys already held, so merging must
+ * keep the entry already present, or else the first in the batch; each
+ * key's value records which insert it came from to tell them apart.
+ */
+
+#define KEYS 3000
+#define STEPS 20000
+#define BATCH 400
+
+static bool present[KEYS];
+static long vals[KEYS];     // the value |key| should map to, if present
+
+static int compare_int(void *a, void *b) {
+    int x = *(int *)a, y = *(int *)b;
+    return (x > y) - (x < y);
+}
+
+static int model_lower(int k) {
+    while (--k >= 0 && !present[k]) {
+    }
+    return k;
+}
+
+static int model_higher(int k) {
+    while (++k < KEYS && !present[k]) {
+    }
+    return (k < KEYS) ? k : -1;
+}
+
+// walks |s| by index, checking it holds just the present keys, and checks ranks and neighbours
+static size_t check_set(const fset * const s) {
+    size_t rank = 0, before, wrong = 0;
+    int k, lo, hi, *got, *got_lo, *got_hi;
+
+    for (k = 0; k < KEYS; k++) {
+        wrong += fset_rank(s, &k) != rank || fset_contains(s, &k) != present[k];
+
+        if (present[k]) {
+            got = fset_select(s, rank++);
+            wrong += got == NULL || *got != k;
+        }
+    }
+    wrong += fset_size(s) != rank || fset_select(s, rank) != NULL;
+
+    got_lo = fset_floor(s);
+    got_hi = fset_ceil(s);
+    wrong += (rank == 0) ? got_lo != NULL || got_hi != NULL
+                         : *got_lo != model_higher(-1) || *got_hi != model_lower(KEYS);
+
+    k = rand() % KEYS;
+    lo = model_lower(k);
+    hi = model_higher(k);
+    got_lo = fset_lower(s, &k);
+    got_hi = fset_higher(s, &k);
+    wrong += (got_lo == NULL) != (lo < 0) || (got_lo != NULL && *got_lo != lo);
+    wrong += (got_hi == NULL) != (hi < 0) || (got_hi != NULL && *got_hi != hi);
+
+    lo = rand() % KEYS;
+    hi = lo + rand() % (KEYS - lo);
+    for (k = lo, before = 0; k <= hi; k++) {
+        before += present[k];
+    }
+    wrong += fset_count_range(s, &lo, &hi) != before || fset_count_range(s, &hi, &lo) != (lo == hi) * before;
+
+    return wrong;
+}
+
+static size_t check_map(fmap * const m) {
+    size_t rank = 0, i, wrong = 0;
+    int probes[] = { -1, rand() % KEYS, rand() % KEYS, KEYS }, k, lo, hi, *key;
+    long *got;
+    pair *p;
+
+    for (k = 0; k < KEYS; k++) {
+        got = fmap_get(m, &k);
+        wrong += (got != NULL) != present[k] || (got != NULL && *got != vals[k]);
+        wrong += fmap_rank(m, &k) != rank;
+
+        if (present[k]) {
+            p = fmap_select(m, rank);
+            key = fmap_select_key(m, rank++);
+            wrong += p == NULL || *(int *)p->key != k || *(long *)p->val != vals[k];
+            wrong += key == NULL || *key != k;
+            pair_del(&p);
+        }
+    }
+    wrong += fmap_size(m) != rank || fmap_select(m, rank) != NULL || fmap_select_key(m, rank) != NULL;
+
+    p = fmap_floor(m);
+    key = fmap_ceil_key(m);
+    wrong += (rank == 0) ? p != NULL || key != NULL || fmap_ceil(m) != NULL
+                         : *(int *)p->key != model_higher(-1) || *key != model_lower(KEYS);
+    pair_del(&p);
+
+    // lower and higher, from within the range and from past each end
+    for (i = 0; i < sizeof(probes) / sizeof(probes[0]); i++) {
+        k = probes[i];
+        lo = model_lower(k);
+        hi = model_higher(k);
+
+        p = fmap_lower(m, &k);
+        key = fmap_lower_key(m, &k);
+        wrong += (p == NULL) != (lo < 0) || (key == NULL) != (lo < 0);
+        wrong += p != NULL && (*(int *)p->key != lo || *(long *)p->val != vals[lo] || *key != lo);
+        pair_del(&p);
+
+        p = fmap_higher(m, &k);
+        key = fmap_higher_key(m, &k);
+        wrong += (p == NULL) != (hi < 0) || (key == NULL) != (hi < 0);
+        wrong += p != NULL && (*(int *)p->key != hi || *(long *)p->val != vals[hi] || *key != hi);
+        pair_del(&p);
+    }
+
+    return wrong;
+}
+
+static void clear(void) {
+    int k;
+
+    for (k = 0; k < KEYS; k++) {
+        present[k] = false;
+    }
+}
+
+// |n| keys from a random span, so with repeats, and values unique to each
+static void fill_batch(int *keys, long *batch_vals, size_t n, long tag) {
+    int lo = rand() % KEYS, span = rand() % KEYS + 1;
+    size_t i;
+
+    for (i = 0; i < n; i++) {
+        keys[i] = (lo + rand() % span) % KEYS;
+        batch_vals[i] = tag * KEYS * 4 + (long)i;
+    }
+}
+
+static size_t run_set(void) {
+    fset *s = fset_init(sizeof(int), compare_int), *copy;
+    int keys[BATCH], sorted[KEYS];
+    long batch_vals[BATCH];
+    size_t i, j, n, wrong = 0;
+    int k;
+
+    clear();
+    for (i = 0; i < STEPS; i++) {
+        k = rand() % KEYS;
+
+        if (i % 500 == 0) {
+            n = rand() % BATCH;
+            fill_batch(keys, batch_vals, n, (long)i);
+            fset_insert_many(s, keys, n);
+            for (j = 0; j < n; j++) {
+                present[keys[j]] = true;
+            }
+            wrong += check_set(s);
+        } else if ((rand() % 4 != 0) == (i < STEPS / 2)) {
+            wrong += fset_insert(s, &k) == present[k];
+            present[k] = true;
+        } else {
+            wrong += fset_remove(s, &k) != present[k];
+            present[k] = false;
+        }
+
+        wrong += fset_contains(s, &k) != present[k];
+        if (i % 200 == 0) {
+            wrong += check_set(s);
+        }
+    }
+    wrong += check_set(s);
+
+    // a clone and a set built from sorted keys are separate copies
+    copy = fset_clone(s);
+    for (k = 0, n = 0; k < KEYS; k++) {
+        if (present[k]) {
+            sorted[n++] = k;
+        }
+    }
+    fset_del(&s);
+    wrong += check_set(copy);
+    fset_del(&copy);
+
+    s = fset_from_sorted(sizeof(int), compare_int, sorted, n);
+    wrong += check_set(s);
+    fset_del(&s);
+    return wrong + (s != NULL);
+}
+
+static size_t run_map(void) {
+    fmap *m = fmap_init(sizeof(int), sizeof(long), compare_int), *copy;
+    int keys[BATCH];
+    long val, batch_vals[BATCH];
+    size_t i, j, n, wrong = 0;
+    int k;
+
+    clear();
+    for (i = 0; i < STEPS; i++) {
+        k = rand() % KEYS;
+        val = (long)i;
+
+        if (i % 500 == 0) {
+            n = rand() % BATCH;
+            fill_batch(keys, batch_vals, n, (long)i);
+            fmap_insert_many(m, keys, batch_vals, n);
+            for (j = 0; j < n; j++) {
+                if (!present[keys[j]]) {
+                    present[keys[j]] = true;
+                    vals[keys[j]] = batch_vals[j];
+                }
+            }
+            wrong += check_map(m);
+        } else if (rand() % 3 != 0) {
+            wrong += fmap_insert(m, &k, &val) == present[k];
+            if (!present[k]) {
+                present[k] = true;
+                vals[k] = val;
+            }
+        } else {
+            wrong += fmap_remove(m, &k) != present[k];
+            present[k] = false;
+        }
+
+        wrong += fmap_contains(m, &k) != present[k];
+        if (i % 200 == 0) {
+            wrong += check_map(m);
+        }
+    }
+    wrong += check_map(m);
+
+    copy = fmap_clone(m);
+    fmap_del(&m);
+    wrong += check_map(copy);
+
+    // merging into an empty map and from an empty batch
+    m = fmap_init(sizeof(int), sizeof(long), compare_int);
+    clear();
+    fmap_insert_many(m, keys, batch_vals, 0);
+    wrong += check_map(m);
+    fill_batch(keys, batch_vals, BATCH, 1);
+    fmap_insert_many(m, keys, batch_vals, BATCH);
+    for (j = 0; j < BATCH; j++) {
+        if (!present[keys[j]]) {
+            present[keys[j]] = true;
+            vals[keys[j]] = batch_vals[j];
+        }
+    }
+    wrong += check_map(m);
+
+    fmap_del(&m);
+    fmap_del(&copy);
+    return wrong + (m != NULL || copy != NULL);
+}
+
+int main(void) {
+    size_t set, map;
+
+    srand(1);
+    set = run_set();
+    map = run_map();
+
+    if (set + map > 0) {
+        fprintf(stderr, "fset %zu, fmap %zu wrong results\n", set, map);
+    }
+
+    printf("test_fset: %s\n", (set + map == 0) ? "ok" : "FAILED");
+    return set + map != 0;
+}
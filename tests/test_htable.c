@@ -0,0 +1,100 @@
+#include <stdio.h>          // printf(), fprintf()
+#include <stdlib.h>         // srand(), rand()
+#include <stdbool.h>        // bool
+
+#include "umap.h"
+
+/*
+ * Checks every key while an incremental rehash is under way. Hashing keys
+ * to a few values builds long probe runs, some of which wrap from the end
+ * of the old table past the slots migration has already emptied.
+ *
+ * The table doubles from a power-of-two capacity once the size passes the
+ * max load, and a rehash spans many later calls, so with a max load of 1/2
+ * every key is checked after each of the few calls that follow the size
+ * passing half a power of two.
+ */
+
+#define KEYS 20000
+#define STEPS 200000
+#define WINDOW 32       // calls after a rehash starts to check every key in
+
+static size_t hash_clustered(void *key) {
+    return (size_t)(*(int *)key % 97);
+}
+
+static bool equal_int(void *a, void *b) {
+    return *(int *)a == *(int *)b;
+}
+
+static bool is_pow2(size_t n) {
+    return n > 0 && (n & (n - 1)) == 0;
+}
+
+static bool check(umap * const m, int k, bool present) {
+    int *val = umap_get(m, &k);
+    return (val != NULL) == present && (val == NULL || *val == k) && umap_contains(m, &k) == present;
+}
+
+static size_t run(unsigned int seed) {
+    umap *m = umap_init(sizeof(int), sizeof(int), hash_clustered, equal_int);
+    static bool present[KEYS];
+    size_t i, high = 0, window = 0, wrong = 0;
+    int k;
+
+    umap_set_max_load(m, 0.5);
+
+    srand(seed);
+    for (k = 0; k < KEYS; k++) {
+        present[k] = false;
+    }
+
+    for (i = 0; i < STEPS; i++) {
+        k = rand() % KEYS;
+
+        if (rand() % 4 != 0) {
+            wrong += umap_insert(m, &k, &k) == present[k];
+            present[k] = true;
+        } else {
+            wrong += umap_remove(m, &k) != present[k];
+            present[k] = false;
+        }
+
+        if (umap_size(m) > high) {
+            high = umap_size(m);
+            if (is_pow2(high - 1)) {
+                window = WINDOW;
+            }
+        }
+
+        if (window > 0 || i == STEPS - 1) {
+            for (k = 0; k < KEYS; k++) {
+                wrong += !check(m, k, present[k]);
+            }
+        }
+
+        if (window > 0) {
+            window--;
+        }
+    }
+
+    umap_del(&m);
+    return wrong;
+}
+
+int main(void) {
+    unsigned int seed;
+    size_t wrong = 0;
+
+    for (seed = 1; seed <= 3; seed++) {
+        size_t n = run(seed);
+
+        if (n > 0) {
+            fprintf(stderr, "seed %u: %zu wrong results during rehash\n", seed, n);
+        }
+        wrong += n;
+    }
+
+    printf("test_htable: %s\n", (wrong == 0) ? "ok" : "FAILED");
+    return wrong != 0;
+}
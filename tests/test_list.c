@@ -0,0 +1,156 @@
+#include <stdio.h>          // printf(), fprintf()
+#include <stdlib.h>         // srand(), rand()
+#include <stdbool.h>        // bool
+#include <string.h>         // memmove(), memcpy()
+
+#include "list.h"
+
+/*
+ * Runs random cursor inserts and erases and splices between two lists,
+ * and within one, against a pair of plain arrays, for every mix of pooled
+ * and unpooled lists, checking both lists from each end after every call.
+ */
+
+#define MAX_LEN 4096
+#define STEPS 6000
+
+struct model_t {
+    int vals[MAX_LEN];
+    size_t len;
+};
+
+static list_cursor cursor_at(const list * const l, size_t i) {
+    return (i == list_size(l)) ? list_cursor_end(l) : list_cursor_at(l, i);
+}
+
+static size_t check(const list * const l, const struct model_t * const m) {
+    list_cursor c;
+    size_t i, wrong = list_size(l) != m->len;
+    int *got;
+
+    c = list_cursor_front(l);
+    for (i = 0; i < m->len; i++, list_cursor_next(&c)) {
+        got = list_cursor_get(&c);
+        wrong += got == NULL || *got != m->vals[i];
+    }
+    wrong += c.node != NULL;
+
+    for (i = m->len; i-- > 0; ) {
+        list_cursor_prev(&c);
+        got = list_cursor_get(&c);
+        wrong += got == NULL || *got != m->vals[i];
+    }
+
+    wrong += (m->len == 0) ? list_front(l) != NULL || list_back(l) != NULL
+                           : *(int *)list_front(l) != m->vals[0]
+                             || *(int *)list_back(l) != m->vals[m->len - 1];
+    return wrong;
+}
+
+// moves |from|'s vals from |first| up to |last| into |to| before |pos|
+static void model_splice(struct model_t *to, size_t pos,
+        struct model_t *from, size_t first, size_t last) {
+    int run[MAX_LEN];
+    size_t n = last - first;
+
+    memcpy(run, from->vals + first, n * sizeof(int));
+    memmove(from->vals + first, from->vals + last, (from->len - last) * sizeof(int));
+    from->len -= n;
+
+    if (to == from && pos > first) {
+        pos -= n;
+    }
+
+    memmove(to->vals + pos + n, to->vals + pos, (to->len - pos) * sizeof(int));
+    memcpy(to->vals + pos, run, n * sizeof(int));
+    to->len += n;
+}
+
+static size_t run(bool pool_a, bool pool_b) {
+    static struct model_t models[2];
+    list *lists[2];
+    list_cursor c, first, last;
+    size_t i, pos, lo, hi, wrong = 0;
+    int next = 0, op, from, to, *got;
+
+    lists[0] = pool_a ? list_init_pooled(sizeof(int)) : list_init(sizeof(int));
+    lists[1] = pool_b ? list_init_pooled(sizeof(int)) : list_init(sizeof(int));
+    models[0].len = models[1].len = 0;
+
+    for (i = 0; i < STEPS; i++) {
+        struct model_t *m;
+        list *l;
+
+        from = rand() % 2;
+        l = lists[from];
+        m = &models[from];
+        pos = rand() % (m->len + 1);
+        op = rand() % 8;
+
+        if (op < 3 && m->len + 1 < MAX_LEN / 2) {
+            // insert before or after |pos|, where after the end means at the front
+            bool after = op == 0;
+            size_t at = after ? ((pos == m->len) ? 0 : pos + 1) : pos;
+
+            c = cursor_at(l, pos);
+            if (after) {
+                list_cursor_insert_after(l, &c, &next);
+            } else {
+                list_cursor_insert_before(l, &c, &next);
+            }
+            memmove(m->vals + at + 1, m->vals + at, (m->len - at) * sizeof(int));
+            m->vals[at] = next++;
+            m->len++;
+        } else if (op < 5 && pos < m->len) {
+            c = cursor_at(l, pos);
+            list_cursor_erase(l, &c);
+            memmove(m->vals + pos, m->vals + pos + 1, (m->len - pos - 1) * sizeof(int));
+            m->len--;
+
+            // the cursor moves on to the next elem
+            got = list_cursor_get(&c);
+            wrong += (pos < m->len) ? got == NULL || *got != m->vals[pos] : got != NULL;
+        } else if (m->len > 0) {
+            // a run of |from|, into the other list or elsewhere in |from|
+            to = (op == 7) ? from : !from;
+            lo = rand() % m->len;
+            hi = lo + 1 + rand() % (m->len - lo);
+
+            pos = rand() % (models[to].len + 1);
+            if (to == from && pos >= lo && pos < hi) {
+                pos = hi;   // not within the moved run
+            }
+
+            first = cursor_at(l, lo);
+            last = cursor_at(l, hi);
+            c = cursor_at(lists[to], pos);
+            list_splice(lists[to], &c, l, &first, &last, (rand() % 2) ? hi - lo : 0);
+            model_splice(&models[to], pos, m, lo, hi);
+
+            wrong += first.node != last.node;
+        }
+
+        wrong += check(lists[0], &models[0]) + check(lists[1], &models[1]);
+    }
+
+    list_del(&lists[0]);
+    list_del(&lists[1]);
+    return wrong;
+}
+
+int main(void) {
+    size_t mix, wrong = 0;
+
+    srand(1);
+    for (mix = 0; mix < 4; mix++) {
+        size_t n = run(mix & 1, mix & 2);
+
+        if (n > 0) {
+            fprintf(stderr, "pooled %d/%d: %zu wrong results\n", (int)(mix & 1), (int)(mix & 2) / 2, n);
+        }
+        wrong += n;
+    }
+
+    printf("test_list: %s\n", (wrong == 0) ? "ok" : "FAILED");
+    return wrong != 0;
+}
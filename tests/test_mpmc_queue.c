@@ -0,0 +1,196 @@
+#include <stdio.h>          // printf(), fprintf()
+#include <stdlib.h>         // srand(), rand()
+#include <stdint.h>         // uint64_t
+#include <stdatomic.h>      // atomic_size_t, atomic_fetch_add()
+#include <pthread.h>        // pthread_create(), pthread_join()
+#include <sched.h>          // sched_yield()
+
+#include "mpmc_queue.h"
+
+/*
+ * Checks the bounds and wraparound on one thread, then has several
+ * producers and consumers share a small queue, mixing single and batch
+ * calls. Each item names its producer and its place in that producer's
+ * stream: every item must arrive once and whole, and each consumer must
+ * see every producer's items in the order they were pushed.
+ */
+
+#define PRODUCERS 3
+#define CONSUMERS 3
+#define ITEMS 100000    // per producer
+#define BATCH 13        // longest run moved by one call
+
+struct item_t {
+    uint64_t producer, seq;
+    uint64_t check;     // derived from the other two, to catch torn copies
+};
+
+static uint64_t check_of(uint64_t producer, uint64_t seq) {
+    return (producer * ITEMS + seq) * 0x9E3779B97F4A7C15ull ^ 0xABCDEF;
+}
+
+/*
+ * Pushes and pops runs of uneven length, so runs often straddle the end
+ * of the buffer, checking each call moves as many as fit or are there.
+ */
+static size_t check_single_thread(void) {
+    mpmc_queue *q = mpmc_queue_init(sizeof(int), 6);
+    size_t step, n, moved, cap = mpmc_queue_capacity(q), size = 0, wrong = 0;
+    int vals[16], out[16], pushed = 0, popped = 0;
+
+    wrong += cap < 6 || mpmc_queue_size(q) != 0 || mpmc_queue_pop(q, out);
+
+    srand(1);
+    for (step = 0; step < 20000; step++) {
+        n = rand() % 7 + 1;
+
+        if (rand() % 2 == 0) {
+            for (moved = 0; moved < n; moved++) {
+                vals[moved] = pushed + (int)moved;
+            }
+
+            moved = (n == 1) ? mpmc_queue_push(q, vals) : mpmc_queue_push_n(q, vals, n);
+            wrong += moved != ((n < cap - size) ? n : cap - size);
+            pushed += (int)moved;
+            size += moved;
+        } else {
+            moved = (n == 1) ? mpmc_queue_pop(q, out) : mpmc_queue_pop_n(q, out, n);
+            wrong += moved != ((n < size) ? n : size);
+
+            for (n = 0; n < moved; n++) {
+                wrong += out[n] != popped++;
+            }
+            size -= moved;
+        }
+
+        wrong += mpmc_queue_size(q) != size;
+    }
+
+    mpmc_queue_del(&q);
+    return wrong;
+}
+
+struct shared_t {
+    mpmc_queue *q;
+    atomic_size_t popped;
+    atomic_size_t wrong;
+    atomic_size_t seen[PRODUCERS];  // sums of the seqs received from each
+};
+
+struct producer_t {
+    struct shared_t *shared;
+    uint64_t id;
+};
+
+static void *produce(void *arg) {
+    struct producer_t *p = arg;
+    struct item_t batch[BATCH];
+    uint64_t seq = 0;
+    size_t i, n, pushed;
+
+    while (seq < ITEMS) {
+        n = (seq % 3 != 1) ? seq % BATCH + 1 : 1;
+        n = (ITEMS - seq < n) ? ITEMS - seq : n;
+
+        for (i = 0; i < n; i++) {
+            batch[i].producer = p->id;
+            batch[i].seq = seq + i;
+            batch[i].check = check_of(p->id, seq + i);
+        }
+
+        pushed = (n == 1) ? mpmc_queue_push(p->shared->q, batch) : mpmc_queue_push_n(p->shared->q, batch, n);
+        seq += pushed;
+        if (pushed < n) {
+            sched_yield();
+        }
+    }
+
+    return NULL;
+}
+
+static void *consume(void *arg) {
+    struct shared_t *shared = arg;
+    struct item_t batch[BATCH];
+    uint64_t next[PRODUCERS] = {0};     // least seq each producer can send next
+    size_t i, n, wrong = 0, round = 0;
+
+    while (atomic_load(&shared->popped) < PRODUCERS * ITEMS) {
+        n = (round % 5 != 0) ? mpmc_queue_pop_n(shared->q, batch, round % BATCH + 1) : mpmc_queue_pop(shared->q, batch);
+        round++;
+
+        for (i = 0; i < n; i++) {
+            struct item_t *it = &batch[i];
+
+            if (it->producer >= PRODUCERS || it->check != check_of(it->producer, it->seq)
+                    || it->seq < next[it->producer]) {
+                wrong++;
+                continue;
+            }
+
+            next[it->producer] = it->seq + 1;
+            atomic_fetch_add(&shared->seen[it->producer], it->seq);
+        }
+
+        atomic_fetch_add(&shared->popped, n);
+        if (n == 0) {
+            sched_yield();
+        }
+    }
+
+    atomic_fetch_add(&shared->wrong, wrong);
+    return NULL;
+}
+
+static size_t check_threads(void) {
+    struct shared_t shared;
+    struct producer_t producers[PRODUCERS];
+    pthread_t threads[PRODUCERS + CONSUMERS];
+    struct item_t junk = {0, 0, 0};
+    size_t i, wrong;
+
+    shared.q = mpmc_queue_init(sizeof(struct item_t), 64);
+
+    // start the positions off a multiple of the capacity, as in test_spsc_queue.c
+    for (i = 0; i < 100; i++) {
+        mpmc_queue_push(shared.q, &junk);
+        mpmc_queue_pop(shared.q, &junk);
+    }
+    atomic_init(&shared.popped, 0);
+    atomic_init(&shared.wrong, 0);
+    for (i = 0; i < PRODUCERS; i++) {
+        atomic_init(&shared.seen[i], 0);
+    }
+
+    for (i = 0; i < CONSUMERS; i++) {
+        pthread_create(&threads[i], NULL, consume, &shared);
+    }
+    for (i = 0; i < PRODUCERS; i++) {
+        producers[i].shared = &shared;
+        producers[i].id = i;
+        pthread_create(&threads[CONSUMERS + i], NULL, produce, &producers[i]);
+    }
+    for (i = 0; i < PRODUCERS + CONSUMERS; i++) {
+        pthread_join(threads[i], NULL);
+    }
+
+    // with no item lost or repeated, each producer's seqs sum to the same
+    wrong = atomic_load(&shared.wrong) + (atomic_load(&shared.popped) != PRODUCERS * ITEMS);
+    for (i = 0; i < PRODUCERS; i++) {
+        wrong += atomic_load(&shared.seen[i]) != (size_t)ITEMS * (ITEMS - 1) / 2;
+    }
+
+    wrong += mpmc_queue_size(shared.q) != 0;
+    mpmc_queue_del(&shared.q);
+    return wrong;
+}
+
+int main(void) {
+    size_t single = check_single_thread(), threads = check_threads();
+
+    if (single + threads > 0) {
+        fprintf(stderr, "%zu wrong results on one thread, %zu across several\n", single, threads);
+    }
+
+    printf("test_mpmc_queue: %s\n", (single + threads == 0) ? "ok" : "FAILED");
+    return single + threads != 0;
+}
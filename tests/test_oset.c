@@ -0,0 +1,310 @@
+#include <stdio.h>          // printf(), fprintf()
+#include <stdlib.h>         // srand(), rand()
+#include <stdbool.h>        // bool
+
+#include "oset.h"
+#include "omap.h"
+#include "tree.h"
+
+/*
+ * Runs random inserts and removes on osets and omaps against a table of
+ * which keys are present, checking lookups, neighbours, ranks and
+ * iterators, and that the red-black rules and subtree counts hold
+ * throughout. The maps' iterators are run over both backends.
+ */
+
+#define KEYS 4000
+#define STEPS 40000
+
+static bool present[KEYS];
+
+static int compare_int(void *a, void *b) {
+    int x = *(int *)a, y = *(int *)b;
+    return (x > y) - (x < y);
+}
+
+// black height of |n|'s subtree, or -1 if a rule is broken in it
+static int check_node(const struct tree_node_t *n, int lo, int hi) {
+    int left, right, key;
+
+    if (n == NULL) {
+        return 1;
+    }
+
+    key = *(const int *)n->key;
+    if (key <= lo || key >= hi || (n->red && n->parent != NULL && n->parent->red)) {
+        return -1;
+    }
+    if ((n->left != NULL && n->left->parent != n) || (n->right != NULL && n->right->parent != n)) {
+        return -1;
+    }
+    if (n->count != 1 + (n->left ? n->left->count : 0) + (n->right ? n->right->count : 0)) {
+        return -1;
+    }
+
+    left = check_node(n->left, lo, key);
+    right = check_node(n->right, key, hi);
+    if (left < 0 || left != right) {
+        return -1;
+    }
+
+    return left + !n->red;
+}
+
+static bool tree_valid(const tree * const t) {
+    int height;
+
+    if (t->root == NULL) {
+        return t->size == 0;
+    }
+
+    height = check_node(t->root, -1, KEYS);
+    return !t->root->red && t->root->parent == NULL && height > 0 && t->root->count == t->size;
+}
+
+static int model_lower(int k) {
+    while (--k >= 0 && !present[k]) {
+    }
+    return k;
+}
+
+static int model_higher(int k) {
+    while (++k < KEYS && !present[k]) {
+    }
+    return (k < KEYS) ? k : -1;
+}
+
+static size_t check_neighbours(const oset * const s, int k) {
+    int lo = model_lower(k), hi = model_higher(k);
+    int *got_lo = oset_lower(s, &k), *got_hi = oset_higher(s, &k);
+
+    return (got_lo == NULL) != (lo < 0) || (got_lo != NULL && *got_lo != lo)
+        || (got_hi == NULL) != (hi < 0) || (got_hi != NULL && *got_hi != hi);
+}
+
+// checks rank(), select() and count_range() against running counts of the table
+static size_t check_ranks(const oset * const s) {
+    size_t before = 0, wrong = 0;
+    int k, *got, lo, hi;
+
+    for (k = 0; k < KEYS; k++) {
+        wrong += oset_rank(s, &k) != before;
+
+        if (present[k]) {
+            got = oset_select(s, before);
+            wrong += got == NULL || *got != k;
+            before++;
+        }
+    }
+
+    wrong += oset_select(s, before) != NULL;
+
+    lo = rand() % KEYS;
+    hi = lo + rand() % (KEYS - lo);
+    for (k = lo, before = 0; k <= hi; k++) {
+        before += present[k];
+    }
+    wrong += oset_count_range(s, &lo, &hi) != before || oset_count_range(s, &hi, &lo) != (lo == hi) * before;
+
+    return wrong;
+}
+
+/*
+ * Walks |s| both ways and from random keys, then erases every third elem
+ * through an iterator; |s| is left holding just the present keys.
+ */
+static size_t check_iters(oset * const s) {
+    oset_iter it, end = oset_iter_end(s);
+    size_t wrong = 0;
+    int k, from, *got;
+
+    it = oset_iter_begin(s);
+    for (k = 0; k < KEYS; k++) {
+        if (present[k]) {
+            got = oset_iter_get(&it);
+            wrong += got == NULL || *got != k;
+            oset_iter_next(&it);
+        }
+    }
+    wrong += !oset_iter_equal(&it, &end) || oset_iter_get(&it) != NULL;
+
+    for (k = KEYS - 1; k >= 0; k--) {
+        if (present[k]) {
+            oset_iter_prev(&it);
+            got = oset_iter_get(&it);
+            wrong += got == NULL || *got != k;
+        }
+    }
+
+    from = rand() % KEYS;
+    it = oset_iter_from(s, &from);
+    for (k = from; k < KEYS && !present[k]; k++) {
+    }
+    got = oset_iter_get(&it);
+    wrong += (k < KEYS) ? got == NULL || *got != k : got != NULL;
+
+    for (it = oset_iter_begin(s); !oset_iter_equal(&it, &end); ) {
+        k = *(int *)oset_iter_get(&it);
+        if (k % 3 == 0) {
+            oset_iter_erase(s, &it);
+            present[k] = false;
+        } else {
+            oset_iter_next(&it);
+        }
+    }
+
+    return wrong;
+}
+
+// the same over |m|'s keys, whose values are minus the key
+static size_t check_map_iters(omap * const m) {
+    omap_iter it;
+    size_t wrong = 0;
+    int k, from, *got;
+
+    it = omap_iter_begin(m);
+    for (k = 0; k < KEYS; k++) {
+        if (present[k]) {
+            got = omap_iter_key(&it);
+            wrong += got == NULL || *got != k || *(long *)omap_iter_val(&it) != -(long)k;
+            omap_iter_next(&it);
+        }
+    }
+    wrong += it.node != NULL || omap_iter_key(&it) != NULL || omap_iter_val(&it) != NULL;
+
+    for (k = KEYS - 1; k >= 0; k--) {
+        if (present[k]) {
+            omap_iter_prev(&it);
+            got = omap_iter_key(&it);
+            wrong += got == NULL || *got != k;
+        }
+    }
+
+    from = rand() % KEYS;
+    it = omap_iter_from(m, &from);
+    for (k = from; k < KEYS && !present[k]; k++) {
+    }
+    got = omap_iter_key(&it);
+    wrong += (k < KEYS) ? got == NULL || *got != k : got != NULL;
+
+    for (it = omap_iter_begin(m); it.node != NULL; ) {
+        k = *(int *)omap_iter_key(&it);
+        if (k % 3 == 0) {
+            omap_iter_erase(m, &it);
+            present[k] = false;
+        } else {
+            omap_iter_next(&it);
+        }
+    }
+
+    return wrong;
+}
+
+static size_t run_oset(oset *s) {
+    size_t i, size = 0, wrong = 0;
+    int k, *first, *last;
+
+    for (k = 0; k < KEYS; k++) {
+        present[k] = false;
+    }
+
+    for (i = 0; i < STEPS; i++) {
+        k = rand() % KEYS;
+
+        // mostly inserts for the first half, then mostly removes
+        if ((rand() % 4 != 0) == (i < STEPS / 2)) {
+            wrong += oset_insert(s, &k) == present[k];
+            size += !present[k];
+            present[k] = true;
+        } else {
+            wrong += oset_remove(s, &k) != present[k];
+            size -= present[k];
+            present[k] = false;
+        }
+
+        wrong += oset_size(s) != size;
+        wrong += oset_contains(s, &k) != present[k];
+        wrong += check_neighbours(s, rand() % KEYS);
+
+        if (i % 1000 == 0) {
+            wrong += !tree_valid(oset_tree(s));
+            wrong += check_ranks(s);
+        }
+
+        if (i % 5000 == 0) {
+            wrong += check_iters(s);
+            wrong += !tree_valid(oset_tree(s)) || check_ranks(s);
+            size = oset_size(s);
+
+            first = oset_floor(s);
+            last = oset_ceil(s);
+            wrong += (size == 0) ? first != NULL || last != NULL
+                                 : *first != model_higher(-1) || *last != model_lower(KEYS);
+        }
+    }
+
+    wrong += !tree_valid(oset_tree(s));
+    oset_del(&s);
+    wrong += s != NULL;
+    return wrong;
+}
+
+static size_t run_omap(omap *m) {
+    size_t i, wrong = 0;
+    long val, *got;
+    int k;
+
+    for (k = 0; k < KEYS; k++) {
+        present[k] = false;
+    }
+
+    for (i = 0; i < STEPS; i++) {
+        k = rand() % KEYS;
+        val = -(long)k;
+
+        if (rand() % 3 != 0) {
+            wrong += omap_insert(m, &k, &val) == present[k];
+            present[k] = true;
+        } else {
+            wrong += omap_remove(m, &k) != present[k];
+            present[k] = false;
+        }
+
+        k = rand() % KEYS;
+        got = omap_get(m, &k);
+        wrong += (got != NULL) != present[k] || (got != NULL && *got != -(long)k);
+
+        if (present[k]) {
+            size_t rank = omap_rank(m, &k);
+            int *key = omap_select_key(m, rank);
+            wrong += key == NULL || *key != k;
+        }
+
+        if (i % 5000 == 0) {
+            wrong += check_map_iters(m);
+        }
+    }
+
+    wrong += check_map_iters(m);
+    wrong += omap_tree(m) != NULL && !tree_valid(omap_tree(m));
+    omap_del(&m);
+    return wrong;
+}
+
+int main(void) {
+    size_t plain, pooled, map, btree_map;
+
+    srand(1);
+    plain = run_oset(oset_init(sizeof(int), compare_int));
+    pooled = run_oset(oset_init_pooled(sizeof(int), compare_int));
+    map = run_omap(omap_init(sizeof(int), sizeof(long), compare_int));
+    btree_map = run_omap(omap_init_btree(sizeof(int), sizeof(long), compare_int, 0));
+
+    if (plain + pooled + map + btree_map > 0) {
+        fprintf(stderr, "oset %zu, pooled oset %zu, omap %zu, B-tree omap %zu wrong results\n",
+                plain, pooled, map, btree_map);
+    }
+
+    printf("test_oset: %s\n", (plain + pooled + map + btree_map == 0) ? "ok" : "FAILED");
+    return plain + pooled + map + btree_map != 0;
+}
@@ -0,0 +1,148 @@
+#include <stdio.h>          // printf(), fprintf()
+#include <stdlib.h>         // srand(), rand()
+#include <stdbool.h>        // bool
+#include <limits.h>         // INT_MIN
+
+#include "pqueue.h"
+
+/*
+ * Checks pop order for a few arities, and that every handle still reaches
+ * its own elem after batch pushes that rebuild the heap, key changes and
+ * removals. Each elem carries the index of its handle so a handle that
+ * drifts onto another elem is caught even when the keys are equal.
+ */
+
+#define N 2000
+
+typedef struct {
+    int key;
+    int tag;
+} item;
+
+static int compare_item(void *a, void *b) {
+    return ((item *)a)->key - ((item *)b)->key;
+}
+
+static size_t check_order(size_t arity) {
+    pqueue *q = pqueue_init(sizeof(item), arity, compare_item);
+    item batch[N], it;
+    size_t i, wrong = 0;
+    int last = INT_MIN;
+
+    for (i = 0; i < N; i++) {
+        it.key = rand() % 1000;
+        it.tag = -1;
+        pqueue_push(q, &it);
+    }
+
+    for (i = 0; i < N; i++) {
+        batch[i].key = rand() % 1000;
+        batch[i].tag = -1;
+    }
+    pqueue_push_n(q, batch, N);
+    pqueue_push_n(q, batch, N / 10);
+
+    wrong += pqueue_size(q) != 2 * N + N / 10;
+
+    while (pqueue_size(q) > 0) {
+        item *top = pqueue_top(q);
+        wrong += top->key < last;
+        last = top->key;
+        pqueue_pop(q);
+    }
+
+    wrong += pqueue_top(q) != NULL;
+
+    pqueue_del(&q);
+    return wrong;
+}
+
+static size_t check_handles(size_t arity) {
+    pqueue *q = pqueue_init(sizeof(item), arity, compare_item);
+    static size_t handles[N];
+    static bool live[N];
+    item batch[N], it, *got;
+    size_t i, wrong = 0;
+    int last = INT_MIN;
+
+    for (i = 0; i < N; i++) {
+        it.key = rand() % 100;
+        it.tag = (int)i;
+        handles[i] = pqueue_push_handle(q, &it);
+        live[i] = true;
+        wrong += handles[i] == PQUEUE_NO_HANDLE;
+    }
+
+    // at least as many as are queued, so the heap is rebuilt around them
+    for (i = 0; i < N; i++) {
+        batch[i].key = rand() % 100;
+        batch[i].tag = -1;
+    }
+    pqueue_push_n(q, batch, N);
+
+    for (i = 0; i < N; i++) {
+        got = pqueue_get(q, handles[i]);
+        wrong += got == NULL || got->tag != (int)i;
+    }
+
+    for (i = 0; i < N; i += 3) {
+        it.key = rand() % 200 - 50;
+        it.tag = (int)i;
+        wrong += !pqueue_decrease_key(q, handles[i], &it);
+
+        got = pqueue_get(q, handles[i]);
+        wrong += got == NULL || got->tag != (int)i || got->key != it.key;
+    }
+
+    for (i = 1; i < N; i += 4) {
+        wrong += !pqueue_remove(q, handles[i]);
+        live[i] = false;
+    }
+
+    for (i = 0; i < N; i++) {
+        got = pqueue_get(q, handles[i]);
+
+        if (live[i]) {
+            wrong += got == NULL || got->tag != (int)i;
+        } else {
+            wrong += got != NULL || pqueue_remove(q, handles[i]);
+        }
+    }
+
+    while (pqueue_size(q) > 0) {
+        got = pqueue_top(q);
+
+        wrong += got->key < last;
+        last = got->key;
+
+        if (got->tag >= 0) {
+            wrong += !live[got->tag] || pqueue_get(q, handles[got->tag]) != got;
+            live[got->tag] = false;
+        }
+        pqueue_pop(q);
+    }
+
+    for (i = 0; i < N; i++) {
+        wrong += live[i];
+    }
+
+    pqueue_del(&q);
+    return wrong;
+}
+
+int main(void) {
+    size_t arities[] = {2, 4, 8}, i, wrong = 0;
+
+    srand(1);
+    for (i = 0; i < sizeof(arities) / sizeof(arities[0]); i++) {
+        size_t n = check_order(arities[i]) + check_handles(arities[i]);
+
+        if (n > 0) {
+            fprintf(stderr, "arity %zu: %zu wrong results\n", arities[i], n);
+        }
+        wrong += n;
+    }
+
+    printf("test_pqueue: %s\n", (wrong == 0) ? "ok" : "FAILED");
+    return wrong != 0;
+}
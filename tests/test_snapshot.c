@@ -0,0 +1,198 @@
+#include <stdio.h>          // printf(), fprintf(), snprintf(), fopen(), remove()
+#include <stdlib.h>         // srand(), rand()
+#include <stdbool.h>        // bool
+#include <stdint.h>         // uint64_t
+#include <unistd.h>         // getpid(), truncate()
+
+#include "snapshot.h"
+
+/*
+ * Saves a vector, an oset and an omap, reads each back through the
+ * mapping, then checks that flipping a byte anywhere in a file, header
+ * included, or cutting it short makes opening it fail.
+ */
+
+#define N 5000
+
+static char path[64];
+
+static int compare_int(void *a, void *b) {
+    int x = *(int *)a, y = *(int *)b;
+    return (x > y) - (x < y);
+}
+
+static size_t file_size(void) {
+    FILE *f = fopen(path, "rb");
+    long size;
+
+    fseek(f, 0, SEEK_END);
+    size = ftell(f);
+    fclose(f);
+    return (size_t)size;
+}
+
+static void flip_byte(size_t offset) {
+    FILE *f = fopen(path, "r+b");
+    int c;
+
+    fseek(f, (long)offset, SEEK_SET);
+    c = fgetc(f);
+    fseek(f, (long)offset, SEEK_SET);
+    fputc(c ^ 0x10, f);
+    fclose(f);
+}
+
+static size_t check_vector(void) {
+    vector *v = vector_init(sizeof(int));
+    snapshot *s;
+    size_t i, wrong = 0;
+    int k;
+
+    for (k = 0; k < N; k++) {
+        int val = rand();
+        vector_push_back(v, &val);
+    }
+
+    wrong += !vector_save(v, path);
+    s = vector_open_mmap(path);
+    if (s == NULL) {
+        vector_del(&v);
+        return wrong + 1;
+    }
+
+    wrong += snapshot_size(s) != N || snapshot_key(s, N) != NULL || snapshot_val(s, 0) != NULL;
+    for (i = 0; i < N; i++) {
+        wrong += *(int *)snapshot_key(s, i) != *(int *)vector_get(v, i);
+    }
+
+    // no comparator, so key searches find nothing rather than crash
+    k = *(int *)vector_get(v, 0);
+    wrong += snapshot_seek(s, &k) != N || snapshot_contains(s, &k) || snapshot_get(s, &k) != NULL;
+
+    // the wrong kind is rejected too
+    wrong += oset_open_mmap(path, compare_int) != NULL;
+
+    snapshot_close(&s);
+    vector_del(&v);
+    return wrong;
+}
+
+static size_t check_oset(void) {
+    oset *set = oset_init(sizeof(int), compare_int);
+    snapshot *s;
+    size_t i, wrong = 0;
+    int k;
+
+    for (k = 0; k < 2 * N; k += 2) {
+        oset_insert(set, &k);
+    }
+
+    wrong += !oset_save(set, path);
+    s = oset_open_mmap(path, compare_int);
+    if (s == NULL) {
+        oset_del(&set);
+        return wrong + 1;
+    }
+
+    wrong += snapshot_size(s) != N;
+    for (i = 0; i < N; i++) {
+        wrong += *(int *)snapshot_key(s, i) != 2 * (int)i;
+    }
+
+    for (k = -1; k <= 2 * N; k++) {
+        wrong += snapshot_contains(s, &k) != (k >= 0 && k < 2 * N && k % 2 == 0);
+        wrong += snapshot_seek(s, &k) != (size_t)((k < 0) ? 0 : (k + 1) / 2);
+    }
+
+    snapshot_close(&s);
+    oset_del(&set);
+    return wrong;
+}
+
+static size_t check_omap(bool btree) {
+    omap *m = btree ? omap_init_btree(sizeof(int), sizeof(uint64_t), compare_int, 256)
+                    : omap_init(sizeof(int), sizeof(uint64_t), compare_int);
+    snapshot *s;
+    size_t i, wrong = 0;
+    int k;
+
+    for (i = 0; i < N; i++) {
+        uint64_t val;
+
+        k = rand() % (4 * N);
+        val = (uint64_t)k * 3;
+        omap_insert(m, &k, &val);
+    }
+
+    wrong += !omap_save(m, path);
+    s = omap_open_mmap(path, compare_int);
+    if (s == NULL) {
+        omap_del(&m);
+        return wrong + 1;
+    }
+
+    wrong += snapshot_size(s) != omap_size(m);
+    for (k = 0; k < 4 * N; k++) {
+        uint64_t *got = snapshot_get(s, &k);
+        wrong += (got != NULL) != omap_contains(m, &k) || (got != NULL && *got != (uint64_t)k * 3);
+    }
+
+    for (i = 1; i < snapshot_size(s); i++) {
+        wrong += compare_int(snapshot_key(s, i - 1), snapshot_key(s, i)) >= 0;
+    }
+
+    snapshot_close(&s);
+    omap_del(&m);
+    return wrong;
+}
+
+static size_t check_corruption(void) {
+    omap *m = omap_init(sizeof(int), sizeof(int), compare_int);
+    snapshot *s;
+    size_t size, offset, wrong = 0;
+    int k;
+
+    for (k = 0; k < N; k++) {
+        omap_insert(m, &k, &k);
+    }
+
+    /*
+     * Every byte of the header, since a bad count or size would send
+     * lookups outside the mapping, then a spread of payload bytes.
+     */
+    wrong += !omap_save(m, path);
+    size = file_size();
+    for (offset = 0; offset < size; offset += (offset < 128) ? 1 : 61) {
+        flip_byte(offset);
+        s = omap_open_mmap(path, compare_int);
+        if (s != NULL) {
+            fprintf(stderr, "corrupt byte at %zu accepted\n", offset);
+            snapshot_close(&s);
+            wrong++;
+        }
+        flip_byte(offset);
+    }
+
+    s = omap_open_mmap(path, compare_int);
+    wrong += s == NULL;
+    snapshot_close(&s);
+
+    wrong += truncate(path, (off_t)(size - 1)) != 0 || omap_open_mmap(path, compare_int) != NULL;
+    wrong += truncate(path, 16) != 0 || omap_open_mmap(path, compare_int) != NULL;
+
+    omap_del(&m);
+    return wrong;
+}
+
+int main(void) {
+    size_t wrong;
+
+    snprintf(path, sizeof(path), "/tmp/test_snapshot.%d", (int)getpid());
+    srand(1);
+
+    wrong = check_vector() + check_oset() + check_omap(false) + check_omap(true) + check_corruption();
+    remove(path);
+
+    printf("test_snapshot: %s\n", (wrong == 0) ? "ok" : "FAILED");
+    return wrong != 0;
+}
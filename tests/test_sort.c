@@ -0,0 +1,242 @@
+#include <stdio.h>          // printf(), fprintf()
+#include <stdlib.h>         // srand(), rand(), qsort(), malloc(), free()
+#include <stdint.h>         // uint*_t, int*_t
+#include <string.h>         // memcpy(), memcmp(), memset()
+
+#include "array.h"
+#include "vector.h"
+#include "elems.h"
+
+/*
+ * Sorts inputs of many sizes and shapes through the array and vector and
+ * checks each result is in order and holds the same elems. 24-byte elems
+ * take the generic swap path, and the radix sort is checked against qsort()
+ * for every integer width and signedness. Binary searches are checked
+ * against a linear scan, including keys outside the range held.
+ */
+
+#define MAX_N 200000
+
+struct wide_t {
+    int key;
+    unsigned id;        // unique, so a lost or repeated elem shows
+    char pad[16];
+};
+
+static int compare_int(void *a, void *b) {
+    int x = *(int *)a, y = *(int *)b;
+    return (x > y) - (x < y);
+}
+
+static int compare_wide(void *a, void *b) {
+    return compare_int(&((struct wide_t *)a)->key, &((struct wide_t *)b)->key);
+}
+
+static int qsort_int(const void *a, const void *b) {
+    return compare_int((void *)a, (void *)b);
+}
+
+#define QSORT_COMP(name, T) \
+    static int name(const void *a, const void *b) { \
+        T x = *(const T *)a, y = *(const T *)b; \
+        return (x > y) - (x < y); \
+    }
+
+QSORT_COMP(qsort_u8, uint8_t)
+QSORT_COMP(qsort_u16, uint16_t)
+QSORT_COMP(qsort_u32, uint32_t)
+QSORT_COMP(qsort_u64, uint64_t)
+QSORT_COMP(qsort_i8, int8_t)
+QSORT_COMP(qsort_i16, int16_t)
+QSORT_COMP(qsort_i32, int32_t)
+QSORT_COMP(qsort_i64, int64_t)
+
+// the shapes that trip up quicksorts: runs, duplicates and pivots at the ends
+static int key_of(int shape, size_t i, size_t n) {
+    switch (shape) {
+        case 0: return rand() - RAND_MAX / 2;
+        case 1: return (int)i;
+        case 2: return (int)(n - i);
+        case 3: return 7;
+        case 4: return rand() % 4;
+        case 5: return (int)((i < n / 2) ? i : n - i);     // organ pipe
+        default: return (i % 100 == 0) ? rand() : (int)i;  // nearly sorted
+    }
+}
+
+#define SHAPES 7
+
+static size_t check_ints(const int *got, const int *vals, size_t n) {
+    static int want[MAX_N];
+
+    memcpy(want, vals, n * sizeof(int));
+    qsort(want, n, sizeof(int), qsort_int);
+    return memcmp(got, want, n * sizeof(int)) != 0;
+}
+
+// in order by key, and each id seen once
+static size_t check_wide(const struct wide_t *got, size_t n) {
+    static unsigned char seen[MAX_N];
+    size_t i, wrong = 0;
+
+    memset(seen, 0, n);
+    for (i = 0; i < n; i++) {
+        wrong += got[i].id >= n || seen[got[i].id]++ != 0;
+        wrong += i > 0 && got[i - 1].key > got[i].key;
+    }
+
+    return wrong;
+}
+
+static size_t check_sorts(size_t n, int shape) {
+    static int vals[MAX_N];
+    static struct wide_t wides[MAX_N];
+    vector *v = vector_init(sizeof(int)), *w = vector_init(sizeof(struct wide_t));
+    array *a = array_init(sizeof(int), n), *b = array_init(sizeof(struct wide_t), n);
+    size_t i, wrong = 0;
+
+    for (i = 0; i < n; i++) {
+        vals[i] = key_of(shape, i, n);
+        wides[i] = (struct wide_t){ vals[i], (unsigned)i, { 0 } };
+    }
+
+    vector_append(v, vals, n);
+    vector_sort(v, compare_int);
+    wrong += vector_size(v) != n || check_ints(v->data, vals, n);
+
+    vector_erase_range(v, 0, n);
+    vector_append(v, vals, n);
+    vector_sort_ints(v, true);
+    wrong += check_ints(v->data, vals, n);
+
+    vector_erase_range(v, 0, n);
+    vector_append(v, vals, n);
+    vector_parallel_sort(v, compare_int, 3);
+    wrong += check_ints(v->data, vals, n);
+
+    memcpy(a->data, vals, n * sizeof(int));
+    array_sort(a, compare_int);
+    wrong += check_ints(a->data, vals, n);
+
+    memcpy(a->data, vals, n * sizeof(int));
+    array_parallel_sort(a, compare_int, 0);
+    wrong += check_ints(a->data, vals, n);
+
+    vector_append(w, wides, n);
+    vector_sort(w, compare_wide);
+    wrong += check_wide(w->data, n);
+
+    memcpy(b->data, wides, n * sizeof(struct wide_t));
+    array_parallel_sort(b, compare_wide, 4);
+    wrong += check_wide(b->data, n);
+
+    // a stable sort leaves equal keys in id order
+    memcpy(b->data, wides, n * sizeof(struct wide_t));
+    elems_stable_sort(b->data, n, sizeof(struct wide_t), compare_wide);
+    wrong += check_wide(b->data, n);
+    for (i = 1; i < n; i++) {
+        struct wide_t *p = array_get(b, i - 1), *q = array_get(b, i);
+        wrong += p->key == q->key && p->id > q->id;
+    }
+
+    vector_del(&v);
+    vector_del(&w);
+    array_del(&a);
+    array_del(&b);
+    return wrong;
+}
+
+static size_t check_int_widths(size_t n) {
+    static unsigned char data[MAX_N * 8], want[MAX_N * 8];
+    int (*comps[2][9])(const void *, const void *) = {
+        { [1] = qsort_u8, [2] = qsort_u16, [4] = qsort_u32, [8] = qsort_u64 },
+        { [1] = qsort_i8, [2] = qsort_i16, [4] = qsort_i32, [8] = qsort_i64 },
+    };
+    size_t widths[] = { 1, 2, 4, 8 }, w, i, wrong = 0;
+    int is_signed;
+
+    for (w = 0; w < 4; w++) {
+        for (is_signed = 0; is_signed < 2; is_signed++) {
+            size_t size = widths[w];
+            array *a = array_init(size, n);
+
+            // random bytes, but with some high bytes held so passes get skipped
+            for (i = 0; i < n * size; i++) {
+                data[i] = (i % size == size - 1 && i % 3 == 0) ? 0x80 : (unsigned char)rand();
+            }
+
+            memcpy(a->data, data, n * size);
+            memcpy(want, data, n * size);
+            array_sort_ints(a, is_signed);
+            qsort(want, n, size, comps[is_signed][size]);
+            wrong += memcmp(a->data, want, n * size) != 0;
+
+            array_del(&a);
+        }
+    }
+
+    return wrong;
+}
+
+static size_t check_searches(size_t n) {
+    vector *v = vector_init(sizeof(int));
+    array *a = array_init(sizeof(int), n);
+    size_t i, want, wrong = 0;
+    int val, *data;
+
+    for (i = 0; i < n; i++) {
+        val = 2 * (rand() % (int)(n + 1));      // only even keys, so odd ones miss
+        vector_push_back(v, &val);
+    }
+    vector_sort(v, compare_int);
+    data = v->data;
+    memcpy(a->data, data, n * sizeof(int));
+
+    for (val = -3; val <= 2 * (int)n + 3; val++) {
+        for (want = 0; want < n && data[want] < val; want++) {
+        }
+
+        wrong += vector_lower_bound(v, &val, compare_int) != want;
+        wrong += array_lower_bound(a, &val, compare_int) != want;
+        wrong += vector_binary_search(v, &val, compare_int) != (want < n && data[want] == val);
+        wrong += array_binary_search(a, &val, compare_int) != (want < n && data[want] == val);
+    }
+
+    vector_del(&v);
+    array_del(&a);
+    return wrong;
+}
+
+int main(void) {
+    size_t sizes[] = { 0, 1, 2, 3, 16, 17, 64, 65, 1000, 40000, MAX_N };
+    size_t i, n, wrong = 0;
+    int shape;
+
+    srand(1);
+    for (i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+        for (shape = 0; shape < SHAPES; shape++) {
+            n = check_sorts(sizes[i], shape);
+            if (n > 0) {
+                fprintf(stderr, "%zu elems, shape %d: %zu wrong sorts\n", sizes[i], shape, n);
+            }
+            wrong += n;
+        }
+
+        n = check_int_widths(sizes[i]);
+        if (n > 0) {
+            fprintf(stderr, "%zu elems: %zu wrong integer sorts\n", sizes[i], n);
+        }
+        wrong += n;
+    }
+
+    for (i = 0; i < 300; i++) {
+        n = check_searches(i);
+        if (n > 0) {
+            fprintf(stderr, "%zu elems: %zu wrong searches\n", i, n);
+        }
+        wrong += n;
+    }
+
+    printf("test_sort: %s\n", (wrong == 0) ? "ok" : "FAILED");
+    return wrong != 0;
+}
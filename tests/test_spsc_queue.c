@@ -0,0 +1,145 @@
+#include <stdio.h>          // printf(), fprintf()
+#include <stdlib.h>         // srand(), rand()
+#include <stdint.h>         // uint64_t
+#include <pthread.h>        // pthread_create(), pthread_join()
+#include <sched.h>          // sched_yield()
+
+#include "spsc_queue.h"
+
+/*
+ * Checks the bounds and wraparound on one thread, then streams items from
+ * a producer to a consumer thread, mixing single and batch calls, and
+ * checks they all arrive whole and in order. A thread that finds the
+ * queue full or empty yields, so the test also runs well on one core.
+ */
+
+#define ITEMS 500000
+#define BATCH 37        // longest run moved by one call
+
+struct item_t {
+    uint64_t seq;
+    uint64_t check;     // derived from |seq|, to catch torn copies
+};
+
+static uint64_t check_of(uint64_t seq) {
+    return seq * 0x9E3779B97F4A7C15ull ^ 0xABCDEF;
+}
+
+/*
+ * Pushes and pops runs of uneven length, so runs often straddle the end
+ * of the buffer, checking each call moves as many as fit or are there.
+ */
+static size_t check_single_thread(void) {
+    spsc_queue *q = spsc_queue_init(sizeof(int), 5);
+    size_t step, n, moved, cap = spsc_queue_capacity(q), size = 0, wrong = 0;
+    int vals[16], out[16], pushed = 0, popped = 0;
+
+    wrong += cap < 5 || spsc_queue_size(q) != 0 || spsc_queue_pop(q, out);
+
+    srand(1);
+    for (step = 0; step < 20000; step++) {
+        n = rand() % 7 + 1;
+
+        if (rand() % 2 == 0) {
+            for (moved = 0; moved < n; moved++) {
+                vals[moved] = pushed + (int)moved;
+            }
+
+            moved = (n == 1) ? spsc_queue_push(q, vals) : spsc_queue_push_n(q, vals, n);
+            wrong += moved != ((n < cap - size) ? n : cap - size);
+            pushed += (int)moved;
+            size += moved;
+        } else {
+            moved = (n == 1) ? spsc_queue_pop(q, out) : spsc_queue_pop_n(q, out, n);
+            wrong += moved != ((n < size) ? n : size);
+
+            for (n = 0; n < moved; n++) {
+                wrong += out[n] != popped++;
+            }
+            size -= moved;
+        }
+
+        wrong += spsc_queue_size(q) != size;
+    }
+
+    spsc_queue_del(&q);
+    return wrong;
+}
+
+static void *produce(void *arg) {
+    spsc_queue *q = arg;
+    struct item_t batch[BATCH];
+    uint64_t seq = 0;
+    size_t i, n, pushed;
+
+    while (seq < ITEMS) {
+        if (seq % 3 != 1) {
+            n = seq % BATCH + 1;
+            n = (ITEMS - seq < n) ? ITEMS - seq : n;
+            for (i = 0; i < n; i++) {
+                batch[i].seq = seq + i;
+                batch[i].check = check_of(seq + i);
+            }
+            pushed = spsc_queue_push_n(q, batch, n);
+        } else {
+            batch[0].seq = seq;
+            batch[0].check = check_of(seq);
+            pushed = spsc_queue_push(q, &batch[0]);
+        }
+
+        seq += pushed;
+        if (pushed == 0) {
+            sched_yield();
+        }
+    }
+
+    return NULL;
+}
+
+static size_t check_threads(void) {
+    spsc_queue *q = spsc_queue_init(sizeof(struct item_t), 256);
+    struct item_t batch[BATCH] = {{0}};
+    pthread_t producer;
+    uint64_t expect = 0;
+    size_t i, n, wrong = 0;
+
+    /*
+     * On one core each side runs until the queue is full or empty, so
+     * start the positions off a multiple of the capacity or no run would
+     * ever straddle the end of the buffer.
+     */
+    for (i = 0; i < 100; i++) {
+        spsc_queue_push(q, batch);
+        spsc_queue_pop(q, batch);
+    }
+
+    pthread_create(&producer, NULL, produce, q);
+
+    while (expect < ITEMS) {
+        n = (expect % 5 != 0) ? spsc_queue_pop_n(q, batch, expect % BATCH + 1) : spsc_queue_pop(q, batch);
+
+        for (i = 0; i < n; i++, expect++) {
+            wrong += batch[i].seq != expect || batch[i].check != check_of(expect);
+        }
+
+        if (n == 0) {
+            sched_yield();
+        }
+    }
+
+    pthread_join(producer, NULL);
+    wrong += spsc_queue_size(q) != 0;
+    spsc_queue_del(&q);
+    return wrong;
+}
+
+int main(void) {
+    size_t single = check_single_thread(), threads = check_threads();
+
+    if (single + threads > 0) {
+        fprintf(stderr, "%zu wrong results on one thread, %zu across two\n", single, threads);
+    }
+
+    printf("test_spsc_queue: %s\n", (single + threads == 0) ? "ok" : "FAILED");
+    return single + threads != 0;
+}
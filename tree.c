@@ -0,0 +1,661 @@
+#include "tree.h"
+
+#include <stdlib.h>     // malloc(), free()
+#include <string.h>     // memcpy()
+
+// largest alignment a type of |size| bytes can require
+static size_t align_for(size_t size) {
+    size_t align = size & -size;
+
+    if (align == 0 || align > _Alignof(max_align_t)) {
+        align = _Alignof(max_align_t);
+    }
+
+    return align;
+}
+
+static size_t round_up(size_t n, size_t align) {
+    return (n + align - 1) / align * align;
+}
+
+static size_t node_size(const tree * const t) {
+    return sizeof(struct tree_node_t) + t->val_offset + t->val_size;
+}
+
+static int compare(const tree * const t, void *a, void *b) {
+    STATS_ADD(t, comparisons, 1);
+    return (*t->comp)(a, b);
+}
+
+struct tree_node_t *tree_node_init(const tree * const t, void *key, void *val) {
+    struct tree_node_t *n = (t->nodes == NULL) ? malloc(node_size(t)) : pool_alloc(t->nodes);
+    STATS_ADD(t, allocs, 1);
+    STATS_ADD(t, bytes_copied, t->key_size + t->val_size);
+
+    n->left = n->right = n->parent = NULL;
+    n->count = 1;
+    n->red = true;
+
+    memcpy(n->key, key, t->key_size);
+    if (t->val_size > 0) {
+        memcpy(n->key + t->val_offset, val, t->val_size);
+    }
+
+    return n;
+}
+
+void tree_node_del(const tree * const t, struct tree_node_t *n) {
+    STATS_ADD(t, frees, 1);
+    if (t->nodes == NULL) {
+        free(n);
+    } else {
+        pool_free(t->nodes, n);
+    }
+}
+
+static void subtree_del(const tree * const t, struct tree_node_t *root) {
+    if (root != NULL) {
+        subtree_del(t, root->left);
+        subtree_del(t, root->right);
+        tree_node_del(t, root);
+    }
+}
+
+/*
+ * Links |n| nodes in key order into a perfectly balanced subtree. Every
+ * level above |red_depth| is full, so colouring only that last, partial
+ * level red gives each path the same number of black nodes.
+ */
+static struct tree_node_t *link_sorted(struct tree_node_t **nodes, size_t n,
+        struct tree_node_t *parent, size_t depth, size_t red_depth) {
+    struct tree_node_t *root;
+    size_t mid = n / 2;
+
+    if (n == 0) {
+        return NULL;
+    }
+
+    root = nodes[mid];
+    root->parent = parent;
+    root->count = n;
+    root->red = (depth == red_depth);
+    root->left = link_sorted(nodes, mid, root, depth + 1, red_depth);
+    root->right = link_sorted(nodes + mid + 1, n - mid - 1, root, depth + 1, red_depth);
+    return root;
+}
+
+static struct tree_node_t *clone_subtree(const tree * const dst, const tree * const src,
+        struct tree_node_t *root, struct tree_node_t *parent) {
+    struct tree_node_t *n;
+
+    if (root == NULL) {
+        return NULL;
+    }
+
+    n = (dst->nodes == NULL) ? malloc(node_size(dst)) : pool_alloc(dst->nodes);
+    memcpy(n, root, node_size(src));
+    STATS_ADD(dst, allocs, 1);
+    STATS_ADD(dst, bytes_copied, node_size(src));
+    n->parent = parent;
+    n->left = clone_subtree(dst, src, root->left, n);
+    n->right = clone_subtree(dst, src, root->right, n);
+    return n;
+}
+
+static bool is_red(const struct tree_node_t * const n) {
+    return n != NULL && n->red;     // NULL leaves are black
+}
+
+static size_t count_of(const struct tree_node_t * const n) {
+    return (n == NULL) ? 0 : n->count;
+}
+
+#ifdef CONTAINERS_STATS
+// levels from the root down to |n|, counting both
+static size_t node_depth(const struct tree_node_t *n) {
+    size_t depth = 0;
+
+    for (; n != NULL; n = n->parent) {
+        depth++;
+    }
+
+    return depth;
+}
+
+static size_t subtree_height(const struct tree_node_t * const n) {
+    size_t left, right;
+
+    if (n == NULL) {
+        return 0;
+    }
+
+    left = subtree_height(n->left);
+    right = subtree_height(n->right);
+    return 1 + ((left > right) ? left : right);
+}
+#endif
+
+// adds |delta| to the counts of |n| and every node above it
+static void adjust_counts(struct tree_node_t *n, size_t delta) {
+    for (; n != NULL; n = n->parent) {
+        n->count += delta;
+    }
+}
+
+static struct tree_node_t *min_node(struct tree_node_t *root) {
+    while (root != NULL && root->left != NULL) {
+        root = root->left;
+    }
+
+    return root;
+}
+
+static struct tree_node_t *max_node(struct tree_node_t *root) {
+    while (root != NULL && root->right != NULL) {
+        root = root->right;
+    }
+
+    return root;
+}
+
+// puts |v| in |u|'s place under |u|'s parent; |u|'s own links are untouched
+static void transplant(tree * const t, struct tree_node_t *u, struct tree_node_t *v) {
+    if (u->parent == NULL) {
+        t->root = v;
+    } else if (u == u->parent->left) {
+        u->parent->left = v;
+    } else {
+        u->parent->right = v;
+    }
+
+    if (v != NULL) {
+        v->parent = u->parent;
+    }
+}
+
+static void rotate_left(tree * const t, struct tree_node_t *x) {
+    struct tree_node_t *y = x->right;
+
+    x->right = y->left;
+    if (y->left != NULL) {
+        y->left->parent = x;
+    }
+
+    transplant(t, x, y);
+    y->left = x;
+    x->parent = y;
+
+    y->count = x->count;
+    x->count = 1 + count_of(x->left) + count_of(x->right);
+}
+
+static void rotate_right(tree * const t, struct tree_node_t *x) {
+    struct tree_node_t *y = x->left;
+
+    x->left = y->right;
+    if (y->right != NULL) {
+        y->right->parent = x;
+    }
+
+    transplant(t, x, y);
+    y->right = x;
+    x->parent = y;
+
+    y->count = x->count;
+    x->count = 1 + count_of(x->left) + count_of(x->right);
+}
+
+static void insert_fixup(tree * const t, struct tree_node_t *n) {
+    while (is_red(n->parent)) {
+        struct tree_node_t *p = n->parent;
+        struct tree_node_t *g = p->parent;     // non-NULL since the root is black
+
+        if (p == g->left) {
+            struct tree_node_t *u = g->right;
+
+            if (is_red(u)) {
+                p->red = u->red = false;
+                g->red = true;
+                n = g;
+            } else {
+                if (n == p->right) {
+                    rotate_left(t, p);
+                    n = p;
+                    p = n->parent;
+                }
+
+                p->red = false;
+                g->red = true;
+                rotate_right(t, g);
+            }
+        } else {
+            struct tree_node_t *u = g->left;
+
+            if (is_red(u)) {
+                p->red = u->red = false;
+                g->red = true;
+                n = g;
+            } else {
+                if (n == p->left) {
+                    rotate_right(t, p);
+                    n = p;
+                    p = n->parent;
+                }
+
+                p->red = false;
+                g->red = true;
+                rotate_left(t, g);
+            }
+        }
+    }
+
+    t->root->red = false;
+}
+
+// |x| may be a NULL leaf, so its parent is tracked separately
+static void erase_fixup(tree * const t, struct tree_node_t *x, struct tree_node_t *parent) {
+    while (x != t->root && !is_red(x)) {
+        if (x == parent->left) {
+            struct tree_node_t *w = parent->right;
+
+            if (is_red(w)) {
+                w->red = false;
+                parent->red = true;
+                rotate_left(t, parent);
+                w = parent->right;
+            }
+
+            if (!is_red(w->left) && !is_red(w->right)) {
+                w->red = true;
+                x = parent;
+                parent = x->parent;
+            } else {
+                if (!is_red(w->right)) {
+                    w->left->red = false;
+                    w->red = true;
+                    rotate_right(t, w);
+                    w = parent->right;
+                }
+
+                w->red = parent->red;
+                parent->red = false;
+                w->right->red = false;
+                rotate_left(t, parent);
+                x = t->root;
+            }
+        } else {
+            struct tree_node_t *w = parent->left;
+
+            if (is_red(w)) {
+                w->red = false;
+                parent->red = true;
+                rotate_right(t, parent);
+                w = parent->left;
+            }
+
+            if (!is_red(w->left) && !is_red(w->right)) {
+                w->red = true;
+                x = parent;
+                parent = x->parent;
+            } else {
+                if (!is_red(w->left)) {
+                    w->right->red = false;
+                    w->red = true;
+                    rotate_left(t, w);
+                    w = parent->left;
+                }
+
+                w->red = parent->red;
+                parent->red = false;
+                w->left->red = false;
+                rotate_right(t, parent);
+                x = t->root;
+            }
+        }
+    }
+
+    if (x != NULL) {
+        x->red = false;
+    }
+}
+
+tree *tree_init(size_t key_size, size_t val_size, int (*comp)(void *a, void *b)) {
+    struct tree_t *t = malloc(sizeof(*t));
+    t->size = 0;
+    t->key_size = key_size;
+    t->val_size = val_size;
+    t->val_offset = round_up(key_size, align_for(val_size));
+    t->root = NULL;
+    t->nodes = NULL;
+    t->comp = comp;
+    STATS_INIT(t);
+    return t;
+}
+
+tree *tree_init_pooled(size_t key_size, size_t val_size, int (*comp)(void *a, void *b)) {
+    struct tree_t *t = tree_init(key_size, val_size, comp);
+    t->nodes = pool_init(node_size(t));
+    return t;
+}
+
+/*
+ * Builds a tree from |n| keys, and values if |val_size| is nonzero, laid
+ * out contiguously in strictly increasing key order. Takes O(n) time and
+ * never calls |comp|, so unsorted or duplicate keys go undetected.
+ */
+tree *tree_from_sorted(size_t key_size, size_t val_size, int (*comp)(void *a, void *b),
+        void *keys, void *vals, size_t n) {
+    struct tree_t *t = tree_init(key_size, val_size, comp);
+    struct tree_node_t **nodes = malloc(n * sizeof(*nodes));
+    size_t i;
+
+    for (i = 0; i < n; i++) {
+        nodes[i] = tree_node_init(t, keys + i * key_size, (val_size > 0) ? vals + i * val_size : NULL);
+    }
+
+    tree_link_sorted(t, nodes, n);
+    free(nodes);
+    return t;
+}
+
+// copies the nodes of |t| as they are, keeping its shape and colouring
+tree *tree_clone(const tree * const t) {
+    struct tree_t *clone = (t->nodes == NULL)
+            ? tree_init(t->key_size, t->val_size, t->comp)
+            : tree_init_pooled(t->key_size, t->val_size, t->comp);
+
+    clone->root = clone_subtree(clone, t, t->root, NULL);
+    clone->size = t->size;
+    return clone;
+}
+
+void tree_del(tree **t) {
+    if (*t != NULL) {
+        if ((*t)->nodes == NULL) {
+            subtree_del(*t, (*t)->root);
+        } else {
+            pool_del(&(*t)->nodes);     // no need to visit each node
+        }
+        STATS_DEL(*t);
+        free(*t);
+        *t = NULL;
+    }
+}
+
+size_t tree_size(const tree * const t) {
+    return t->size;
+}
+
+void *tree_val(const tree * const t, struct tree_node_t *n) {
+    return (t->val_size == 0) ? NULL : n->key + t->val_offset;
+}
+
+struct tree_node_t *tree_find(const tree * const t, void *key) {
+    struct tree_node_t *n = t->root;
+
+    while (n != NULL) {
+        int c = compare(t, n->key, key);
+        STATS_ADD(t, node_visits, 1);
+
+        if (c == 0) {
+            break;
+        } else if (c > 0) {
+            n = n->left;
+        } else {
+            n = n->right;
+        }
+    }
+
+    return n;   // NULL iff |key| is not in the tree
+}
+
+bool tree_insert(tree * const t, void *key, void *val) {
+    struct tree_node_t *parent = NULL;
+    struct tree_node_t **link = &t->root;
+
+    while (*link != NULL) {
+        int c = compare(t, (*link)->key, key);
+        STATS_ADD(t, node_visits, 1);
+
+        if (c == 0) {
+            return false;
+        }
+
+        parent = *link;
+        link = (c > 0) ? &parent->left : &parent->right;
+    }
+
+    tree_link(t, parent, link, tree_node_init(t, key, val));
+    return true;
+}
+
+/*
+ * Hangs |n| from |*link|, the empty child link of |parent| where a search
+ * for its key ended, and rebalances. |parent| is NULL for an empty tree.
+ */
+void tree_link(tree * const t, struct tree_node_t *parent, struct tree_node_t **link,
+        struct tree_node_t *n) {
+    n->parent = parent;
+    *link = n;
+    t->size++;
+    adjust_counts(parent, 1);
+    STATS_MAX(t, max_height, node_depth(n));
+
+    insert_fixup(t, n);
+}
+
+bool tree_remove(tree * const t, void *key) {
+    struct tree_node_t *n = tree_find(t, key);
+
+    if (n != NULL) {
+        tree_erase(t, n);
+    }
+
+    return n != NULL;
+}
+
+void tree_erase(tree * const t, struct tree_node_t *n) {
+    struct tree_node_t *x, *x_parent;
+    bool removed_red = n->red;
+
+    if (n->left == NULL) {
+        x = n->right;
+        x_parent = n->parent;
+        transplant(t, n, n->right);
+    } else if (n->right == NULL) {
+        x = n->left;
+        x_parent = n->parent;
+        transplant(t, n, n->left);
+    } else {    // two children: relink the successor into |n|'s place
+        struct tree_node_t *succ = min_node(n->right);
+        removed_red = succ->red;
+        x = succ->right;
+
+        if (succ->parent == n) {
+            x_parent = succ;
+        } else {
+            x_parent = succ->parent;
+            transplant(t, succ, succ->right);
+            succ->right = n->right;
+            succ->right->parent = succ;
+        }
+
+        transplant(t, n, succ);
+        succ->left = n->left;
+        succ->left->parent = succ;
+        succ->red = n->red;
+        succ->count = n->count;
+    }
+
+    // |x_parent| is the lowest node to have lost a descendant
+    adjust_counts(x_parent, (size_t)-1);
+    tree_node_del(t, n);
+    t->size--;
+
+    if (!removed_red) {
+        erase_fixup(t, x, x_parent);
+    }
+}
+
+struct tree_node_t *tree_first(const tree * const t) {
+    return min_node(t->root);
+}
+
+struct tree_node_t *tree_last(const tree * const t) {
+    return max_node(t->root);
+}
+
+struct tree_node_t *tree_lower(const tree * const t, void *key) {
+    struct tree_node_t *n = t->root;
+    struct tree_node_t *lo = NULL;
+
+    while (n != NULL) {
+        STATS_ADD(t, node_visits, 1);
+        if (compare(t, n->key, key) < 0) {
+            lo = n;
+            n = n->right;
+        } else {
+            n = n->left;
+        }
+    }
+
+    return lo;  // greatest node before |key|
+}
+
+struct tree_node_t *tree_higher(const tree * const t, void *key) {
+    struct tree_node_t *n = t->root;
+    struct tree_node_t *hi = NULL;
+
+    while (n != NULL) {
+        STATS_ADD(t, node_visits, 1);
+        if (compare(t, n->key, key) > 0) {
+            hi = n;
+            n = n->left;
+        } else {
+            n = n->right;
+        }
+    }
+
+    return hi;  // least node after |key|
+}
+
+struct tree_node_t *tree_seek(const tree * const t, void *key) {
+    struct tree_node_t *n = t->root;
+    struct tree_node_t *at = NULL;
+
+    while (n != NULL) {
+        int c = compare(t, n->key, key);
+        STATS_ADD(t, node_visits, 1);
+
+        if (c == 0) {
+            return n;
+        } else if (c > 0) {
+            at = n;
+            n = n->left;
+        } else {
+            n = n->right;
+        }
+    }
+
+    return at;  // least node not before |key|
+}
+
+// number of keys in |t| before |key|
+size_t tree_rank(const tree * const t, void *key) {
+    struct tree_node_t *n = t->root;
+    size_t rank = 0;
+
+    while (n != NULL) {
+        int c = compare(t, n->key, key);
+        STATS_ADD(t, node_visits, 1);
+
+        if (c < 0) {
+            rank += count_of(n->left) + 1;
+            n = n->right;
+        } else if (c > 0) {
+            n = n->left;
+        } else {
+            return rank + count_of(n->left);
+        }
+    }
+
+    return rank;
+}
+
+// node with |k| keys before it, or NULL if |k| is not less than the size
+struct tree_node_t *tree_select(const tree * const t, size_t k) {
+    struct tree_node_t *n = t->root;
+
+    while (n != NULL) {
+        size_t left = count_of(n->left);
+        STATS_ADD(t, node_visits, 1);
+
+        if (k < left) {
+            n = n->left;
+        } else if (k > left) {
+            k -= left + 1;
+            n = n->right;
+        } else {
+            break;
+        }
+    }
+
+    return n;
+}
+
+/*
+ * Replaces the contents of |t| with |nodes|, which must be in strictly
+ * increasing key order, in O(n) and without comparing any keys. The
+ * nodes previously in |t| are not freed.
+ */
+void tree_link_sorted(tree * const t, struct tree_node_t **nodes, size_t n) {
+    size_t full_levels = 0;
+
+    while (((size_t)2 << full_levels) - 1 <= n) {
+        full_levels++;
+    }
+
+    t->root = link_sorted(nodes, n, NULL, 0, full_levels);
+    t->size = n;
+}
+
+struct tree_node_t *tree_next(struct tree_node_t *n) {
+    if (n->right != NULL) {
+        return min_node(n->right);
+    }
+
+    while (n->parent != NULL && n == n->parent->right) {
+        n = n->parent;
+    }
+
+    return n->parent;
+}
+
+struct tree_node_t *tree_prev(struct tree_node_t *n) {
+    if (n->left != NULL) {
+        return max_node(n->left);
+    }
+
+    while (n->parent != NULL && n == n->parent->left) {
+        n = n->parent;
+    }
+
+    return n->parent;
+}
+
+// the current height is measured by walking the whole tree
+void tree_stats(const tree * const t, container_stats *out) {
+    STATS_GET(t, out);
+
+#ifdef CONTAINERS_STATS
+    out->height = subtree_height(t->root);
+    if (out->height > out->max_height) {
+        out->max_height = out->height;
+    }
+#endif
+}
+
+void tree_stats_reset(tree * const t) {
+    STATS_RESET(t);
+}
+
@@ -0,0 +1,79 @@
+#ifndef TREE_H
+#define TREE_H
+
+#include <stddef.h>     // size_t, max_align_t
+#include <stdbool.h>    // bool
+
+#include "pool.h"
+#include "stats.h"
+
+/*
+ * Red-black tree underlying oset and omap. Nodes are ordered by key; a
+ * node carries a value only when |val_size| is nonzero.
+ *
+ * Each node is a single allocation: the key is stored right after the
+ * links and the value, if any, |val_offset| bytes after the key. Nodes
+ * also count their subtree, so keys can be found by rank.
+ */
+
+struct tree_node_t {
+    struct tree_node_t *left, *right, *parent;
+    size_t count;   // nodes in the subtree rooted here
+    bool red;
+    _Alignas(max_align_t) unsigned char key[];
+};
+
+typedef struct tree_t {
+    size_t size;
+    size_t key_size, val_size;
+    size_t val_offset;
+    struct tree_node_t *root;
+    pool *nodes;    // NULL unless the tree was made with tree_init_pooled()
+
+    /*
+     * < 0    *a before *b
+     * 0      *a and *b equivalent
+     * > 0    *a after *b
+     */
+    int (*comp)(void *a, void *b);
+
+    STATS_FIELD
+} tree;
+
+tree *tree_init(size_t key_size, size_t val_size, int (*comp)(void *a, void *b));
+tree *tree_init_pooled(size_t key_size, size_t val_size, int (*comp)(void *a, void *b));
+tree *tree_from_sorted(size_t key_size, size_t val_size, int (*comp)(void *a, void *b),
+        void *keys, void *vals, size_t n);
+tree *tree_clone(const tree * const t);
+void tree_del(tree **t);
+
+size_t tree_size(const tree * const t);
+void *tree_val(const tree * const t, struct tree_node_t *n);
+
+struct tree_node_t *tree_find(const tree * const t, void *key);
+bool tree_insert(tree * const t, void *key, void *val);
+bool tree_remove(tree * const t, void *key);
+void tree_erase(tree * const t, struct tree_node_t *n);
+
+struct tree_node_t *tree_first(const tree * const t);
+struct tree_node_t *tree_last(const tree * const t);
+struct tree_node_t *tree_lower(const tree * const t, void *key);
+struct tree_node_t *tree_higher(const tree * const t, void *key);
+struct tree_node_t *tree_seek(const tree * const t, void *key);
+
+size_t tree_rank(const tree * const t, void *key);
+struct tree_node_t *tree_select(const tree * const t, size_t k);
+
+struct tree_node_t *tree_next(struct tree_node_t *n);
+struct tree_node_t *tree_prev(struct tree_node_t *n);
+
+struct tree_node_t *tree_node_init(const tree * const t, void *key, void *val);
+void tree_node_del(const tree * const t, struct tree_node_t *n);
+void tree_link(tree * const t, struct tree_node_t *parent, struct tree_node_t **link,
+        struct tree_node_t *n);
+void tree_link_sorted(tree * const t, struct tree_node_t **nodes, size_t n);
+
+void tree_stats(const tree * const t, container_stats *out);
+void tree_stats_reset(tree * const t);
+
+#endif
@@ -0,0 +1,480 @@
+#ifndef TYPED_H
+#define TYPED_H
+
+#include <stddef.h>     // size_t
+#include <stdbool.h>    // bool
+
+#include "vector.h"
+#include "array.h"
+#include "deque.h"
+#include "oset.h"
+#include "omap.h"
+#include "tree.h"
+
+/*
+ * Generators for typed containers. Each DEFINE_* macro declares an
+ * incomplete struct type |name| and a family of static inline |name|_*
+ * functions that take and return elems by value. Each is an ordinary
+ * vector, array, deque, oset or omap underneath, which |name|_base()
+ * returns for the untyped functions, so growth, rebalancing and freeing
+ * are still done by the shared code:
+ *
+ *     DEFINE_VECTOR(int_vec, int)
+ *     DEFINE_OMAP(u64_map, uint64_t, double, u64_cmp)
+ *
+ * Indexed access compiles down to a plain load or store, and the ordered
+ * containers search with |cmp| inlined, where |cmp| is a function or macro
+ * taking two keys by value and returning < 0, 0 or > 0 like a comparator.
+ * Indices passed to get and set must be in bounds.
+ */
+
+#define DEFINE_VECTOR(name, T) \
+    typedef struct name##_t name; \
+    \
+    static inline name *name##_init(void) { \
+        return (name *)vector_init(sizeof(T)); \
+    } \
+    \
+    /* with room for |n| elems before it allocates again */ \
+    static inline name *name##_init_inline(size_t n) { \
+        return (name *)vector_init_inline(sizeof(T), n * sizeof(T)); \
+    } \
+    \
+    static inline void name##_del(name **v) { \
+        vector_del((vector **)v); \
+    } \
+    \
+    static inline vector *name##_base(name * const v) { \
+        return (vector *)v; \
+    } \
+    \
+    static inline size_t name##_size(const name * const v) { \
+        return ((const vector *)v)->size; \
+    } \
+    \
+    static inline T *name##_data(name * const v) { \
+        return (T *)((vector *)v)->data; \
+    } \
+    \
+    static inline T name##_get(const name * const v, size_t index) { \
+        return ((const T *)((const vector *)v)->data)[index]; \
+    } \
+    \
+    static inline void name##_set(name * const v, size_t index, T val) { \
+        ((T *)((vector *)v)->data)[index] = val; \
+    } \
+    \
+    static inline void name##_push_back(name * const v, T val) { \
+        vector *base = (vector *)v; \
+        \
+        /* only a push that must grow the buffer leaves the inline path */ \
+        if (base->size < base->cap) { \
+            ((T *)base->data)[base->size++] = val; \
+            STATS_ADD_INLINE(base, bytes_copied, sizeof(T)); \
+        } else { \
+            vector_push_back(base, &val); \
+        } \
+    } \
+    \
+    static inline void name##_pop_back(name * const v) { \
+        vector_pop_back((vector *)v); \
+    }
+
+#define DEFINE_ARRAY(name, T) \
+    typedef struct name##_t name; \
+    \
+    static inline name *name##_init(size_t size) { \
+        return (name *)array_init(sizeof(T), size); \
+    } \
+    \
+    static inline void name##_del(name **a) { \
+        array_del((array **)a); \
+    } \
+    \
+    static inline array *name##_base(name * const a) { \
+        return (array *)a; \
+    } \
+    \
+    static inline size_t name##_size(const name * const a) { \
+        return ((const array *)a)->size; \
+    } \
+    \
+    static inline T *name##_data(name * const a) { \
+        return (T *)((array *)a)->data; \
+    } \
+    \
+    static inline T name##_get(const name * const a, size_t index) { \
+        return ((const T *)((const array *)a)->data)[index]; \
+    } \
+    \
+    static inline void name##_set(name * const a, size_t index, T val) { \
+        ((T *)((array *)a)->data)[index] = val; \
+    } \
+    \
+    static inline void name##_fill(name * const a, T val) { \
+        T *data = (T *)((array *)a)->data; \
+        size_t i; \
+        \
+        for (i = 0; i < ((array *)a)->size; i++) { \
+            data[i] = val; \
+        } \
+    }
+
+#define DEFINE_DEQUE(name, T) \
+    typedef struct name##_t name; \
+    \
+    static inline name *name##_init(void) { \
+        return (name *)deque_init(sizeof(T)); \
+    } \
+    \
+    static inline void name##_del(name **d) { \
+        deque_del((deque **)d); \
+    } \
+    \
+    static inline deque *name##_base(name * const d) { \
+        return (deque *)d; \
+    } \
+    \
+    static inline size_t name##_size(const name * const d) { \
+        return ((const deque *)d)->size; \
+    } \
+    \
+    static inline T *name##_at(const name * const d, size_t index) { \
+        const deque *base = (const deque *)d; \
+        size_t pos = base->start + index; \
+        size_t offset = pos & (((size_t)1 << base->block_shift) - 1); \
+        return (T *)base->map[pos >> base->block_shift] + offset; \
+    } \
+    \
+    static inline T name##_get(const name * const d, size_t index) { \
+        return *name##_at(d, index); \
+    } \
+    \
+    static inline void name##_set(name * const d, size_t index, T val) { \
+        *name##_at(d, index) = val; \
+    } \
+    \
+    static inline T name##_front(const name * const d) { \
+        return name##_get(d, 0); \
+    } \
+    \
+    static inline T name##_back(const name * const d) { \
+        return name##_get(d, ((const deque *)d)->size - 1); \
+    } \
+    \
+    static inline void name##_push_front(name * const d, T val) { \
+        deque_push_front((deque *)d, &val); \
+    } \
+    \
+    static inline void name##_push_back(name * const d, T val) { \
+        deque_push_back((deque *)d, &val); \
+    } \
+    \
+    static inline void name##_pop_front(name * const d) { \
+        deque_pop_front((deque *)d); \
+    } \
+    \
+    static inline void name##_pop_back(name * const d) { \
+        deque_pop_back((deque *)d); \
+    }
+
+/*
+ * The ordered containers share their tree code. |name|_comp wraps |cmp|
+ * for the out-of-line functions that still compare, such as the oset set
+ * operations. |name|_find_ is the inlined lookup, and |name|_seek_ the
+ * inlined insertion search: it returns the node holding |key|, or NULL
+ * with |*parent| and |*link| left where |key| would be linked in.
+ */
+#define DEFINE_TREE_SEARCH_(name, K, cmp) \
+    static inline int name##_comp(void *a, void *b) { \
+        return cmp(*(K *)a, *(K *)b); \
+    } \
+    \
+    static inline struct tree_node_t *name##_seek_(const tree * const t, K key, \
+            struct tree_node_t **parent, struct tree_node_t ***link) { \
+        struct tree_node_t **at = (struct tree_node_t **)&t->root; \
+        struct tree_node_t *above = NULL; \
+        \
+        while (*at != NULL) { \
+            int c = cmp(*(K *)(*at)->key, key); \
+            STATS_ADD_INLINE(t, comparisons, 1); \
+            STATS_ADD_INLINE(t, node_visits, 1); \
+            \
+            if (c == 0) { \
+                return *at; \
+            } \
+            \
+            above = *at; \
+            if (c > 0) { \
+                at = &above->left; \
+            } else { \
+                at = &above->right; \
+            } \
+        } \
+        \
+        *parent = above; \
+        *link = at; \
+        return NULL; \
+    } \
+    \
+    static inline struct tree_node_t *name##_find_(const tree * const t, K key) { \
+        struct tree_node_t *n = t->root; \
+        \
+        while (n != NULL) { \
+            int c = cmp(*(K *)n->key, key); \
+            STATS_ADD_INLINE(t, comparisons, 1); \
+            STATS_ADD_INLINE(t, node_visits, 1); \
+            \
+            if (c == 0) { \
+                break; \
+            } else if (c > 0) { \
+                n = n->left; \
+            } else { \
+                n = n->right; \
+            } \
+        } \
+        \
+        return n; \
+    }
+
+#define DEFINE_OSET(name, T, cmp) \
+    typedef struct name##_t name; \
+    \
+    DEFINE_TREE_SEARCH_(name, T, cmp) \
+    \
+    static inline name *name##_init(void) { \
+        return (name *)oset_init(sizeof(T), name##_comp); \
+    } \
+    \
+    static inline name *name##_init_pooled(void) { \
+        return (name *)oset_init_pooled(sizeof(T), name##_comp); \
+    } \
+    \
+    static inline void name##_del(name **s) { \
+        oset_del((oset **)s); \
+    } \
+    \
+    static inline oset *name##_base(name * const s) { \
+        return (oset *)s; \
+    } \
+    \
+    static inline size_t name##_size(const name * const s) { \
+        return oset_size((const oset *)s); \
+    } \
+    \
+    static inline bool name##_contains(const name * const s, T val) { \
+        return name##_find_(oset_tree((const oset *)s), val) != NULL; \
+    } \
+    \
+    static inline bool name##_insert(name * const s, T val) { \
+        tree *t = oset_tree((oset *)s); \
+        struct tree_node_t *parent, **link; \
+        \
+        if (name##_seek_(t, val, &parent, &link) != NULL) { \
+            return false; \
+        } \
+        \
+        tree_link(t, parent, link, tree_node_init(t, &val, NULL)); \
+        return true; \
+    } \
+    \
+    static inline bool name##_remove(name * const s, T val) { \
+        tree *t = oset_tree((oset *)s); \
+        struct tree_node_t *n = name##_find_(t, val); \
+        \
+        if (n != NULL) { \
+            tree_erase(t, n); \
+        } \
+        \
+        return n != NULL; \
+    } \
+    \
+    /* each copies the elem found to |*out| and returns false if there is none */ \
+    static inline bool name##_out_(const struct tree_node_t * const n, T *out) { \
+        if (n != NULL) { \
+            *out = *(const T *)n->key; \
+        } \
+        \
+        return n != NULL; \
+    } \
+    \
+    static inline bool name##_floor(const name * const s, T *out) { \
+        return name##_out_(tree_first(oset_tree((const oset *)s)), out); \
+    } \
+    \
+    static inline bool name##_ceil(const name * const s, T *out) { \
+        return name##_out_(tree_last(oset_tree((const oset *)s)), out); \
+    } \
+    \
+    static inline bool name##_lower(const name * const s, T val, T *out) { \
+        return name##_out_(tree_lower(oset_tree((const oset *)s), &val), out); \
+    } \
+    \
+    static inline bool name##_higher(const name * const s, T val, T *out) { \
+        return name##_out_(tree_higher(oset_tree((const oset *)s), &val), out); \
+    } \
+    \
+    static inline bool name##_select(const name * const s, size_t k, T *out) { \
+        return name##_out_(tree_select(oset_tree((const oset *)s), k), out); \
+    } \
+    \
+    static inline size_t name##_rank(const name * const s, T val) { \
+        return tree_rank(oset_tree((const oset *)s), &val); \
+    } \
+    \
+    /* step with oset_iter_next() and oset_iter_prev() */ \
+    static inline oset_iter name##_iter_begin(const name * const s) { \
+        return oset_iter_begin((const oset *)s); \
+    } \
+    \
+    static inline oset_iter name##_iter_from(const name * const s, T val) { \
+        return oset_iter_from((const oset *)s, &val); \
+    } \
+    \
+    /* |it| must not be at the end */ \
+    static inline T name##_iter_get(const oset_iter * const it) { \
+        return *(const T *)oset_iter_get(it); \
+    }
+
+/*
+ * Typed maps are always red-black tree omaps, since the inlined searches
+ * walk the tree directly.
+ */
+#define DEFINE_OMAP(name, K, V, cmp) \
+    typedef struct name##_t name; \
+    \
+    DEFINE_TREE_SEARCH_(name, K, cmp) \
+    \
+    static inline name *name##_init(void) { \
+        return (name *)omap_init(sizeof(K), sizeof(V), name##_comp); \
+    } \
+    \
+    static inline name *name##_init_pooled(void) { \
+        return (name *)omap_init_pooled(sizeof(K), sizeof(V), name##_comp); \
+    } \
+    \
+    static inline void name##_del(name **m) { \
+        omap_del((omap **)m); \
+    } \
+    \
+    static inline omap *name##_base(name * const m) { \
+        return (omap *)m; \
+    } \
+    \
+    static inline size_t name##_size(const name * const m) { \
+        return omap_size((const omap *)m); \
+    } \
+    \
+    static inline bool name##_contains(const name * const m, K key) { \
+        return name##_find_(omap_tree((const omap *)m), key) != NULL; \
+    } \
+    \
+    static inline V *name##_val_(const tree * const t, struct tree_node_t *n) { \
+        return (V *)(n->key + t->val_offset); \
+    } \
+    \
+    /* the value stored under |key|, which stays put until |key| is removed */ \
+    static inline V *name##_ptr(const name * const m, K key) { \
+        const tree *t = omap_tree((const omap *)m); \
+        struct tree_node_t *n = name##_find_(t, key); \
+        return (n == NULL) ? NULL : name##_val_(t, n); \
+    } \
+    \
+    static inline bool name##_get(const name * const m, K key, V *out) { \
+        V *val = name##_ptr(m, key); \
+        \
+        if (val != NULL) { \
+            *out = *val; \
+        } \
+        \
+        return val != NULL; \
+    } \
+    \
+    static inline bool name##_insert(name * const m, K key, V val) { \
+        tree *t = omap_tree((omap *)m); \
+        struct tree_node_t *parent, **link; \
+        \
+        if (name##_seek_(t, key, &parent, &link) != NULL) { \
+            return false; \
+        } \
+        \
+        tree_link(t, parent, link, tree_node_init(t, &key, &val)); \
+        return true; \
+    } \
+    \
+    static inline bool name##_remove(name * const m, K key) { \
+        tree *t = omap_tree((omap *)m); \
+        struct tree_node_t *n = name##_find_(t, key); \
+        \
+        if (n != NULL) { \
+            tree_erase(t, n); \
+        } \
+        \
+        return n != NULL; \
+    } \
+    \
+    /* \
+     * Each copies the entry found to |*key| and |*val|, either of which may \
+     * be NULL, and returns false if there is none. \
+     */ \
+    static inline bool name##_out_(const tree * const t, struct tree_node_t *n, K *key, V *val) { \
+        if (n != NULL) { \
+            if (key != NULL) { \
+                *key = *(const K *)n->key; \
+            } \
+            if (val != NULL) { \
+                *val = *name##_val_(t, n); \
+            } \
+        } \
+        \
+        return n != NULL; \
+    } \
+    \
+    static inline bool name##_floor(const name * const m, K *key, V *val) { \
+        const tree *t = omap_tree((const omap *)m); \
+        return name##_out_(t, tree_first(t), key, val); \
+    } \
+    \
+    static inline bool name##_ceil(const name * const m, K *key, V *val) { \
+        const tree *t = omap_tree((const omap *)m); \
+        return name##_out_(t, tree_last(t), key, val); \
+    } \
+    \
+    static inline bool name##_lower(const name * const m, K key, K *out_key, V *out_val) { \
+        const tree *t = omap_tree((const omap *)m); \
+        return name##_out_(t, tree_lower(t, &key), out_key, out_val); \
+    } \
+    \
+    static inline bool name##_higher(const name * const m, K key, K *out_key, V *out_val) { \
+        const tree *t = omap_tree((const omap *)m); \
+        return name##_out_(t, tree_higher(t, &key), out_key, out_val); \
+    } \
+    \
+    static inline bool name##_select(const name * const m, size_t k, K *key, V *val) { \
+        const tree *t = omap_tree((const omap *)m); \
+        return name##_out_(t, tree_select(t, k), key, val); \
+    } \
+    \
+    static inline size_t name##_rank(const name * const m, K key) { \
+        return tree_rank(omap_tree((const omap *)m), &key); \
+    } \
+    \
+    /* step with omap_iter_next() and omap_iter_prev() */ \
+    static inline omap_iter name##_iter_begin(const name * const m) { \
+        return omap_iter_begin((const omap *)m); \
+    } \
+    \
+    static inline omap_iter name##_iter_from(const name * const m, K key) { \
+        return omap_iter_from((const omap *)m, &key); \
+    } \
+    \
+    /* |it| must not be at the end */ \
+    static inline K name##_iter_key(const omap_iter * const it) { \
+        return *(const K *)omap_iter_key(it); \
+    } \
+    \
+    static inline V *name##_iter_val(const omap_iter * const it) { \
+        return (V *)omap_iter_val(it); \
+    }
+
+#endif
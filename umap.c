@@ -0,0 +1,57 @@
+#include "umap.h"
+
+#include <stdlib.h>     // malloc(), free()
+
+#include "htable.h"
+
+struct unordered_map_t {
+    htable *h;
+};
+
+umap *umap_init(size_t key_size, size_t val_size,
+        size_t (*hash)(void *key), bool (*equal)(void *a, void *b)) {
+    struct unordered_map_t *m = malloc(sizeof(*m));
+    m->h = htable_init(key_size, val_size, hash, equal);
+    return m;
+}
+
+void umap_del(umap **m) {
+    if (*m != NULL) {
+        htable_del(&(*m)->h);
+        free(*m);
+        *m = NULL;
+    }
+}
+
+size_t umap_size(const umap * const m) {
+    return htable_size(m->h);
+}
+
+void umap_set_max_load(umap * const m, double max_load) {
+    htable_set_max_load(m->h, max_load);
+}
+
+void *umap_get(umap * const m, void *key) {
+    unsigned char *slot = htable_find(m->h, key);
+    return (slot == NULL) ? NULL : slot + m->h->val_offset;
+}
+
+bool umap_insert(umap * const m, void *key, void *val) {
+    return htable_insert(m->h, key, val);
+}
+
+bool umap_remove(umap * const m, void *key) {
+    return htable_remove(m->h, key);
+}
+
+bool umap_contains(const umap * const m, void *key) {
+    return htable_find(m->h, key) != NULL;
+}
+
+void umap_stats(const umap * const m, container_stats *out) {
+    htable_stats(m->h, out);
+}
+
+void umap_stats_reset(umap * const m) {
+    htable_stats_reset(m->h);
+}
@@ -0,0 +1,27 @@
+#ifndef UMAP_H
+#define UMAP_H
+
+#include <stddef.h>     // size_t
+#include <stdbool.h>    // bool
+
+#include "stats.h"
+
+typedef struct unordered_map_t umap;
+
+umap *umap_init(size_t key_size, size_t val_size,
+        size_t (*hash)(void *key), bool (*equal)(void *a, void *b));
+void umap_del(umap **m);
+
+size_t umap_size(const umap * const m);
+void umap_set_max_load(umap * const m, double max_load);
+
+void *umap_get(umap * const m, void *key);
+bool umap_insert(umap * const m, void *key, void *val);
+bool umap_remove(umap * const m, void *key);
+bool umap_contains(const umap * const m, void *key);
+
+void umap_stats(const umap * const m, container_stats *out);
+void umap_stats_reset(umap * const m);
+
+#endif
+
@@ -0,0 +1,119 @@
+#include "uset.h"
+
+#include <stdlib.h>     // malloc(), free()
+
+#include "htable.h"
+
+struct unordered_set_t {
+    htable *h;
+};
+
+uset *uset_init(size_t elem_size, size_t (*hash)(void *val), bool (*equal)(void *a, void *b)) {
+    struct unordered_set_t *s = malloc(sizeof(*s));
+    s->h = htable_init(elem_size, 0, hash, equal);
+    return s;
+}
+
+void uset_del(uset **s) {
+    if (*s != NULL) {
+        htable_del(&(*s)->h);
+        free(*s);
+        *s = NULL;
+    }
+}
+
+size_t uset_size(const uset * const s) {
+    return htable_size(s->h);
+}
+
+void uset_set_max_load(uset * const s, double max_load) {
+    htable_set_max_load(s->h, max_load);
+}
+
+bool uset_insert(uset * const s, void *val) {
+    return htable_insert(s->h, val, NULL);
+}
+
+bool uset_remove(uset * const s, void *val) {
+    return htable_remove(s->h, val);
+}
+
+bool uset_contains(const uset * const s, void *val) {
+    return htable_find(s->h, val) != NULL;
+}
+
+// an empty set that hashes and compares like |s|, with room for |n| elems
+static uset *init_like(const uset * const s, size_t n) {
+    uset *result = uset_init(s->h->key_size, s->h->hash, s->h->equal);
+    htable_reserve(result->h, n);
+    return result;
+}
+
+uset *uset_union(const uset * const a, const uset * const b) {
+    /*
+     * Walking a table visits keys grouped by home slot, which would pile
+     * them into a few long probe runs of a smaller table, so size the
+     * result up front.
+     */
+    uset *result = init_like(a, a->h->size + b->h->size);
+    size_t pos;
+    void *cur;
+
+    pos = 0;
+    while ((cur = htable_next(a->h, &pos)) != NULL) {
+        uset_insert(result, cur);
+    }
+
+    pos = 0;
+    while ((cur = htable_next(b->h, &pos)) != NULL) {
+        uset_insert(result, cur);
+    }
+
+    return result;
+}
+
+uset *uset_intxn(const uset * const a, const uset * const b) {
+    const uset *base, *other;
+    uset *result;
+    size_t pos = 0;
+    void *cur;
+
+    if (a->h->size < b->h->size) {
+        base = a;
+        other = b;
+    } else {
+        base = b;
+        other = a;
+    }
+
+    result = init_like(a, base->h->size);
+    while ((cur = htable_next(base->h, &pos)) != NULL) {
+        if (uset_contains(other, cur)) {
+            uset_insert(result, cur);
+        }
+    }
+
+    return result;
+}
+
+uset *uset_diff(const uset * const a, const uset * const b) {
+    uset *result = init_like(a, a->h->size);
+    size_t pos = 0;
+    void *cur;
+
+    while ((cur = htable_next(a->h, &pos)) != NULL) {
+        if (!uset_contains(b, cur)) {
+            uset_insert(result, cur);
+        }
+    }
+
+    return result;
+}
+
+void uset_stats(const uset * const s, container_stats *out) {
+    htable_stats(s->h, out);
+}
+
+void uset_stats_reset(uset * const s) {
+    htable_stats_reset(s->h);
+}
@@ -0,0 +1,29 @@
+#ifndef USET_H
+#define USET_H
+
+#include <stddef.h>     // size_t
+#include <stdbool.h>    // bool
+
+#include "stats.h"
+
+typedef struct unordered_set_t uset;
+
+uset *uset_init(size_t elem_size, size_t (*hash)(void *val), bool (*equal)(void *a, void *b));
+void uset_del(uset **s);
+
+size_t uset_size(const uset * const s);
+void uset_set_max_load(uset * const s, double max_load);
+
+bool uset_insert(uset * const s, void *val);
+bool uset_remove(uset * const s, void *val);
+bool uset_contains(const uset * const s, void *val);
+
+uset *uset_union(const uset * const a, const uset * const b);
+uset *uset_intxn(const uset * const a, const uset * const b);
+uset *uset_diff(const uset * const a, const uset * const b);
+
+void uset_stats(const uset * const s, container_stats *out);
+void uset_stats_reset(uset * const s);
+
+#endif
+
@@ -1,44 +1,140 @@
 #include "vector.h"
+#include "elems.h"
 
 #include <stdlib.h>     // malloc(), free()
 #include <string.h>     // memcpy()
+#include <stdbool.h>    // bool
 
-#define RESIZE_INCREMENT 10
+#define INIT_CAP 10
+#define DEFAULT_GROWTH 2.0
 
-struct vector_t {
-    size_t size, cap;
-    size_t elem_size;
-    void *data;
-};
+static inline bool is_inline(const vector * const v) {
+    return v->inline_cap > 0 && v->data == v->inline_data;
+}
 
-static void vector_resize(vector * const v, size_t new_size) {
-    size_t new_cap = (new_size / RESIZE_INCREMENT + 1) * RESIZE_INCREMENT;
+/*
+ * Inline vectors hold at least |inline_cap| elems, in their own header
+ * whenever that is enough; only capacity beyond it lives on the heap.
+ */
+static bool vector_realloc(vector * const v, size_t new_cap) {
+    void *tmp;
 
-    if (new_cap != v->cap) {
-        void *tmp = realloc(v->data, new_cap * v->elem_size); 
+    if (new_cap <= v->inline_cap) {
+        if (!is_inline(v)) {
+            memcpy(v->inline_data, v->data, ((v->size < new_cap) ? v->size : new_cap) * v->elem_size);
+            free(v->data);
+            v->data = v->inline_data;
+            STATS_ADD(v, frees, 1);
+        }
 
+        v->cap = v->inline_cap;
+        return true;
+    }
+
+    if (is_inline(v)) {
+        // spilling out of the header, which realloc() cannot grow
+        tmp = malloc(new_cap * v->elem_size);
         if (tmp) {
-            v->data = tmp;
-            v->size = new_size;
-            v->cap = new_cap;
+            memcpy(tmp, v->data, v->size * v->elem_size);
         }
+        STATS_ADD(v, allocs, 1);
     } else {
-        v->size = new_size;
+        tmp = realloc(v->data, new_cap * v->elem_size);
+        STATS_ADD(v, reallocs, 1);
     }
+
+    if (tmp) {
+        v->data = tmp;
+        v->cap = new_cap;
+    }
+
+    return tmp != NULL;
+}
+
+static void vector_resize(vector * const v, size_t new_size) {
+    if (new_size > v->cap) {
+        // grow geometrically so that n pushes cost O(n) copying overall
+        size_t new_cap = v->cap * v->growth;
+
+        if (new_cap < new_size) {
+            new_cap = new_size;
+        }
+
+        if (!vector_realloc(v, new_cap)) {
+            return;
+        }
+    } else if (new_size * v->growth * v->growth < v->cap) {
+        /*
+         * Only shrink once the vector has emptied well past the point where
+         * it last grew, so pushes and pops around one size do not thrash.
+         */
+        size_t new_cap = new_size * v->growth;
+
+        // inline vectors bottom out at their inline buffer, however small
+        size_t floor = (v->inline_cap > 0) ? v->inline_cap : INIT_CAP;
+
+        if (new_cap < v->min_cap) {
+            new_cap = v->min_cap;
+        }
+        if (new_cap < floor) {
+            new_cap = floor;
+        }
+
+        if (new_cap < v->cap) {
+            vector_realloc(v, new_cap);
+        }
+    }
+
+    v->size = new_size;
 }
 
 vector *vector_init(size_t elem_size) {
     struct vector_t *v = malloc(sizeof(*v));
     v->size = 0;
-    v->cap = RESIZE_INCREMENT;
+    v->cap = INIT_CAP;
+    v->min_cap = 0;
+    v->inline_cap = 0;
     v->elem_size = elem_size;
+    v->growth = DEFAULT_GROWTH;
     v->data = malloc(v->cap * elem_size);
+
+    STATS_INIT(v);
+    STATS_ADD(v, allocs, 1);
+    return v;
+}
+
+/*
+ * Like vector_init(), but with room for |inline_bytes| worth of elems in
+ * the same allocation as the vector itself, so a vector that stays that
+ * small costs a single malloc().
+ */
+vector *vector_init_inline(size_t elem_size, size_t inline_bytes) {
+    size_t inline_cap = inline_bytes / elem_size;
+    struct vector_t *v;
+
+    if (inline_cap == 0) {
+        return vector_init(elem_size);
+    }
+
+    v = malloc(sizeof(*v) + inline_cap * elem_size);
+    v->size = 0;
+    v->cap = inline_cap;
+    v->min_cap = 0;
+    v->inline_cap = inline_cap;
+    v->elem_size = elem_size;
+    v->growth = DEFAULT_GROWTH;
+    v->data = v->inline_data;
+
+    STATS_INIT(v);
     return v;
 }
 
 void vector_del(vector **v) {
     if (*v != NULL) {
-        free((*v)->data);
+        if (!is_inline(*v)) {
+            free((*v)->data);
+        }
+        STATS_DEL(*v);
         free(*v);
         *v = NULL;
     }
@@ -48,8 +144,38 @@ size_t vector_size(const vector * const v) {
     return v->size;
 }
 
+size_t vector_capacity(const vector * const v) {
+    return v->cap;
+}
+
+void vector_reserve(vector * const v, size_t cap) {
+    if (cap > v->cap) {
+        vector_realloc(v, cap);
+    }
+
+    v->min_cap = cap;
+}
+
+void vector_shrink_to_fit(vector * const v) {
+    // realloc() to 0 bytes may free the buffer, so keep room for one elem
+    size_t new_cap = (v->size > 0) ? v->size : 1;
+
+    if (new_cap != v->cap) {
+        vector_realloc(v, new_cap);
+    }
+
+    v->min_cap = 0;
+}
+
+void vector_set_growth(vector * const v, double factor) {
+    if (factor > 1.0) {
+        v->growth = factor;
+    }
+}
+
 void vector_set(vector * const v, size_t index, void *val) {
     memcpy(vector_get(v, index), val, v->elem_size);
+    STATS_ADD(v, bytes_copied, v->elem_size);
 }
 
 void *vector_get(const vector * const v, size_t index) {
@@ -61,20 +187,144 @@ void *vector_get(const vector * const v, size_t index) {
 }
 
 void vector_push_back(vector * const v, void *val) {
-    vector_resize(v, v->size + 1); 
-    vector_set(v, v->size - 1, val);
+    size_t old_size = v->size;
+
+    vector_resize(v, v->size + 1);
+    if (v->size > old_size) {   // resizing may fail to allocate
+        vector_set(v, old_size, val);
+    }
 }
 
 void vector_pop_back(vector * const v) {
-    vector_resize(v, v->size - 1);
+    if (v->size > 0) {
+        vector_resize(v, v->size - 1);
+    }
 }
 
-void vector_fill(vector * const v, void *val) {
-    void *p = v->data;
-    void *end = v->data + v->elem_size * v->size;
-    while (p != end) {
-        memcpy(p, val, v->elem_size);
-        p += v->elem_size;
+void vector_insert_n(vector * const v, size_t index, void *vals, size_t n) {
+    size_t old_size = v->size, elem_size = v->elem_size;
+    unsigned char *src = vals, *copy = NULL;
+
+    if (index > old_size || n == 0) {
+        return;
+    }
+
+    // growing may move the buffer out from under |vals| if they are our own elems
+    if (src >= (unsigned char *)v->data && src < (unsigned char *)v->data + old_size * elem_size) {
+        src = copy = malloc(n * elem_size);
+        if (copy == NULL) {
+            return;
+        }
+        memcpy(copy, vals, n * elem_size);
+    }
+
+    vector_resize(v, old_size + n);
+    if (v->size > old_size) {   // resizing may fail to allocate
+        unsigned char *at = (unsigned char *)v->data + index * elem_size;
+
+        memmove(at + n * elem_size, at, (old_size - index) * elem_size);
+        memcpy(at, src, n * elem_size);
+        STATS_ADD(v, bytes_copied, (old_size - index + n) * elem_size);
+    }
+
+    free(copy);
+}
+
+void vector_append(vector * const v, void *vals, size_t n) {
+    vector_insert_n(v, v->size, vals, n);
+}
+
+// removes the elems at |first| up to but not including |last|
+void vector_erase_range(vector * const v, size_t first, size_t last) {
+    unsigned char *data = v->data;
+    size_t elem_size = v->elem_size;
+
+    if (last > v->size) {
+        last = v->size;
+    }
+    if (first >= last) {
+        return;
+    }
+
+    // close the gap before resizing, which may drop everything past the new size
+    memmove(data + first * elem_size, data + last * elem_size, (v->size - last) * elem_size);
+    STATS_ADD(v, bytes_copied, (v->size - last) * elem_size);
+    vector_resize(v, v->size - (last - first));
+}
+
+/*
+ * Keeps the elems for which |pred| is false, in order, in one pass. Each
+ * run of kept elems is moved down with a single memmove(). Returns the
+ * number of elems removed.
+ */
+size_t vector_remove_if(vector * const v, bool (*pred)(void *elem, void *ctx), void *ctx) {
+    unsigned char *data = v->data;
+    size_t elem_size = v->elem_size, size = v->size;
+    size_t i, kept = 0, run = 0;    // the current run of kept elems starts at |run|
+
+    for (i = 0; i < size; i++) {
+        if (pred(data + i * elem_size, ctx)) {
+            if (run < i && kept < run) {
+                memmove(data + kept * elem_size, data + run * elem_size, (i - run) * elem_size);
+                STATS_ADD(v, bytes_copied, (i - run) * elem_size);
+            }
+            kept += i - run;
+            run = i + 1;
+        }
     }
+
+    if (run < size && kept < run) {
+        memmove(data + kept * elem_size, data + run * elem_size, (size - run) * elem_size);
+        STATS_ADD(v, bytes_copied, (size - run) * elem_size);
+    }
+    kept += size - run;
+
+    vector_resize(v, kept);
+    return size - kept;
+}
+
+void vector_fill(vector * const v, void *val) {
+    elems_fill(v->data, v->size, v->elem_size, val);
+    STATS_ADD(v, bytes_copied, v->size * v->elem_size);
+}
+
+size_t vector_find(const vector * const v, void *val) {
+    size_t index = elems_find(v->data, v->size, v->elem_size, val);
+    STATS_ADD(v, node_visits, (index < v->size) ? index + 1 : index);
+    return index;
+}
+
+size_t vector_count(const vector * const v, void *val) {
+    STATS_ADD(v, node_visits, v->size);
+    return elems_count(v->data, v->size, v->elem_size, val);
+}
+
+void vector_sort(vector * const v, int (*comp)(void *a, void *b)) {
+    elems_sort(v->data, v->size, v->elem_size, comp);
+}
+
+void vector_sort_ints(vector * const v, bool is_signed) {
+    elems_sort_ints(v->data, v->size, v->elem_size, is_signed);
+}
+
+void vector_parallel_sort(vector * const v, int (*comp)(void *a, void *b), size_t threads) {
+    elems_parallel_sort(v->data, v->size, v->elem_size, comp, threads);
+}
+
+size_t vector_lower_bound(const vector * const v, void *val, int (*comp)(void *a, void *b)) {
+    return elems_lower_bound(v->data, v->size, v->elem_size, val, comp);
+}
+
+bool vector_binary_search(const vector * const v, void *val, int (*comp)(void *a, void *b)) {
+    size_t index = vector_lower_bound(v, val, comp);
+    return index < v->size && comp(v->data + index * v->elem_size, val) == 0;
+}
+
+void vector_stats(const vector * const v, container_stats *out) {
+    STATS_GET(v, out);
+}
+
+void vector_stats_reset(vector * const v) {
+    STATS_RESET(v);
 }
 
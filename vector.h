@@ -1,14 +1,33 @@
 #ifndef VECTOR_H
 #define VECTOR_H
 
-#include <stddef.h>     // size_t
+#include <stddef.h>     // size_t, max_align_t
+#include <stdbool.h>    // bool
 
-typedef struct vector_t vector;
+#include "stats.h"
+
+// laid out here so that the typed wrappers in typed.h can index |data| inline
+typedef struct vector_t {
+    size_t size, cap;
+    size_t min_cap;     // capacity requested through vector_reserve()
+    size_t inline_cap;  // elems that fit in |inline_data|, 0 if it is absent
+    size_t elem_size;
+    double growth;
+    void *data;         // |inline_data| until the vector outgrows it
+    STATS_FIELD
+    _Alignas(max_align_t) unsigned char inline_data[];
+} vector;
 
 vector *vector_init(size_t elem_size);
+vector *vector_init_inline(size_t elem_size, size_t inline_bytes);
 void vector_del(vector **v);
 
 size_t vector_size(const vector * const v);
+size_t vector_capacity(const vector * const v);
+
+void vector_reserve(vector * const v, size_t cap);
+void vector_shrink_to_fit(vector * const v);
+void vector_set_growth(vector * const v, double factor);
 
 void vector_set(vector * const v, size_t index, void *val);
 void *vector_get(const vector * const v, size_t index);
@@ -16,6 +35,34 @@ void *vector_get(const vector * const v, size_t index);
 void vector_push_back(vector * const v, void *val);
 void vector_pop_back(vector * const v);
 
+/*
+ * Bulk edits, each resizing once and moving the elems after the edit with
+ * one memmove(). |index| may be the size, to insert at the end.
+ */
+void vector_insert_n(vector * const v, size_t index, void *vals, size_t n);
+void vector_append(vector * const v, void *vals, size_t n);
+void vector_erase_range(vector * const v, size_t first, size_t last);
+size_t vector_remove_if(vector * const v, bool (*pred)(void *elem, void *ctx), void *ctx);
+
 void vector_fill(vector * const v, void* val);
 
+// index of the first elem whose bytes equal |val|'s, or the size if none do
+size_t vector_find(const vector * const v, void *val);
+size_t vector_count(const vector * const v, void *val);
+
+/*
+ * Sorts in place; see elems.h for the algorithms. vector_sort_ints() needs
+ * elems that are 1, 2, 4 or 8-byte integers and uses no comparator.
+ */
+void vector_sort(vector * const v, int (*comp)(void *a, void *b));
+void vector_sort_ints(vector * const v, bool is_signed);
+void vector_parallel_sort(vector * const v, int (*comp)(void *a, void *b), size_t threads);
+
+// on a vector sorted by |comp|: the first index whose elem is not less than |val|
+size_t vector_lower_bound(const vector * const v, void *val, int (*comp)(void *a, void *b));
+bool vector_binary_search(const vector * const v, void *val, int (*comp)(void *a, void *b));
+
+void vector_stats(const vector * const v, container_stats *out);
+void vector_stats_reset(vector * const v);
+
 #endif